@@ -60,7 +60,7 @@ function atk.decide_zz( target, dist )
    local dir    = ai.idir(target)
 
    local _m1, d1 = vec2.polar( pilot:vel() )
-   local _m2, d2 = vec2.polar( target:pos() - pilot:pos() )
+   local _m2, d2 = vec2.polarDiff( target:pos(), pilot:pos() )
    local d = d1-d2
 
    return ( (dist > range) and (ai.hasprojectile())
@@ -317,7 +317,7 @@ local function ___atk_g_ranged_strafe( target, dist )
    range = math.min ( range - dist * radial_vel / ( ai.getweapspeed( 4 ) - radial_vel ), range )
 
    local goal = ai.follow_accurate(target, range * 0.8, 0, 10, 20, "keepangle")
-   local mod = vec2.mod(goal - p:pos())
+   local mod = goal:dist( p:pos() )
 
    --Must approach or stabilize
    if mod > 3000 then
@@ -374,7 +374,7 @@ local function ___atk_g_ranged_kite( target, dist )
    -- Try to keep velocity vector away from enemy
    local targetpos = target:pos()
    local selfpos = p:pos()
-   local _unused, targetdir = (selfpos-targetpos):polar()
+   local _unused, targetdir = vec2.polarDiff( selfpos, targetpos )
    local velmod, veldir = p:vel():polar()
    if velmod < 0.8*p:stats().speed or math.abs(targetdir-veldir) > math.rad(30) then
       local dir = ai.face( target, true )
@@ -413,7 +413,7 @@ function atk.ranged( target, dist )
    elseif target:target()==ai.pilot() and dist < range and ai.hasprojectile() then
       local tvel = target:vel()
       local pvel = ai.pilot():vel()
-      local vel = (tvel-pvel):polar()
+      local vel = tvel:dist( pvel )
       -- If will make contact soon, try to engage
       if dist < wrange+8*vel then
          ___atk_g_ranged_dogfight( target, dist )
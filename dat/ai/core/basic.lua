@@ -242,7 +242,7 @@ function follow_accurate( target )
    local goal = ai.follow_accurate(target, mem.radius,
          mem.angle, mem.Kp, mem.Kd)
 
-   local mod = vec2.mod(goal - p:pos())
+   local mod = goal:dist( p:pos() )
 
    --  Always face the goal
    local dir   = ai.face(goal)
@@ -460,8 +460,8 @@ function runaway( target )
    else
       -- find which one is the closest
       local pilpos = ai.pilot():pos()
-      local modt = vec2.mod(t:pos()-pilpos)
-      local modp = vec2.mod(p:pos()-pilpos)
+      local modt = t:pos():dist( pilpos )
+      local modp = p:pos():dist( pilpos )
       if modt < modp then
          mem.target_bias = vec2.newP( rnd.rnd()*t:radius()/2, rnd.angle() )
          ai.pushsubtask( "_run_hyp", {target, t} )
@@ -896,7 +896,7 @@ function mine( fieldNast )
 
    local target, vel = system.asteroidPos( field, ast )
 
-   local _dist, angle = vec2.polar( p:pos() - target )
+   local _dist, angle = vec2.polarDiff( p:pos(), target )
 
    -- First task : place the ship close to the asteroid
    local goal = ai.face_accurate( target, vel, trange, angle, mem.Kp, mem.Kd )
@@ -908,8 +908,8 @@ function mine( fieldNast )
       ai.accel()
    end
 
-   local relpos = vec2.add( p:pos(), vec2.mul(target,-1) ):mod()
-   local relvel = vec2.add( p:vel(), vec2.mul(vel,-1) ):mod()
+   local relpos = p:pos():dist( target )
+   local relvel = p:vel():dist( vel )
 
    if relpos < wrange and relvel < 10 then
       ai.pushsubtask("_killasteroid", fieldNast )
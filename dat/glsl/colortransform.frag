@@ -0,0 +1,14 @@
+#include "lib/colorblind.glsl"
+
+/* Gamma correction followed by colour blindness simulation in a single pass. */
+uniform sampler2D MainTex;
+uniform float gamma = 1.0;
+in vec4 VaryingTexCoord;
+out vec4 color_out;
+
+void main (void)
+{
+   color_out = texture( MainTex, VaryingTexCoord.st );
+   color_out.rgb = pow( color_out.rgb, vec3(1.0 / gamma) );
+   color_out.rgb = colorblind( color_out.rgb );
+}
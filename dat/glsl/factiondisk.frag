@@ -1,7 +1,6 @@
-uniform vec4 color;
-uniform float paramf;
-
 in vec2 pos;
+in vec4 color;
+in float inner;
 out vec4 color_out;
 
 void main(void) {
@@ -9,5 +8,5 @@ void main(void) {
 
    float dist = length(pos);
    color_out.a *= exp( 1.0 / (dist+1.0) - 0.5) - 1.0;
-   color_out.a *= smoothstep( 0.5*paramf, paramf, dist );
+   color_out.a *= smoothstep( 0.5*inner, inner, dist );
 }
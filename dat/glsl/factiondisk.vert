@@ -0,0 +1,19 @@
+uniform mat4 projection;
+uniform float zoom;
+uniform float radius;
+uniform float alpha;
+in vec4 vertex; /* xy: system position, zw: disk coordinates */
+in vec4 vertex_color;
+in float vertex_radius;
+out vec2 pos;
+out vec4 color;
+out float inner;
+
+void main(void) {
+   float r = vertex_radius * zoom;
+   pos   = vertex.zw;
+   color = vertex_color;
+   color.a *= alpha;
+   inner = radius / r;
+   gl_Position = projection * vec4( vertex.xy*zoom + vertex.zw*r, 0.0, 1.0 );
+}
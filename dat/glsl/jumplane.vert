@@ -0,0 +1,20 @@
+uniform mat4 projection;
+uniform float zoom;
+in vec4 vertex; /* xy: lane centre, zw: lane coordinates */
+in vec4 vertex_color;
+in vec4 vertex_color2;
+in vec4 vertex_lane; /* xy: direction, z: half length, w: half width in pixels */
+out vec2 pos;
+out vec2 dimensions;
+out vec4 color;
+out vec4 color2;
+
+void main(void) {
+   dimensions = vec2( vertex_lane.z*zoom, vertex_lane.w );
+   vec2 p   = vertex.zw * dimensions;
+   vec2 dir = vertex_lane.xy;
+   pos      = vertex.zw;
+   color    = vertex_color;
+   color2   = vertex_color2;
+   gl_Position = projection * vec4( vertex.xy*zoom + vec2( dir.x*p.x - dir.y*p.y, dir.y*p.x + dir.x*p.y ), 0.0, 1.0 );
+}
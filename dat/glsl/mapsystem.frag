@@ -0,0 +1,16 @@
+#include "lib/sdf.glsl"
+
+in vec2 pos;
+in vec4 color;
+in float r;
+in float filled;
+out vec4 color_out;
+
+void main(void) {
+   float d = sdCircle( pos*r, r-1.0 );
+   if (filled < 0.5)
+      d = abs(d);
+   float alpha = smoothstep(-1.0, 0.0, -d);
+   color_out   = color;
+   color_out.a *= alpha;
+}
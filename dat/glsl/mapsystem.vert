@@ -0,0 +1,18 @@
+uniform mat4 projection;
+uniform float zoom;
+uniform float radius;
+in vec4 vertex; /* xy: system position, zw: circle coordinates */
+in vec4 vertex_color;
+in vec2 vertex_param; /* x: radius relative to the system radius, y: filled */
+out vec2 pos;
+out vec4 color;
+out float r;
+out float filled;
+
+void main(void) {
+   r      = radius * vertex_param.x;
+   filled = vertex_param.y;
+   pos    = vertex.zw;
+   color  = vertex_color;
+   gl_Position = projection * vec4( vertex.xy*zoom + vertex.zw*r, 0.0, 1.0 );
+}
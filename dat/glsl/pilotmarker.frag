@@ -1,14 +1,13 @@
 #include "lib/sdf.glsl"
 
-uniform vec4 color;
-uniform vec2 dimensions;
-
 in vec2 pos;
+in vec4 color;
+in float dim;
 out vec4 color_out;
 
 void main(void) {
    vec2 uv = vec2( pos.y, pos.x );
-   float m = 1.0 / dimensions.x;
+   float m = 1.0 / dim;
    float d = sdTriangleEquilateral( uv*1.15  ) / 1.15;
    d = abs(d+2.0*m);
    float alpha = smoothstep(    -m, 0.0, -d);
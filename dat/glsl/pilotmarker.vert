@@ -0,0 +1,14 @@
+uniform mat4 projection;
+in vec4 vertex; /* xy: position, zw: marker coordinates */
+in vec4 vertex_color;
+in float vertex_dim;
+out vec2 pos;
+out vec4 color;
+out float dim;
+
+void main(void) {
+   pos   = vertex.zw;
+   color = vertex_color;
+   dim   = vertex_dim;
+   gl_Position = projection * vec4( vertex.xy, 0.0, 1.0 );
+}
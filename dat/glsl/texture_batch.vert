@@ -0,0 +1,11 @@
+uniform mat4 projection;
+in vec4 vertex; /* xy: position, zw: texture coordinates */
+in vec4 vertex_color;
+out vec2 tex_coord;
+out vec4 color;
+
+void main(void) {
+   tex_coord   = vertex.zw;
+   color       = vertex_color;
+   gl_Position = projection * vec4( vertex.xy, 0.0, 1.0 );
+}
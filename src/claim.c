@@ -18,6 +18,8 @@
 #include "mission.h"
 #include "space.h"
 
+#define CLAIM_STRS_MIN     64 /**< Initial number of string slots, must be a power of two. */
+
 /**
  * @brief The claim structure.
  */
@@ -25,9 +27,128 @@ struct Claim_s {
    int active; /**< Have we, in fact, claimed these contents?. */
    int *ids; /**< System ids. */
    char **strs; /**< Strings. */
+   char *owner; /**< Name of the mission or event holding the claim, for diagnostics. */
 };
 
-static char **claimed_strs = NULL; /**< Global claimed strings. */
+/**
+ * @brief A claimed string in the registry.
+ */
+typedef struct ClaimStr_ {
+   const char *str;  /**< Claimed string, owned by the claim. NULL if the slot is free. */
+   uint32_t hash;    /**< Hash of str. */
+   const Claim_t *claim; /**< Claim holding the string. */
+} ClaimStr;
+
+static ClaimStr *claim_strs = NULL; /**< Array (array.h): Open addressing table of claimed strings. */
+static int claim_nstrs = 0; /**< Number of used slots in claim_strs. */
+static const Claim_t **claim_sys = NULL; /**< Array (array.h): Claim holding each system, NULL if unclaimed. */
+
+/*
+ * Prototypes.
+ */
+static uint32_t claim_hash( const char *str );
+static const Claim_t *claim_strOwner( const char *str );
+static void claim_strInsert( const char *str, uint32_t hash, const Claim_t *claim );
+static void claim_strRemove( const char *str, const Claim_t *claim );
+static void claim_deactivate( Claim_t *claim );
+
+/**
+ * @brief Hashes a claimed string (FNV-1a).
+ */
+static uint32_t claim_hash( const char *str )
+{
+   uint32_t h = 2166136261u;
+   for (const unsigned char *c=(const unsigned char*)str; *c!='\0'; c++) {
+      h ^= *c;
+      h *= 16777619u;
+   }
+   return h;
+}
+
+/**
+ * @brief Gets the claim holding a string.
+ *
+ *    @return The claim holding the string or NULL if it is not claimed.
+ */
+static const Claim_t *claim_strOwner( const char *str )
+{
+   uint32_t hash;
+   int mask;
+
+   if (claim_nstrs == 0)
+      return NULL;
+
+   hash = claim_hash( str );
+   mask = array_size(claim_strs)-1;
+   for (int i=hash & mask; claim_strs[i].str!=NULL; i=(i+1) & mask)
+      if ((claim_strs[i].hash == hash) && (strcmp(claim_strs[i].str, str)==0))
+         return claim_strs[i].claim;
+   return NULL;
+}
+
+/**
+ * @brief Adds a string to the registry, keeping it at most half full.
+ */
+static void claim_strInsert( const char *str, uint32_t hash, const Claim_t *claim )
+{
+   int mask;
+
+   /* Grow and rehash if needed. */
+   if (2*(claim_nstrs+1) > array_size(claim_strs)) {
+      ClaimStr *old = claim_strs;
+      int n = MAX( CLAIM_STRS_MIN, 2*array_size(old) );
+      claim_strs = array_create_size( ClaimStr, n );
+      array_resize( &claim_strs, n );
+      memset( claim_strs, 0, sizeof(ClaimStr)*n );
+      claim_nstrs = 0;
+      for (int i=0; i<array_size(old); i++)
+         if (old[i].str != NULL)
+            claim_strInsert( old[i].str, old[i].hash, old[i].claim );
+      array_free( old );
+   }
+
+   mask = array_size(claim_strs)-1;
+   for (int i=hash & mask; ; i=(i+1) & mask) {
+      if (claim_strs[i].str != NULL)
+         continue;
+      claim_strs[i].str    = str;
+      claim_strs[i].hash   = hash;
+      claim_strs[i].claim  = claim;
+      claim_nstrs++;
+      return;
+   }
+}
+
+/**
+ * @brief Removes a string held by a claim from the registry.
+ */
+static void claim_strRemove( const char *str, const Claim_t *claim )
+{
+   int mask, i, j;
+
+   if (claim_nstrs == 0)
+      return;
+
+   /* Find the slot. */
+   mask = array_size(claim_strs)-1;
+   for (i=claim_hash(str) & mask; claim_strs[i].str!=NULL; i=(i+1) & mask)
+      if ((claim_strs[i].claim == claim) && (strcmp(claim_strs[i].str, str)==0))
+         break;
+   if (claim_strs[i].str == NULL)
+      return;
+
+   /* Shift back the following entries of the cluster so lookups don't stop early. */
+   for (j=(i+1) & mask; claim_strs[j].str!=NULL; j=(j+1) & mask) {
+      int k = claim_strs[j].hash & mask;
+      /* Entry at j can move to i only if its home slot is not in (i,j]. */
+      if ((i<=j) ? ((i<k) && (k<=j)) : ((i<k) || (k<=j)))
+         continue;
+      claim_strs[i] = claim_strs[j];
+      i = j;
+   }
+   memset( &claim_strs[i], 0, sizeof(ClaimStr) );
+   claim_nstrs--;
+}
 
 /**
  * @brief Creates a system claim.
@@ -40,6 +161,7 @@ Claim_t *claim_create (void)
    claim->active = 0;
    claim->ids    = NULL;
    claim->strs   = NULL;
+   claim->owner  = NULL;
 
    return claim;
 }
@@ -104,35 +226,61 @@ int claim_isNull( const Claim_t *claim )
 }
 
 /**
- * @brief Tests to see if a system claim would have collisions.
+ * @brief Sets the name of the mission or event holding the claim.
  *
- *    @param claim System to test.
- *    @return 0 if no collision found, 1 if a collision was found.
+ *    @param claim Claim to set the owner of.
+ *    @param owner Name of the owner, used when reporting conflicts.
  */
-int claim_test( const Claim_t *claim )
+void claim_setOwner( Claim_t *claim, const char *owner )
 {
-   int claimed, i, j;
+   free( claim->owner );
+   claim->owner = (owner==NULL) ? NULL : strdup( owner );
+}
+
+/**
+ * @brief Gets who holds a claim that collides with a claim.
+ *
+ *    @param claim Claim to test.
+ *    @return Name of the owner of the first colliding claim, or NULL if
+ *            there is no collision.
+ */
+const char *claim_conflict( const Claim_t *claim )
+{
+   const Claim_t *other;
 
    /* Must actually have a claim. */
    if (claim == NULL)
-      return 0;
+      return NULL;
 
    /* See if the system is claimed. */
-   for (i=0; i<array_size(claim->ids); i++) {
-      claimed = sys_isFlag( system_getIndex(claim->ids[i]), SYSTEM_CLAIMED );
-      if (claimed)
-         return 1;
+   for (int i=0; i<array_size(claim->ids); i++) {
+      int id = claim->ids[i];
+      if ((id < 0) || (id >= array_size(claim_sys)))
+         continue;
+      other = claim_sys[id];
+      if ((other != NULL) && (other != claim))
+         return (other->owner != NULL) ? other->owner : _("unknown");
    }
 
    /* Check strings. */
-   for (i=0; i<array_size(claim->strs); i++) {
-      for (j=0; j<array_size(claimed_strs); j++) {
-         if (strcmp( claim->strs[i], claimed_strs[j] )==0)
-            return 1;
-      }
+   for (int i=0; i<array_size(claim->strs); i++) {
+      other = claim_strOwner( claim->strs[i] );
+      if ((other != NULL) && (other != claim))
+         return (other->owner != NULL) ? other->owner : _("unknown");
    }
 
-   return 0;
+   return NULL;
+}
+
+/**
+ * @brief Tests to see if a system claim would have collisions.
+ *
+ *    @param claim System to test.
+ *    @return 0 if no collision found, 1 if a collision was found.
+ */
+int claim_test( const Claim_t *claim )
+{
+   return (claim_conflict( claim ) != NULL);
 }
 
 /**
@@ -186,14 +334,13 @@ int claim_testSys( const Claim_t *claim, int sys )
 void claim_destroy( Claim_t *claim )
 {
    if (claim->active)
-      for (int i=0; i<array_size(claim->ids); i++)
-         sys_rmFlag( system_getIndex(claim->ids[i]), SYSTEM_CLAIMED );
+      claim_deactivate( claim );
    array_free( claim->ids );
 
-   if (claim->active)
-      for (int i=0; i<array_size(claim->strs); i++)
-         free( claim->strs[i] );
+   for (int i=0; i<array_size(claim->strs); i++)
+      free( claim->strs[i] );
    array_free( claim->strs );
+   free( claim->owner );
    free(claim);
 }
 
@@ -207,14 +354,18 @@ void claim_clear (void)
    for (int i=0; i<array_size(sys); i++)
       sys_rmFlag( &sys[i], SYSTEM_CLAIMED );
 
-   for (int i=0; i<array_size(claimed_strs); i++)
-      free(claimed_strs[i]);
-   array_free(claimed_strs);
-   claimed_strs = NULL;
+   array_free( claim_sys );
+   claim_sys = NULL;
+   array_free( claim_strs );
+   claim_strs = NULL;
+   claim_nstrs = 0;
 }
 
 /**
- * @brief Activates all the claims.
+ * @brief Rebuilds the registry from all the active missions and events.
+ *
+ * Claims are added and removed as missions and events start and end, so this
+ *  is only needed after claim_clear().
  */
 void claim_activateAll (void)
 {
@@ -230,20 +381,56 @@ void claim_activateAll (void)
  */
 void claim_activate( Claim_t *claim )
 {
-   /* Add flags. */
-   for (int i=0; i<array_size(claim->ids); i++)
-      sys_setFlag( system_getIndex(claim->ids[i]), SYSTEM_CLAIMED );
+   /* Already registered, avoid duplicate entries. */
+   if (claim->active)
+      claim_deactivate( claim );
+
+   /* Add flags and owners. */
+   if (array_size(claim->ids) > 0) {
+      /* Systems can be added by unidiffs, so keep up with them. */
+      int o = array_size( claim_sys );
+      int n = array_size( system_getAll() );
+      if (claim_sys == NULL)
+         claim_sys = array_create_size( const Claim_t*, MAX(n,1) );
+      if (n > o) {
+         array_resize( &claim_sys, n );
+         memset( &claim_sys[o], 0, sizeof(Claim_t*)*(n-o) );
+      }
+   }
+   for (int i=0; i<array_size(claim->ids); i++) {
+      int id = claim->ids[i];
+      sys_setFlag( system_getIndex(id), SYSTEM_CLAIMED );
+      if ((id >= 0) && (id < array_size(claim_sys)))
+         claim_sys[id] = claim;
+   }
 
    /* Add strings. */
-   if ((claimed_strs == NULL) && (array_size(claim->strs) > 0))
-      claimed_strs = array_create( char* );
-   for (int i=0; i<array_size(claim->strs); i++) {
-      char **s = &array_grow( &claimed_strs );
-      *s = strdup( claim->strs[i] );
-   }
+   for (int i=0; i<array_size(claim->strs); i++)
+      claim_strInsert( claim->strs[i], claim_hash(claim->strs[i]), claim );
    claim->active = 1;
 }
 
+/**
+ * @brief Removes a claim from the registry.
+ *
+ *    @param claim Claim to remove.
+ */
+static void claim_deactivate( Claim_t *claim )
+{
+   for (int i=0; i<array_size(claim->ids); i++) {
+      int id = claim->ids[i];
+      /* Only release systems that are really ours. */
+      if ((id < 0) || (id >= array_size(claim_sys)) || (claim_sys[id] != claim))
+         continue;
+      claim_sys[id] = NULL;
+      sys_rmFlag( system_getIndex(id), SYSTEM_CLAIMED );
+   }
+
+   for (int i=0; i<array_size(claim->strs); i++)
+      claim_strRemove( claim->strs[i], claim );
+   claim->active = 0;
+}
+
 /**
  * @brief Saves all the systems in a claim in XML.
  *
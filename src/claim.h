@@ -15,7 +15,9 @@ typedef struct Claim_s Claim_t;
 Claim_t *claim_create (void);
 int claim_addStr( Claim_t *claim, const char *str );
 int claim_addSys( Claim_t *claim, int ss_id );
+void claim_setOwner( Claim_t *claim, const char *owner );
 int claim_test( const Claim_t *claim );
+const char *claim_conflict( const Claim_t *claim );
 int claim_testStr( const Claim_t *claim, const char *str );
 int claim_testSys( const Claim_t *claim, int sys );
 void claim_destroy( Claim_t *claim );
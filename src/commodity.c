@@ -434,6 +434,27 @@ void gatherable_free( void )
    array_erase( &gatherable_stack, array_begin(gatherable_stack), array_end(gatherable_stack) );
 }
 
+#if DEBUGGING
+/**
+ * @brief Gets the number of gatherables floating around.
+ */
+int gatherable_count( void )
+{
+   return array_size( gatherable_stack );
+}
+
+/**
+ * @brief Removes the gatherables created after the first n.
+ *
+ *    @param n Number of gatherables to keep, as given by gatherable_count.
+ */
+void gatherable_truncate( int n )
+{
+   if (n < array_size(gatherable_stack))
+      array_erase( &gatherable_stack, &gatherable_stack[n], array_end(gatherable_stack) );
+}
+#endif /* DEBUGGING */
+
 /**
  * @brief Renders all the gatherables
  */
@@ -110,6 +110,10 @@ int gatherable_getPos( Vector2d* pos, Vector2d* vel, int id );
 void gatherable_free( void );
 void gatherable_update( double dt );
 void gatherable_gather( int pilot );
+#if DEBUGGING
+int gatherable_count( void );
+void gatherable_truncate( int n );
+#endif /* DEBUGGING */
 
 /*
  * Misc stuff.
@@ -12,11 +12,33 @@
 
 #include "cond.h"
 
+#include "array.h"
 #include "log.h"
 #include "nlua.h"
 #include "nluadef.h"
 
+#define COND_CACHE_MIN     64 /**< Initial number of cache slots, must be a power of two. */
+
+/**
+ * @brief A conditional that has already been compiled.
+ */
+typedef struct CondChunk_ {
+   char *cond;       /**< Source of the conditional, NULL if the slot is free. */
+   uint32_t hash;    /**< Hash of cond. */
+   int ref;          /**< Registry reference to the compiled function. */
+} CondChunk;
+
 static nlua_env cond_env = LUA_NOREF; /** Conditional Lua env. */
+static CondChunk *cond_cache = NULL; /**< Array (array.h): Open addressing table of compiled conditionals. */
+static int cond_ncached = 0; /**< Number of used slots in cond_cache. */
+
+/*
+ * Prototypes.
+ */
+static uint32_t cond_hash( const char *cond );
+static CondChunk *cond_find( const char *cond, uint32_t hash );
+static void cond_cacheGrow (void);
+static int cond_compile( const char *cond );
 
 /**
  * @brief Initializes the conditional subsystem.
@@ -43,10 +65,113 @@ void cond_exit (void)
    if (cond_env == LUA_NOREF)
       return;
 
+   /* Free the compiled conditionals. */
+   for (int i=0; i<array_size(cond_cache); i++) {
+      if (cond_cache[i].cond == NULL)
+         continue;
+      free( cond_cache[i].cond );
+      luaL_unref( naevL, LUA_REGISTRYINDEX, cond_cache[i].ref );
+   }
+   array_free( cond_cache );
+   cond_cache = NULL;
+   cond_ncached = 0;
+
    nlua_freeEnv(cond_env);
    cond_env = LUA_NOREF;
 }
 
+/**
+ * @brief Hashes the source of a conditional (FNV-1a).
+ */
+static uint32_t cond_hash( const char *cond )
+{
+   uint32_t h = 2166136261u;
+   for (const unsigned char *c=(const unsigned char*)cond; *c!='\0'; c++) {
+      h ^= *c;
+      h *= 16777619u;
+   }
+   return h;
+}
+
+/**
+ * @brief Finds the slot of a conditional in the cache.
+ *
+ *    @return The slot holding the conditional, or the free slot it would go in.
+ */
+static CondChunk *cond_find( const char *cond, uint32_t hash )
+{
+   int mask = array_size(cond_cache)-1;
+   for (int i=hash & mask; ; i=(i+1) & mask) {
+      CondChunk *c = &cond_cache[i];
+      if (c->cond == NULL)
+         return c;
+      if ((c->hash == hash) && (strcmp(c->cond, cond)==0))
+         return c;
+   }
+}
+
+/**
+ * @brief Doubles the size of the cache, keeping it at most half full.
+ */
+static void cond_cacheGrow (void)
+{
+   CondChunk *old = cond_cache;
+   int n = MAX( COND_CACHE_MIN, 2*array_size(old) );
+
+   cond_cache = array_create_size( CondChunk, n );
+   array_resize( &cond_cache, n );
+   memset( cond_cache, 0, sizeof(CondChunk)*n );
+   for (int i=0; i<array_size(old); i++)
+      if (old[i].cond != NULL)
+         *cond_find( old[i].cond, old[i].hash ) = old[i];
+   array_free( old );
+}
+
+/**
+ * @brief Gets the compiled function of a conditional, compiling it if needed.
+ *
+ * Conditionals are checked every time missions or events are considered, so
+ *  they are only compiled the first time they are seen.
+ *
+ *    @param cond Conditional to compile.
+ *    @return Registry reference to the function, LUA_NOREF on error.
+ */
+static int cond_compile( const char *cond )
+{
+   uint32_t hash = cond_hash( cond );
+   CondChunk *c;
+
+   if (cond_cache != NULL) {
+      c = cond_find( cond, hash );
+      if (c->cond != NULL)
+         return c->ref;
+   }
+
+   /* Compile "return <cond>" in the conditional environment. */
+   lua_pushstring(naevL, "return ");
+   lua_pushstring(naevL, cond);
+   lua_concat(naevL, 2);
+   if (luaL_loadbuffer(naevL, lua_tostring(naevL,-1), lua_strlen(naevL,-1),
+            "Lua Conditional") != 0) {
+      WARN(_("Lua conditional syntax error: %s"), lua_tostring(naevL, -1));
+      lua_pop(naevL, 2);
+      return LUA_NOREF;
+   }
+   lua_remove(naevL, -2);
+   nlua_pushenv(cond_env);
+   lua_setfenv(naevL, -2);
+
+   /* Store it. */
+   if (2*(cond_ncached+1) > array_size(cond_cache))
+      cond_cacheGrow();
+   c        = cond_find( cond, hash );
+   c->cond  = strdup( cond );
+   c->hash  = hash;
+   c->ref   = luaL_ref(naevL, LUA_REGISTRYINDEX);
+   cond_ncached++;
+   return c->ref;
+}
+
 /**
  * @brief Checks to see if a condition is true.
  *
@@ -55,18 +180,17 @@ void cond_exit (void)
  */
 int cond_check( const char *cond )
 {
-   int ret;
+   int ret, ref;
 
-   /* Load the string. */
-   lua_pushstring(naevL, "return ");
-   lua_pushstring(naevL, cond);
-   lua_concat(naevL, 2);
-   ret = nlua_dobufenv(cond_env, lua_tostring(naevL,-1),
-                       lua_strlen(naevL,-1), "Lua Conditional");
+   /* Get the compiled conditional. */
+   ref = cond_compile( cond );
+   if (ref == LUA_NOREF)
+      goto cond_err;
+
+   /* Run it. */
+   lua_rawgeti(naevL, LUA_REGISTRYINDEX, ref);
+   ret = nlua_pcall(cond_env, 0, 1);
    switch (ret) {
-      case  LUA_ERRSYNTAX:
-         WARN(_("Lua conditional syntax error: %s"), lua_tostring(naevL, -1));
-         goto cond_err;
       case LUA_ERRRUN:
          WARN(_("Lua Conditional had a runtime error: %s"), lua_tostring(naevL, -1));
          goto cond_err;
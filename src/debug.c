@@ -155,6 +155,7 @@ static void debug_sigHandler( int sig, siginfo_t *info, void *unused )
          DEBUG("   %s", symbols[i]);
    }
    DEBUG( _("Report this to project maintainer with the backtrace.") );
+   log_flush();
 
    /* Always exit. */
    exit(1);
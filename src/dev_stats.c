@@ -0,0 +1,149 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+/**
+ * @file dev_stats.c
+ *
+ * @brief Developer statistics of the subsystems, shown under the FPS counter
+ *        in devmode and available to Lua through naev.stats().
+ */
+/** @cond */
+#include "naev.h"
+/** @endcond */
+
+#include "dev_stats.h"
+
+#include "font.h"
+#include "nlua.h"
+#include "pilot.h"
+#include "render.h"
+#include "space.h"
+#include "toolkit.h"
+
+/*
+ * Prototypes.
+ */
+static int dstats_lua( double v[DSTATS_VALUES] );
+static int dstats_postprocess( double v[DSTATS_VALUES] );
+static int dstats_toolkit( double v[DSTATS_VALUES] );
+static int dstats_pilots( double v[DSTATS_VALUES] );
+static int dstats_asteroidSprites( double v[DSTATS_VALUES] );
+static int dstats_asteroidCollisions( double v[DSTATS_VALUES] );
+
+/**
+ * @brief All the statistics, in the order they are displayed.
+ */
+static const DevStat dstats_list[] = {
+   { "lua", { "alloc", "reused", "memory" },
+      N_("Lua: %.0f alloc, %.0f reused, %.0f KiB"), dstats_lua },
+   { "postprocess", { "passes", "time", NULL },
+      N_("PP: %.0f passes, %.2f ms"), dstats_postprocess },
+   { "toolkit", { "cached", "drawn", NULL },
+      N_("Toolkit: %.0f cached, %.0f drawn"), dstats_toolkit },
+   { "pilots", { "rendered", "culled", NULL },
+      N_("Pilots: %.0f rendered, %.0f culled"), dstats_pilots },
+   { "asteroid_sprites", { "sprites", "draws", NULL },
+      N_("Asteroids: %.0f sprites in %.0f draws"), dstats_asteroidSprites },
+   { "asteroid_collisions", { "checked", "total", NULL },
+      N_("Asteroids: %.0f of %.0f checked"), dstats_asteroidCollisions },
+};
+
+/**
+ * @brief Lua userdata allocations and memory.
+ */
+static int dstats_lua( double v[DSTATS_VALUES] )
+{
+   const NLuaGCStats *gcs = nlua_gcStats();
+   v[0] = gcs->alloc;
+   v[1] = gcs->reused;
+   v[2] = gcs->memory;
+   return 1;
+}
+
+/**
+ * @brief Post-processing passes and GPU time, only when timed.
+ */
+static int dstats_postprocess( double v[DSTATS_VALUES] )
+{
+   int npasses;
+   v[1] = render_postprocessGPUTime( &npasses );
+   v[0] = npasses;
+   return (v[1] >= 0.);
+}
+
+/**
+ * @brief Toolkit windows drawn from their cache and drawn fully.
+ */
+static int dstats_toolkit( double v[DSTATS_VALUES] )
+{
+   int cached, drawn;
+   toolkit_renderStats( &cached, &drawn );
+   v[0] = cached;
+   v[1] = drawn;
+   return (cached+drawn > 0);
+}
+
+/**
+ * @brief Pilots rendered and culled.
+ */
+static int dstats_pilots( double v[DSTATS_VALUES] )
+{
+   int visible, culled;
+   pilots_renderStats( &visible, &culled );
+   v[0] = visible;
+   v[1] = culled;
+   return (visible+culled > 0);
+}
+
+/**
+ * @brief Asteroid and debris sprites and the draw calls they took.
+ */
+static int dstats_asteroidSprites( double v[DSTATS_VALUES] )
+{
+   int draws, sprites;
+   space_renderStats( &draws, &sprites );
+   v[0] = sprites;
+   v[1] = draws;
+   return (sprites > 0);
+}
+
+/**
+ * @brief Asteroids checked by weapon collisions and what checking all would have cost.
+ */
+static int dstats_asteroidCollisions( double v[DSTATS_VALUES] )
+{
+   int tested, total;
+   asteroid_gridStats( &tested, &total );
+   v[0] = tested;
+   v[1] = total;
+   return (total > 0);
+}
+
+/**
+ * @brief Gets all the developer statistics.
+ *
+ *    @param[out] n Number of statistics.
+ *    @return The statistics.
+ */
+const DevStat* dstats_getAll( int *n )
+{
+   *n = sizeof(dstats_list) / sizeof(dstats_list[0]);
+   return dstats_list;
+}
+
+/**
+ * @brief Displays the statistics that have something to show, one per line.
+ *
+ *    @param x X position to display at.
+ *    @param[in,out] y Y position of the first line, updated to below the last.
+ */
+void dstats_render( double x, double *y )
+{
+   for (size_t i=0; i<sizeof(dstats_list)/sizeof(dstats_list[0]); i++) {
+      double v[DSTATS_VALUES] = { 0., 0., 0. };
+      if (!dstats_list[i].get( v ))
+         continue;
+      gl_print( NULL, x, *y, &cFontWhite, _(dstats_list[i].fmt), v[0], v[1], v[2] );
+      *y -= gl_defFont.h + 5.;
+   }
+}
@@ -0,0 +1,19 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+#pragma once
+
+#define DSTATS_VALUES   3 /**< Maximum number of values of a statistic. */
+
+/**
+ * @brief Developer statistic about the last frame.
+ */
+typedef struct DevStat_ {
+   const char *name;                   /**< Name of the statistic. */
+   const char *values[DSTATS_VALUES];  /**< Names of the values, NULL if unused. */
+   const char *fmt;                    /**< Format to display the values with, gets them all as doubles. */
+   int (*get)( double v[DSTATS_VALUES] ); /**< Gets the values, returns 0 if there is nothing to show. */
+} DevStat;
+
+const DevStat* dstats_getAll( int *n );
+void dstats_render( double x, double *y );
@@ -167,6 +167,9 @@ void uniedit_open( unsigned int wid_unused, const char *unused )
    /* Must have no diffs applied. */
    diff_clear();
 
+   /* Edits won't be reflected in the universe digest, so stop using derived results cached by it. */
+   unidiff_universeModified();
+
    /* Reset some variables. */
    uniedit_mode   = UNIEDIT_DEFAULT;
    uniedit_viewmode = UNIEDIT_VIEW_DEFAULT;
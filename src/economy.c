@@ -11,14 +11,15 @@
  *  This is then solved with linear algebra after each time increment.
  */
 /** @cond */
+#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 
-#if HAVE_SUITESPARSE_CS_H
-#include <suitesparse/cs.h>
-#else /* HAVE_SUITESPARSE_CS_H */
-#include <cs.h>
-#endif /* HAVE_SUITESPARSE_CS_H */
+#if HAVE_SUITESPARSE_CHOLMOD_H
+#include <suitesparse/cholmod.h>
+#else /* HAVE_SUITESPARSE_CHOLMOD_H */
+#include <cholmod.h>
+#endif /* HAVE_SUITESPARSE_CHOLMOD_H */
 
 #include "naev.h"
 /** @endcond */
@@ -26,8 +27,12 @@
 #include "economy.h"
 
 #include "array.h"
+#include "conf.h"
+#include "faction.h"
 #include "log.h"
+#include "md5.h"
 #include "ndata.h"
+#include "nfile.h"
 #include "nstring.h"
 #include "ntime.h"
 #include "nxml.h"
@@ -36,6 +41,7 @@
 #include "rng.h"
 #include "space.h"
 #include "spfx.h"
+#include "unidiff.h"
 
 /*
  * Economy Nodal Analysis parameters.
@@ -45,6 +51,14 @@
 #define ECON_FACTION_MOD   0.1 /**< Modifier on Base for faction standings. */
 #define ECON_PROD_MODIFIER 500000. /**< Production modifier, divide production by this amount. */
 #define ECON_PROD_VAR      0.01 /**< Defines the variability of production. */
+#define ECON_PRICE_SPREAD  0.2 /**< Maximum relative deviation of prices caused by the nodal solution. */
+
+/*
+ * Persisted commodity prices.
+ */
+#define ECON_CACHE_MAGIC   0x4e434f45 /**< "ECON": Identifies persisted commodity prices. */
+#define ECON_CACHE_VERSION 1 /**< Bump whenever the price model or layout changes. */
+#define ECON_CACHE_FIELDS  5 /**< Derived values stored per commodity price. */
 
 /* systems stack. */
 extern StarSystem *systems_stack; /**< Star system stack. */
@@ -57,16 +71,37 @@ extern Commodity* commodity_stack;
  */
 static int econ_initialized   = 0; /**< Is economy system initialized? */
 static int econ_queued        = 0; /**< Whether there are any queued updates. */
-static cs *econ_G             = NULL; /**< Admittance matrix. */
+static cholmod_common econ_C; /**< CHOLMOD parameters and workspace for the economy solver. */
+static cholmod_sparse *econ_G = NULL; /**< Admittance matrix (symmetric, upper triangle stored). */
+static cholmod_factor *econ_L = NULL; /**< Cached Cholesky factorization of econ_G. */
+static cholmod_dense *econ_I  = NULL; /**< Intensities: one column per commodity, one row per system. */
+static cholmod_dense *econ_X  = NULL; /**< Potentials solved for econ_I. */
+static cholmod_dense *econ_Y  = NULL; /**< Workspace for cholmod_solve2. */
+static cholmod_dense *econ_E  = NULL; /**< Workspace for cholmod_solve2. */
+static md5_byte_t econ_G_pattern[16]; /**< Digest of the sparsity pattern of econ_G (the jump graph). */
+static md5_byte_t econ_G_values[16]; /**< Digest of the values of econ_G (the jump resistances). */
+static double *econ_prod      = NULL; /**< Base production per system and commodity (column-major like econ_I). */
+static double *econ_prodfactor = NULL; /**< Array (array.h): Production factor of each system, wanders around 1. */
 int *econ_comm         = NULL; /**< Commodities to calculate. */
 
 /*
  * Prototypes.
  */
 /* Economy. */
-//static double econ_calcJumpR( StarSystem *A, StarSystem *B );
-//static double econ_calcSysI( unsigned int dt, StarSystem *sys, int price );
-//static int econ_createGMatrix (void);
+static double econ_calcJumpR( const StarSystem *A, const StarSystem *B );
+static void econ_calcProduction (void);
+static double econ_revert( double ddt );
+static void econ_calcSysI( ntime_t dt );
+static int econ_createGMatrix (void);
+static int econ_factorize (void);
+static int econ_solve (void);
+static void econ_freeSolver (void);
+static double *econ_allocPrices (void);
+static int economy_hasModifiers (void);
+static void economy_freeModifiers (void);
+static void economy_cachePath( char *path, size_t len, const char *digest );
+static int economy_cacheLoad( const char *digest );
+static void economy_cacheSave( const char *digest );
 
 /*
  * Externed prototypes.
@@ -102,11 +137,10 @@ credits_t economy_getPrice( const Commodity *com,
 credits_t economy_getPriceAtTime( const Commodity *com,
       const StarSystem *sys, const Planet *p, ntime_t tme )
 {
-   int i, k;
+   int i, j, k;
    double price;
    double t;
    CommodityPrice *commPrice;
-   (void) sys;
    /* Get current time in periods.
     * Note, taking off and landing takes about 1e7 ntime, which is 1 period.
     * Time does not advance when on a planet.
@@ -127,6 +161,7 @@ credits_t economy_getPriceAtTime( const Commodity *com,
       WARN(_("Price for commodity '%s' not known."), com->name);
       return 0;
    }
+   j = i;
 
    /* and get the index on this planet */
    for ( i=0; i<array_size(p->commodities); i++) {
@@ -139,12 +174,16 @@ credits_t economy_getPriceAtTime( const Commodity *com,
    }
    commPrice = &p->commodityPrice[i];
    /* Calculate price. */
-   /* price  = (double) com->price; */
-   /* price *= sys->prices[i]; */
    price = (commPrice->price + commPrice->sysVariation
          * sin(2 * M_PI * t / commPrice->sysPeriod)
          + commPrice->planetVariation
          * sin(2 * M_PI * t / commPrice->planetPeriod));
+
+   /* Apply the supply of the system as solved by the nodal analysis. */
+   if (sys == NULL)
+      sys = system_get( planet_getSystem( p->name ) );
+   if ((sys != NULL) && (sys->prices != NULL))
+      price *= sys->prices[j];
    return (credits_t) (price+0.5);/* +0.5 to round */
 }
 
@@ -259,7 +298,6 @@ int economy_getAveragePrice( const Commodity *com, credits_t *mean, double *std
    return 0;
 }
 
-#if 0
 /**
  * @brief Calculates the resistance between two star systems.
  *
@@ -267,7 +305,7 @@ int economy_getAveragePrice( const Commodity *com, credits_t *mean, double *std
  *    @param B Star system to calculate the resistance between.
  *    @return Resistance between A and B.
  */
-static double econ_calcJumpR( StarSystem *A, StarSystem *B )
+static double econ_calcJumpR( const StarSystem *A, const StarSystem *B )
 {
    double R;
 
@@ -292,46 +330,96 @@ static double econ_calcJumpR( StarSystem *A, StarSystem *B )
 }
 
 /**
- * @brief Calculates the intensity in a system node.
+ * @brief Calculates the base production of every system for every commodity.
  *
- * @todo Make it time/item dependent.
+ * Production only depends on the inhabited planets trading each commodity,
+ *  so it is computed once per refresh and then only scaled per update.
  */
-static double econ_calcSysI( unsigned int dt, StarSystem *sys, int price )
+static void econ_calcProduction (void)
 {
-   int i;
-   double I;
-   double prodfactor, p;
-   double ddt;
-   Planet *planet;
+   int i, j, k, l, n;
+   int nsys, ncomm;
 
-   ddt = (double)(dt / NTIME_UNIT_LENGTH);
-
-   /* Calculate production level. */
-   p = 0.;
-   for (i=0; i<sys->nplanets; i++) {
-      planet = sys->planets[i];
-      if (planet_hasService(planet, PLANET_SERVICE_INHABITED)) {
-         /*
-          * Calculate production.
-          */
-         /* We base off the current production. */
-         prodfactor  = planet->cur_prodfactor;
-         /* Add a variability factor based on the Gaussian distribution. */
-         prodfactor += ECON_PROD_VAR * RNG_2SIGMA() * ddt;
-         /* Add a tendency to return to the planet's base production. */
-         prodfactor -= ECON_PROD_VAR *
-               (planet->cur_prodfactor - prodfactor)*ddt;
-         /* Save for next iteration. */
-         planet->cur_prodfactor = prodfactor;
+   nsys  = array_size(systems_stack);
+   ncomm = array_size(econ_comm);
+
+   free( econ_prod );
+   econ_prod = calloc( nsys * ncomm, sizeof(double) );
+   for (i=0; i<nsys; i++) {
+      StarSystem *sys = &systems_stack[i];
+      for (k=0; k<array_size(sys->planets); k++) {
+         Planet *planet = sys->planets[k];
+         double p;
+         if (!planet_hasService(planet, PLANET_SERVICE_INHABITED))
+            continue;
          /* We base off the sqrt of the population otherwise it changes too fast. */
-         p += prodfactor * sqrt(planet->population);
+         p = sqrt( (double)planet->population ) / ECON_PROD_MODIFIER;
+         for (l=0; l<array_size(planet->commodities); l++) {
+            int c = planet->commodities[l] - commodity_stack;
+            for (j=0; j<ncomm; j++)
+               if (econ_comm[j] == c)
+                  econ_prod[ j*nsys + i ] += p;
+         }
       }
    }
 
-   /* The intensity is basically the modified production. */
-   I = p / ECON_PROD_MODIFIER;
+   /* Production factors of new systems start at the base production. */
+   if (econ_prodfactor == NULL)
+      econ_prodfactor = array_create_size( double, nsys );
+   n = array_size(econ_prodfactor);
+   array_resize( &econ_prodfactor, nsys );
+   for (i=n; i<nsys; i++)
+      econ_prodfactor[i] = 1.;
+
+   /* Right hand side of the system, all commodities at once. */
+   if ((econ_I == NULL) || ((int)econ_I->nrow != nsys) || ((int)econ_I->ncol != ncomm)) {
+      cholmod_free_dense( &econ_I, &econ_C );
+      econ_I = cholmod_allocate_dense( nsys, ncomm, nsys, CHOLMOD_REAL, &econ_C );
+   }
+}
 
-   return I;
+/**
+ * @brief Gets how much of a production deviation decays over some time.
+ *
+ *    @param ddt Time elapsed in periods.
+ *    @return Fraction of the deviation to remove, in [0,1].
+ */
+static double econ_revert( double ddt )
+{
+   return MIN( ECON_PROD_VAR * ddt, 1. );
+}
+
+/**
+ * @brief Calculates the intensity in every system node for every commodity.
+ *
+ * Each system's production wanders around its base production as time passes.
+ *
+ *    @param dt Time elapsed since the last update in NTIME.
+ */
+static void econ_calcSysI( ntime_t dt )
+{
+   int i, j, nsys, ncomm;
+   double ddt, revert;
+   double *I;
+
+   nsys  = econ_I->nrow;
+   ncomm = econ_I->ncol;
+   I     = econ_I->x;
+
+   ddt    = ntime_convertSeconds( dt ) / NT_PERIOD_SECONDS;
+   revert = econ_revert( ddt );
+   for (i=0; i<nsys; i++) {
+      if (ddt > 0.) {
+         double prodfactor = econ_prodfactor[i];
+         /* Add a variability factor based on the Gaussian distribution. */
+         prodfactor += ECON_PROD_VAR * RNG_2SIGMA() * ddt;
+         /* Add a tendency to return to the system's base production. */
+         prodfactor -= revert * (prodfactor - 1.);
+         econ_prodfactor[i] = MAX( prodfactor, 0. );
+      }
+      for (j=0; j<ncomm; j++)
+         I[ j*econ_I->d + i ] = econ_prodfactor[i] * econ_prod[ j*nsys + i ];
+   }
 }
 
 /**
@@ -341,56 +429,218 @@ static double econ_calcSysI( unsigned int dt, StarSystem *sys, int price )
  */
 static int econ_createGMatrix (void)
 {
-   int ret;
-   int i, j;
-   double R, Rsum;
-   cs *M;
-   StarSystem *sys;
+   int i, j, n, nsys, njumps;
+   int *Ti, *Tj;
+   double *Tx;
+   cholmod_triplet *T;
+   cholmod_sparse *G;
+
+   nsys   = array_size(systems_stack);
+   njumps = 0;
+   for (i=0; i<nsys; i++)
+      njumps += array_size(systems_stack[i].jumps);
+
+   /* Only the upper triangle is stored, duplicates get summed. */
+   T = cholmod_allocate_triplet( nsys, nsys, nsys + 3*njumps, 1, CHOLMOD_REAL, &econ_C );
+   if (T == NULL) {
+      WARN(_("Unable to create economy G Matrix."));
+      return -1;
+   }
+   Ti = T->i;
+   Tj = T->j;
+   Tx = T->x;
+   n  = 0;
 
-   /* Create the matrix. */
-   M = cs_spalloc( array_size(systems_stack), array_size(systems_stack), 1, 1, 1 );
-   if (M == NULL)
-      ERR(_("Unable to create CSparse Matrix."));
-
-   /* Fill the matrix. */
-   for (i=0; i < array_size(systems_stack); i++) {
-      sys   = &systems_stack[i];
-      Rsum = 0.;
-
-      /* Set some values. */
-      for (j=0; j < array_size(sys->jumps); j++) {
-
-         /* Get the resistances. */
-         R     = econ_calcJumpR( sys, sys->jumps[j].target );
-         R     = 1./R; /* Must be inverted. */
-         Rsum += R;
-
-         /* Matrix is symmetrical and non-diagonal is negative. */
-         ret = cs_entry( M, i, sys->jumps[j].target->id, -R );
-         if (ret != 1)
-            WARN(_("Unable to enter CSparse Matrix Cell."));
-         ret = cs_entry( M, sys->jumps[j].target->id, i, -R );
-         if (ret != 1)
-            WARN(_("Unable to enter CSparse Matrix Cell."));
+   for (i=0; i<nsys; i++) {
+      StarSystem *sys = &systems_stack[i];
+
+      /* We add a resistance for dampening, this also keeps G positive definite. */
+      Ti[n] = Tj[n] = i;
+      Tx[n++] = 1. / ECON_SELF_RES;
+
+      for (j=0; j<array_size(sys->jumps); j++) {
+         int t = sys->jumps[j].target->id;
+         double R;
+         if (t == i)
+            continue;
+
+         /* Each direction of a jump contributes half the admittance, so the
+          * matrix stays symmetric and diagonally dominant with one-way jumps. */
+         R = .5 / econ_calcJumpR( sys, sys->jumps[j].target );
+         Ti[n] = MIN(i,t);
+         Tj[n] = MAX(i,t);
+         Tx[n++] = -R;
+         Ti[n] = Tj[n] = i;
+         Tx[n++] = R;
+         Ti[n] = Tj[n] = t;
+         Tx[n++] = R;
       }
+   }
+   T->nnz = n;
 
-      /* Set the diagonal. */
-      Rsum += 1./ECON_SELF_RES; /* We add a resistance for dampening. */
-      cs_entry( M, i, i, Rsum );
+   G = cholmod_triplet_to_sparse( T, 0, &econ_C );
+   cholmod_free_triplet( &T, &econ_C );
+   if (G == NULL) {
+      WARN(_("Unable to create economy G Matrix."));
+      return -1;
    }
 
-   /* Compress M matrix and put into G. */
-   cs_spfree( econ_G );
-   econ_G = cs_compress( M );
-   if (econ_G == NULL)
-      ERR(_("Unable to create economy G Matrix."));
+   cholmod_free_sparse( &econ_G, &econ_C );
+   econ_G = G;
+   return 0;
+}
 
-   /* Clean up. */
-   cs_spfree(M);
+/**
+ * @brief Factorizes the admittance matrix, reusing as much of the old factorization as possible.
+ *
+ * The symbolic analysis only depends on the jump graph and the numeric
+ *  factorization only on the jump resistances, so each is only redone when
+ *  the digest of what it depends on changes.
+ *
+ *    @return 1 if the matrix was factorized, 0 if the old factorization was kept, -1 on error.
+ */
+static int econ_factorize (void)
+{
+   md5_state_t md5;
+   md5_byte_t pattern[16], values[16];
+   int ncol, nnz;
+
+   ncol = econ_G->ncol;
+   nnz  = ((int*)econ_G->p)[ncol];
+
+   md5_init( &md5 );
+   md5_append( &md5, (md5_byte_t*)&ncol, sizeof(ncol) );
+   md5_append( &md5, econ_G->p, (ncol+1) * sizeof(int) );
+   md5_append( &md5, econ_G->i, nnz * sizeof(int) );
+   md5_finish( &md5, pattern );
+   md5_init( &md5 );
+   md5_append( &md5, econ_G->x, nnz * sizeof(double) );
+   md5_finish( &md5, values );
+
+   if ((econ_L != NULL) && (memcmp( pattern, econ_G_pattern, sizeof(pattern) ) == 0)) {
+      if (memcmp( values, econ_G_values, sizeof(values) ) == 0)
+         return 0;
+   }
+   else {
+      cholmod_free_factor( &econ_L, &econ_C );
+      econ_L = cholmod_analyze( econ_G, &econ_C );
+      if (econ_L == NULL) {
+         WARN(_("Failed to analyze the economy G Matrix."));
+         return -1;
+      }
+      memcpy( econ_G_pattern, pattern, sizeof(pattern) );
+   }
 
+   if (!cholmod_factorize( econ_G, econ_L, &econ_C ) || (econ_C.status != CHOLMOD_OK)) {
+      WARN(_("Failed to factorize the economy G Matrix."));
+      cholmod_free_factor( &econ_L, &econ_C );
+      return -1;
+   }
+   memcpy( econ_G_values, values, sizeof(values) );
+   return 1;
+}
+
+/**
+ * @brief Solves the economy system for all commodities at once.
+ *
+ *    @return 0 on success.
+ */
+static int econ_solve (void)
+{
+   if (!cholmod_solve2( CHOLMOD_A, econ_L, econ_I, NULL, &econ_X, NULL, &econ_Y, &econ_E, &econ_C )) {
+      WARN(_("Failed to solve the Economy System."));
+      return -1;
+   }
    return 0;
 }
-#endif
+
+/**
+ * @brief Frees the matrices and factorization of the economy solver.
+ */
+static void econ_freeSolver (void)
+{
+   cholmod_free_sparse( &econ_G, &econ_C );
+   cholmod_free_factor( &econ_L, &econ_C );
+   cholmod_free_dense( &econ_I, &econ_C );
+   cholmod_free_dense( &econ_X, &econ_C );
+   cholmod_free_dense( &econ_Y, &econ_C );
+   cholmod_free_dense( &econ_E, &econ_C );
+   free( econ_prod );
+   econ_prod = NULL;
+   array_free( econ_prodfactor );
+   econ_prodfactor = NULL;
+}
+
+/**
+ * @brief Converts a performance counter interval to milliseconds.
+ */
+static double econ_ms( Uint64 start, Uint64 end )
+{
+   return 1000. * (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+#if DEBUGGING
+/**
+ * @brief Reports how factorization and solve times scale with the universe size.
+ *
+ * Uses leading principal submatrices of the admittance matrix, which are the
+ *  admittance matrices of the universe restricted to its first systems.
+ */
+void economy_benchmark (void)
+{
+   const int runs = 10;
+   int m, n, r;
+   cholmod_sparse sub;
+   cholmod_dense B;
+   cholmod_factor *L;
+   cholmod_dense *X, *Y, *E;
+   Uint64 t0, t1, t2;
+
+   if ((econ_G == NULL) || (econ_I == NULL)) {
+      WARN(_("Economy: no factorized economy to benchmark."));
+      return;
+   }
+
+   /* A period, about what landing takes, must only partially revert production. */
+   if (econ_revert( ntime_convertSeconds( ntime_create( 0, 1, 0 ) ) / NT_PERIOD_SECONDS ) >= 1.)
+      WARN(_("Economy: production fully reverts within a period!"));
+
+   n = econ_G->ncol;
+   X = Y = E = NULL;
+   DEBUG(_("Economy solve benchmark (%d commodities, average of %d solves):"),
+         (int)econ_I->ncol, runs);
+   for (m=MAX(n/8,1); ; m=MIN(2*m,n)) {
+      /* With only the upper triangle stored, the first m columns only
+       * reference the first m rows, so they can be used in place. */
+      sub         = *econ_G;
+      sub.nrow    = m;
+      sub.ncol    = m;
+      sub.nzmax   = ((int*)econ_G->p)[m];
+      B           = *econ_I;
+      B.nrow      = m;
+
+      t0 = SDL_GetPerformanceCounter();
+      L  = cholmod_analyze( &sub, &econ_C );
+      if ((L == NULL) || !cholmod_factorize( &sub, L, &econ_C )) {
+         cholmod_free_factor( &L, &econ_C );
+         break;
+      }
+      t1 = SDL_GetPerformanceCounter();
+      for (r=0; r<runs; r++)
+         cholmod_solve2( CHOLMOD_A, L, &B, NULL, &X, NULL, &Y, &E, &econ_C );
+      t2 = SDL_GetPerformanceCounter();
+      DEBUG(_("   %5d systems: %8.3f ms factorization, %8.3f ms solve"),
+            m, econ_ms( t0, t1 ), econ_ms( t1, t2 ) / runs );
+      cholmod_free_factor( &L, &econ_C );
+
+      if (m >= n)
+         break;
+   }
+   cholmod_free_dense( &X, &econ_C );
+   cholmod_free_dense( &Y, &econ_C );
+   cholmod_free_dense( &E, &econ_C );
+}
+#endif /* DEBUGGING */
 
 /**
  * @brief Initializes the economy.
@@ -406,9 +656,12 @@ int economy_init (void)
    /* Allocate price space. */
    for (int i=0; i<array_size(systems_stack); i++) {
       free(systems_stack[i].prices);
-      systems_stack[i].prices = calloc(array_size(econ_comm), sizeof(double));
+      systems_stack[i].prices = econ_allocPrices();
    }
 
+   /* Set up the solver. */
+   cholmod_start( &econ_C );
+
    /* Mark economy as initialized. */
    econ_initialized = 1;
 
@@ -418,6 +671,17 @@ int economy_init (void)
    return 0;
 }
 
+/**
+ * @brief Allocates the price factors of a system, neutral until the first solve.
+ */
+static double *econ_allocPrices (void)
+{
+   double *prices = malloc( MAX(1,array_size(econ_comm)) * sizeof(double) );
+   for (int i=0; i<array_size(econ_comm); i++)
+      prices[i] = 1.;
+   return prices;
+}
+
 /**
  * @brief Increments the queued update counter.
  *
@@ -442,19 +706,46 @@ int economy_execQueued (void)
 /**
  * @brief Regenerates the economy matrix.  Should be used if the universe
  *  changes in any permanent way.
+ *
+ * The factorization is only redone if the jump graph or its resistances
+ *  actually changed.
  */
 int economy_refresh (void)
 {
+   int ret;
+   Uint64 t0, t1, t2;
+
    /* Economy must be initialized. */
    if (econ_initialized == 0)
       return 0;
 
+   /* Systems may have been added since initialization. */
+   for (int i=0; i<array_size(systems_stack); i++)
+      if (systems_stack[i].prices == NULL)
+         systems_stack[i].prices = econ_allocPrices();
+
    /* Create the resistance matrix. */
-   //if (econ_createGMatrix())
-   //   return -1;
+   t0 = SDL_GetPerformanceCounter();
+   if (econ_createGMatrix())
+      return -1;
+   ret = econ_factorize();
+   if (ret < 0)
+      return -1;
+   t1 = SDL_GetPerformanceCounter();
 
    /* Initialize the prices. */
+   econ_calcProduction();
    economy_update( 0 );
+   t2 = SDL_GetPerformanceCounter();
+
+   if (conf.devmode) {
+      if (ret)
+         DEBUG(_("Economy: factorized %d systems (%.0f nonzeros) in %.3f ms, solved %d commodities in %.3f ms"),
+               (int)econ_G->ncol, econ_C.lnz, econ_ms( t0, t1 ), array_size(econ_comm), econ_ms( t1, t2 ));
+      else
+         DEBUG(_("Economy: jump graph unchanged, solved %d commodities over %d systems in %.3f ms"),
+               array_size(econ_comm), (int)econ_G->ncol, econ_ms( t1, t2 ));
+   }
 
    return 0;
 }
@@ -464,76 +755,49 @@ int economy_refresh (void)
  *
  *    @param dt Deltatick in NTIME.
  */
-int economy_update( unsigned int dt )
+int economy_update( ntime_t dt )
 {
-   (void)dt;
-#if 0
-   int i, j;
+   int i, j, nsys;
    double *X;
-   double scale, offset;
-   /*double min, max;*/
 
    /* Economy must be initialized. */
    if (econ_initialized == 0)
       return 0;
 
-   /* Create the vector to solve the system. */
-   X = malloc(sizeof(double)*array_size(systems_stack));
-   if (X == NULL) {
-      WARN(_("Out of Memory"));
-      return -1;
+   /* The universe changed under us, wait for the refresh. */
+   nsys = array_size(systems_stack);
+   if ((econ_L == NULL) || (econ_I == NULL) || ((int)econ_L->n != nsys))
+      return 0;
+   if (econ_I->ncol == 0) {
+      econ_queued = 0;
+      return 0;
    }
 
-   /* Calculate the results for each price set. */
-   for (j=0; j<array_size(econ_comm); j++) {
-
-      /* First we must load the vector with intensities. */
-      for (i=0; i<array_size(systems_stack); i++)
-         X[i] = econ_calcSysI( dt, &systems_stack[i], j );
-
-      /* Solve the system. */
-      /** @TODO This should be improved to try to use better factorizations (LU/Cholesky)
-       * if possible or just outright try to use some other library that does fancy stuff
-       * like UMFPACK. Would be also interesting to see if it could be optimized so we
-       * store the factorization or update that instead of handling it individually. Another
-       * point of interest would be to split loops out to make the solving faster, however,
-       * this may be trickier to do (although it would surely let us use cholesky always if we
-       * enforce that condition). */
-      ret = cs_qrsol( 3, econ_G, X );
-      if (ret != 1)
-         WARN(_("Failed to solve the Economy System."));
-
-      /*
-       * Get the minimum and maximum to scale.
-       */
-      /*
-      min = +HUGE_VALF;
-      max = -HUGE_VALF;
-      for (i=0; i<array_size(systems_stack); i++) {
-         if (X[i] < min)
-            min = X[i];
-         if (X[i] > max)
-            max = X[i];
-      }
-      scale = 1. / (max - min);
-      offset = 0.5 - min * scale;
-      */
-
-      /*
-       * I'm not sure I like the filtering of the results, but it would take
-       * much more work to get a good system working without the need of post
-       * filtering.
-       */
-      scale    = 1.;
-      offset   = 1.;
-      for (i=0; i<array_size(systems_stack); i++)
-         systems_stack[i].prices[j] = X[i] * scale + offset;
-   }
+   /* Load the intensities of all commodities and solve them together. */
+   econ_calcSysI( dt );
+   if (econ_solve())
+      return -1;
+   X = econ_X->x;
 
-   /* Clean up. */
-   free(X);
+   /*
+    * The potentials are turned into price factors around 1: systems with a
+    * higher potential than average have a surplus of the commodity and sell
+    * it cheaper, the ones with a lower potential pay more for it.
+    */
+   for (j=0; j<(int)econ_X->ncol; j++) {
+      const double *x = &X[ j*econ_X->d ];
+      double mean, dev;
+      mean = 0.;
+      for (i=0; i<nsys; i++)
+         mean += x[i];
+      mean /= (double)MAX(nsys,1);
+      dev = 0.;
+      for (i=0; i<nsys; i++)
+         dev = MAX( dev, fabs(x[i]-mean) );
+      for (i=0; i<nsys; i++)
+         systems_stack[i].prices[j] = (dev > 0.) ? 1. - ECON_PRICE_SPREAD * (x[i]-mean) / dev : 1.;
+   }
 
-#endif
    econ_queued = 0;
    return 0;
 }
@@ -553,9 +817,9 @@ void economy_destroy (void)
       systems_stack[i].prices = NULL;
    }
 
-   /* Destroy the economy matrix. */
-   cs_spfree( econ_G );
-   econ_G = NULL;
+   /* Destroy the economy matrix and its factorization. */
+   econ_freeSolver();
+   cholmod_finish( &econ_C );
 
    /* Economy is now deinitialized. */
    econ_initialized = 0;
@@ -805,14 +1069,22 @@ static void economy_calcUpdatedCommodityPrice(StarSystem *sys)
 /**
  * @brief Initialises commodity prices for the sinusoidal economy model.
  *
+ * The prices only depend on the universe state, so they get persisted in the cache directory and reused when the
+ * same state comes up again (\see diff_universeDigest).
  */
 void economy_initialiseCommodityPrices(void)
 {
    int i, j, k;
    Planet *planet;
    StarSystem *sys;
-   Commodity *com;
-   CommodityModifier *this, *next;
+   const char *digest;
+
+   digest = diff_universeDigest();
+   if ((digest != NULL) && (economy_cacheLoad( digest ) == 0)) {
+      economy_freeModifiers();
+      return;
+   }
+
    /* First use planet attributes to set prices and variability */
    for (k=0; k<array_size(systems_stack); k++) {
       sys = &systems_stack[k];
@@ -843,8 +1115,33 @@ void economy_initialiseCommodityPrices(void)
       sys = &systems_stack[i];
       economy_calcUpdatedCommodityPrice(sys);
    }
+
+   if (digest != NULL)
+      economy_cacheSave( digest );
+
    /* And now free temporary commodity information */
-   for ( i=0 ; i<array_size(commodity_stack); i++ ) {
+   economy_freeModifiers();
+}
+
+/**
+ * @brief Checks whether the commodities still have their temporary price modifiers.
+ */
+static int economy_hasModifiers (void)
+{
+   for (int i=0; i<array_size(commodity_stack); i++)
+      if ((commodity_stack[i].planet_modifier != NULL) || (commodity_stack[i].faction_modifier != NULL))
+         return 1;
+   return 0;
+}
+
+/**
+ * @brief Frees the temporary price modifiers of all commodities.
+ */
+static void economy_freeModifiers (void)
+{
+   Commodity *com;
+   CommodityModifier *this, *next;
+   for (int i=0 ; i<array_size(commodity_stack); i++) {
       com = &commodity_stack[i];
       next = com->planet_modifier;
       com->planet_modifier = NULL;
@@ -865,6 +1162,116 @@ void economy_initialiseCommodityPrices(void)
    }
 }
 
+/**
+ * @brief Gets the path of the persisted prices for a universe digest.
+ *
+ * Only the first calculation has the commodity modifiers, so they're part of the key too.
+ */
+static void economy_cachePath( char *path, size_t len, const char *digest )
+{
+   snprintf( path, len, "%suniverse/%s%s.prices", nfile_cachePath(), digest, economy_hasModifiers() ? "" : "-nomod" );
+}
+
+/**
+ * @brief Loads the persisted commodity prices, if there are valid ones.
+ *
+ *    @param digest Universe digest.
+ *    @return 0 on success.
+ */
+static int economy_cacheLoad( const char *digest )
+{
+   char path[PATH_MAX];
+   size_t len;
+   uint32_t hdr[4]; /* Magic, version, count, padding. */
+   char *buf;
+   const double *data;
+   uint32_t n = 0;
+
+   economy_cachePath( path, sizeof(path), digest );
+   if (!nfile_fileExists( path ))
+      return -1;
+   buf = nfile_readFile( &len, path );
+   if (buf == NULL)
+      return -1;
+
+   for (int i=0; i<array_size(systems_stack); i++)
+      for (int j=0; j<array_size(systems_stack[i].planets); j++)
+         n += array_size(systems_stack[i].planets[j]->commodities);
+   if (len >= sizeof(hdr))
+      memcpy( hdr, buf, sizeof(hdr) );
+   if ((len != sizeof(hdr) + n*ECON_CACHE_FIELDS*sizeof(double))
+         || (hdr[0] != ECON_CACHE_MAGIC) || (hdr[1] != ECON_CACHE_VERSION) || (hdr[2] != n)) {
+      WARN(_("Ignoring invalid commodity price cache '%s'."), path);
+      free( buf );
+      return -1;
+   }
+
+   data = (const double*)(buf + sizeof(hdr));
+   for (int i=0; i<array_size(systems_stack); i++) {
+      StarSystem *sys = &systems_stack[i];
+      for (int j=0; j<array_size(sys->planets); j++) {
+         Planet *planet = sys->planets[j];
+         for (int k=0; k<array_size(planet->commodities); k++) {
+            CommodityPrice *cp = &planet->commodityPrice[k];
+            cp->price            = *data++;
+            cp->planetPeriod     = *data++;
+            cp->sysPeriod        = *data++;
+            cp->planetVariation  = *data++;
+            cp->sysVariation     = *data++;
+         }
+      }
+   }
+   free( buf );
+   return 0;
+}
+
+/**
+ * @brief Persists the current commodity prices.
+ *
+ *    @param digest Universe digest.
+ */
+static void economy_cacheSave( const char *digest )
+{
+   char path[PATH_MAX];
+   uint32_t hdr[4]; /* Magic, version, count, padding. */
+   double *buf, *data;
+   size_t len;
+   uint32_t n = 0;
+
+   for (int i=0; i<array_size(systems_stack); i++)
+      for (int j=0; j<array_size(systems_stack[i].planets); j++)
+         n += array_size(systems_stack[i].planets[j]->commodities);
+   hdr[0] = ECON_CACHE_MAGIC;
+   hdr[1] = ECON_CACHE_VERSION;
+   hdr[2] = n;
+   hdr[3] = 0;
+   len = sizeof(hdr) + n*ECON_CACHE_FIELDS*sizeof(double);
+   buf = malloc( len );
+   memcpy( buf, hdr, sizeof(hdr) );
+
+   data = (double*)((char*)buf + sizeof(hdr));
+   for (int i=0; i<array_size(systems_stack); i++) {
+      StarSystem *sys = &systems_stack[i];
+      for (int j=0; j<array_size(sys->planets); j++) {
+         Planet *planet = sys->planets[j];
+         for (int k=0; k<array_size(planet->commodities); k++) {
+            const CommodityPrice *cp = &planet->commodityPrice[k];
+            *data++ = cp->price;
+            *data++ = cp->planetPeriod;
+            *data++ = cp->sysPeriod;
+            *data++ = cp->planetVariation;
+            *data++ = cp->sysVariation;
+         }
+      }
+   }
+
+   snprintf( path, sizeof(path), "%suniverse/", nfile_cachePath() );
+   nfile_dirMakeExist( path );
+   economy_cachePath( path, sizeof(path), digest );
+   nfile_writeFile( (const char*)buf, len, path );
+   free( buf );
+}
+
 /*
  * Calculates commodity prices for a single planet (e.g. as added by the unidiff), and does some smoothing over the system, but not neighbours.
  */
@@ -959,6 +1366,10 @@ int economy_sysLoad( xmlNodePtr parent )
 
    economy_clearKnown();
 
+   /* Systems without a saved production factor are at their base production. */
+   for (int i=0; i<array_size(econ_prodfactor); i++)
+      econ_prodfactor[i] = 1.;
+
    do {
       if (xml_isNode(node,"economy")) {
          xmlNodePtr cur = node->xmlChildrenNode;
@@ -966,8 +1377,15 @@ int economy_sysLoad( xmlNodePtr parent )
             char *str;
             xml_onlyNodes(cur);
             if (xml_isNode(cur, "system")) {
-               /* Ignore "name" attribute. */
                xmlNodePtr nodeAsset = cur->xmlChildrenNode;
+               xmlr_attr_strd(cur,"name",str);
+               if (str != NULL) {
+                  StarSystem *sys = system_get(str);
+                  int id = (sys != NULL) ? sys - systems_stack : -1;
+                  if ((id >= 0) && (id < array_size(econ_prodfactor)))
+                     xmlr_attr_float_opt(cur,"prod",econ_prodfactor[id]);
+                  free(str);
+               }
                do {
                   xml_onlyNodes(nodeAsset);
                   if (xml_isNode(nodeAsset, "planet")) {
@@ -1012,6 +1430,9 @@ int economy_sysLoad( xmlNodePtr parent )
          } while (xml_nextNode(cur));
       }
    } while (xml_nextNode(node));
+
+   /* The price factors only depend on the production, so solve them again. */
+   economy_update( 0 );
    return 0;
 }
 
@@ -1036,6 +1457,13 @@ int economy_sysSave( xmlTextWriterPtr writer )
    for (int i=0; i<array_size(systems_stack); i++) {
       int doneSys=0;
       StarSystem *sys = &systems_stack[i];
+      /* The production factor decides the price factors of the system. */
+      if ((i < array_size(econ_prodfactor)) && (econ_prodfactor[i] != 1.)) {
+         doneSys = 1;
+         xmlw_startElem(writer, "system");
+         xmlw_attr(writer,"name","%s",sys->name);
+         xmlw_attr(writer,"prod","%.17g",econ_prodfactor[i]);
+      }
       for (int j=0; j<array_size(sys->planets); j++) {
          Planet *p = sys->planets[j];
          int donePlanet=0;
@@ -16,9 +16,12 @@
 int economy_init (void);
 void economy_addQueuedUpdate (void);
 int economy_execQueued (void);
-int economy_update( unsigned int dt );
+int economy_update( ntime_t dt );
 int economy_refresh (void);
 void economy_destroy (void);
+#if DEBUGGING
+void economy_benchmark (void);
+#endif /* DEBUGGING */
 void economy_clearKnown (void);
 void economy_clearSinglePlanet(Planet *p);
 
@@ -22,6 +22,7 @@
 
 #include "array.h"
 #include "cond.h"
+#include "conf.h"
 #include "hook.h"
 #include "log.h"
 #include "ndata.h"
@@ -46,6 +47,8 @@
 
 #define EVENT_FLAG_UNIQUE     (1<<0) /**< Unique event. */
 
+#define EVENT_TRIGGER_SLOW    5. /**< Triggers taking longer than this many ms get logged in devmode. */
+
 /**
  * @brief Event data structure.
  */
@@ -59,12 +62,15 @@ typedef struct EventData_ {
    char *cond; /**< Conditional Lua code to execute. */
    double chance; /**< Chance of appearing. */
    int priority; /**< Event priority: 0 = main plot, 5 = default, 10 = insignificant. */
+
+   int nrunning; /**< Number of active events using this data. */
 } EventData;
 
 /*
  * Event data.
  */
 static EventData *event_data   = NULL; /**< Allocated event data. */
+static int *event_triggers[EVENT_TRIGGER_LOAD+1]; /**< Array (array.h): Event data of each trigger, in priority order. */
 
 /*
  * Active events.
@@ -84,6 +90,8 @@ static int event_create( int dataid, unsigned int *id );
 int events_saveActive( xmlTextWriterPtr writer );
 int events_loadActive( xmlNodePtr parent );
 static int events_parseActive( xmlNodePtr parent );
+static void events_buildTriggers (void);
+static const char *event_triggerName( EventTrigger_t trigger );
 
 /**
  * @brief Gets an event.
@@ -191,6 +199,7 @@ static int event_create( int dataid, unsigned int *id )
    /* Add the data. */
    ev->data = dataid;
    data = &event_data[dataid];
+   data->nrunning++;
 
    /* Open the new state. */
    ev->env = nlua_newEnv(1);
@@ -233,6 +242,9 @@ static int event_create( int dataid, unsigned int *id )
  */
 static void event_cleanup( Event_t *ev )
 {
+   /* No longer running. */
+   event_data[ev->data].nrunning--;
+
    /* Free lua env. */
    nlua_freeEnv(ev->env);
 
@@ -288,14 +300,7 @@ int event_save( unsigned int eventid )
  */
 int event_alreadyRunning( int data )
 {
-   /* Find events. */
-   for (int i=0; i<array_size(event_active); i++) {
-      Event_t *ev = &event_active[i];
-      if (ev->data == data)
-         return 1;
-   }
-
-   return 0;
+   return (event_data[data].nrunning > 0);
 }
 
 /**
@@ -305,18 +310,23 @@ int event_alreadyRunning( int data )
  */
 void events_trigger( EventTrigger_t trigger )
 {
-   int i, c;
-   int created;
+   int created, nchance, ncond;
+   const int *candidates;
+   double ms;
+   Uint64 t0 = SDL_GetPerformanceCounter();
 
    created = 0;
-   for (i=0; i<array_size(event_data); i++) {
-      /* Make sure trigger matches. */
-      if (event_data[i].trigger != trigger)
-         continue;
+   nchance = 0;
+   ncond   = 0;
+   candidates = event_triggers[trigger];
+   for (int k=0; k<array_size(candidates); k++) {
+      int i = candidates[k];
+      int c;
 
       /* Make sure chance is succeeded. */
       if (RNGF() > event_data[i].chance)
          continue;
+      nchance++;
 
       /* Test uniqueness. */
       if ((event_data[i].flags & EVENT_FLAG_UNIQUE) &&
@@ -325,6 +335,7 @@ void events_trigger( EventTrigger_t trigger )
 
       /* Test conditional. */
       if (event_data[i].cond != NULL) {
+         ncond++;
          c = cond_check(event_data[i].cond);
          if (c<0) {
             WARN(_("Conditional for event '%s' failed to run."), event_data[i].name);
@@ -339,9 +350,44 @@ void events_trigger( EventTrigger_t trigger )
       created++;
    }
 
-   /* Run claims if necessary. */
-   if (created)
-      claim_activateAll();
+   /* Only report triggers slow enough to be noticeable. */
+   if (!conf.devmode)
+      return;
+   ms = 1000. * (double)(SDL_GetPerformanceCounter()-t0) / (double)SDL_GetPerformanceFrequency();
+   if (ms > EVENT_TRIGGER_SLOW)
+      DEBUG( _("Slow event trigger '%s': %d candidates, %d passed chance, %d conditionals, %d created in %.3f ms."),
+            event_triggerName(trigger), array_size(candidates), nchance, ncond, created, ms );
+}
+
+/**
+ * @brief Gets the name of a trigger, for debugging.
+ */
+static const char *event_triggerName( EventTrigger_t trigger )
+{
+   switch (trigger) {
+      case EVENT_TRIGGER_ENTER:  return "enter";
+      case EVENT_TRIGGER_LAND:   return "land";
+      case EVENT_TRIGGER_LOAD:   return "load";
+      case EVENT_TRIGGER_NONE:   return "none";
+      default:                   return "null";
+   }
+}
+
+/**
+ * @brief Indexes the event data by trigger so triggering doesn't look at
+ *        every event.
+ *
+ * Must be rebuilt whenever event_data is sorted or an event is reloaded.
+ */
+static void events_buildTriggers (void)
+{
+   for (int t=0; t<=EVENT_TRIGGER_LOAD; t++) {
+      if (event_triggers[t] == NULL)
+         event_triggers[t] = array_create( int );
+      array_resize( &event_triggers[t], 0 );
+   }
+   for (int i=0; i<array_size(event_data); i++)
+      array_push_back( &event_triggers[ event_data[i].trigger ], i );
 }
 
 /**
@@ -461,6 +507,7 @@ int events_load (void)
 
    /* Sort based on priority so higher priority missions can establish claims first. */
    qsort( event_data, array_size(event_data), sizeof(EventData), event_cmp );
+   events_buildTriggers();
 
    DEBUG( n_("Loaded %d Event", "Loaded %d Events", array_size(event_data) ), array_size(event_data) );
 
@@ -589,6 +636,12 @@ void events_exit (void)
       event_freeData( &event_data[i] );
    array_free(event_data);
    event_data  = NULL;
+
+   /* Free the trigger index. */
+   for (int t=0; t<=EVENT_TRIGGER_LOAD; t++) {
+      array_free( event_triggers[t] );
+      event_triggers[t] = NULL;
+   }
 }
 
 /**
@@ -776,8 +829,10 @@ static int events_parseActive( xmlNodePtr parent )
       } while (xml_nextNode(cur));
 
       /* Claims. */
-      if (xml_isNode(node,"claims"))
+      if (xml_isNode(node,"claims")) {
          ev->claims = claim_xmlLoad( node );
+         claim_setOwner( ev->claims, event_dataName( ev->data ) );
+      }
    } while (xml_nextNode(node));
 
    return 0;
@@ -791,8 +846,12 @@ int event_reload( const char *name )
       return -1;
    save = *temp;
    res = event_parseFile( save.sourcefile, temp );
-   if (res == 0)
+   if (res == 0) {
+      temp->nrunning = save.nrunning;
       event_freeData( &save );
+      /* The trigger may have changed. */
+      events_buildTriggers();
+   }
    else
       *temp = save;
    return res;
@@ -75,6 +75,14 @@ static double animation_dt    = 0.; /**< Used for animations. */
 /* for VBO. */
 static gl_vbo *gui_radar_select_vbo = NULL;
 
+/* Pilot marker batching. */
+#define GUI_PILOT_BATCH_VERTS    6 /**< Vertices per pilot marker (two triangles). */
+#define GUI_PILOT_BATCH_FLOATS   (2+2+4+1) /**< Floats per vertex: position, marker coordinates, colour, size. */
+static gl_vbo *gui_pilot_vbo        = NULL; /**< Streamed VBO for pilot markers. */
+static GLsizei gui_pilot_vboSize    = 0; /**< Size of the pilot marker VBO in bytes. */
+static GLfloat *gui_pilot_batch     = NULL; /**< Queued pilot marker vertices (array.h). */
+static int gui_pilot_batching       = 0; /**< Whether pilot markers are being batched. */
+
 static int gui_getMessage     = 1; /**< Whether or not the player should receive messages. */
 static char *gui_name         = NULL; /**< Name of the GUI (for errors and such). */
 
@@ -187,6 +195,8 @@ static const glColour *gui_getPlanetColour( int i );
 static void gui_renderRadarOutOfRange( RadarShape sh, int w, int h, int cx, int cy, const glColour *col );
 static void gui_blink( double cx, double cy, double vr, const glColour *col, double blinkInterval, double blinkVar );
 static const glColour* gui_getPilotColour( const Pilot* p );
+static void gui_pilotBatchAdd( double x, double y, double scale, double dir, const glColour *col );
+static void gui_pilotBatchFlush (void);
 static void gui_calcBorders (void);
 /* Lua GUI. */
 static int gui_doFunc( int func_ref, const char *func_name );
@@ -926,12 +936,14 @@ void gui_radarRender( double x, double y )
    /* render the pilot */
    pilot_stack = pilot_getAll();
    f = 0;
+   gui_renderPilotBegin();
    for (int i=1; i<array_size(pilot_stack); i++) { /* skip the player */
       if (pilot_stack[i]->id == player.p->target)
          f = i;
       else
          gui_renderPilot( pilot_stack[i], radar->shape, radar->w, radar->h, radar->res, 0 );
    }
+   gui_renderPilotEnd();
    /* render the targeted pilot */
    if (f != 0)
       gui_renderPilot( pilot_stack[f], radar->shape, radar->w, radar->h, radar->res, 0 );
@@ -1083,6 +1095,117 @@ static const glColour* gui_getPilotColour( const Pilot* p )
    return col;
 }
 
+/**
+ * @brief Starts batching pilot markers.
+ *
+ * Until gui_renderPilotEnd() is called, gui_renderPilot() queues the markers
+ * and draws them all with a single draw call. Anything else gui_renderPilot()
+ * draws flushes the queue first, so the drawing order is unchanged.
+ */
+void gui_renderPilotBegin (void)
+{
+   gui_pilot_batching = 1;
+}
+
+/**
+ * @brief Draws all the queued pilot markers and stops batching.
+ */
+void gui_renderPilotEnd (void)
+{
+   gui_pilotBatchFlush();
+   gui_pilot_batching = 0;
+}
+
+/**
+ * @brief Queues a pilot marker.
+ *
+ *    @param x X position of the marker.
+ *    @param y Y position of the marker.
+ *    @param scale Half-size of the marker.
+ *    @param dir Direction the marker is facing.
+ *    @param col Colour of the marker.
+ */
+static void gui_pilotBatchAdd( double x, double y, double scale, double dir, const glColour *col )
+{
+   /* Same corners and order as gl_circleVBO, split into two triangles. */
+   const GLfloat corners[GUI_PILOT_BATCH_VERTS][2] = {
+      { -1., -1. }, { 1., -1. }, { -1., 1. },
+      {  1., -1. }, { 1.,  1. }, { -1., 1. } };
+   double c, s;
+   int n;
+
+   if (gui_pilot_batch == NULL)
+      gui_pilot_batch = array_create_size( GLfloat, GUI_PILOT_BATCH_VERTS*GUI_PILOT_BATCH_FLOATS*64 );
+
+   c = cos(dir);
+   s = sin(dir);
+   n = array_size( gui_pilot_batch );
+   array_resize( &gui_pilot_batch, n + GUI_PILOT_BATCH_VERTS*GUI_PILOT_BATCH_FLOATS );
+   for (int i=0; i<GUI_PILOT_BATCH_VERTS; i++) {
+      double u = corners[i][0];
+      double v = corners[i][1];
+      GLfloat *d = &gui_pilot_batch[ n + i*GUI_PILOT_BATCH_FLOATS ];
+      d[0] = x + scale*(c*u - s*v);
+      d[1] = y + scale*(s*u + c*v);
+      d[2] = u;
+      d[3] = v;
+      d[4] = col->r;
+      d[5] = col->g;
+      d[6] = col->b;
+      d[7] = col->a;
+      d[8] = scale;
+   }
+
+   /* Not batching, so draw right away. */
+   if (!gui_pilot_batching)
+      gui_pilotBatchFlush();
+}
+
+/**
+ * @brief Draws the queued pilot markers.
+ */
+static void gui_pilotBatchFlush (void)
+{
+   GLsizei size, stride;
+   int n = array_size( gui_pilot_batch );
+   if (n <= 0)
+      return;
+
+   /* Upload, growing the VBO if needed. */
+   size = sizeof(GLfloat) * n;
+   if (size > gui_pilot_vboSize) {
+      gui_pilot_vboSize = sizeof(GLfloat) * array_reserved( gui_pilot_batch );
+      if (gui_pilot_vbo == NULL)
+         gui_pilot_vbo = gl_vboCreateStream( gui_pilot_vboSize, NULL );
+      else
+         gl_vboData( gui_pilot_vbo, gui_pilot_vboSize, NULL );
+   }
+   gl_vboSubData( gui_pilot_vbo, 0, size, gui_pilot_batch );
+
+   stride = sizeof(GLfloat) * GUI_PILOT_BATCH_FLOATS;
+   glUseProgram( shaders.pilotmarker.program );
+   glEnableVertexAttribArray( shaders.pilotmarker.vertex );
+   glEnableVertexAttribArray( shaders.pilotmarker.vertex_color );
+   glEnableVertexAttribArray( shaders.pilotmarker.vertex_dim );
+   gl_vboActivateAttribOffset( gui_pilot_vbo, shaders.pilotmarker.vertex,
+         0, 4, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( gui_pilot_vbo, shaders.pilotmarker.vertex_color,
+         sizeof(GLfloat) * 4, 4, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( gui_pilot_vbo, shaders.pilotmarker.vertex_dim,
+         sizeof(GLfloat) * 8, 1, GL_FLOAT, stride );
+   gl_Matrix4_Uniform( shaders.pilotmarker.projection, gl_view_matrix );
+
+   glDrawArrays( GL_TRIANGLES, 0, n / GUI_PILOT_BATCH_FLOATS );
+
+   glDisableVertexAttribArray( shaders.pilotmarker.vertex );
+   glDisableVertexAttribArray( shaders.pilotmarker.vertex_color );
+   glDisableVertexAttribArray( shaders.pilotmarker.vertex_dim );
+   glUseProgram( 0 );
+   gl_checkErr();
+
+   array_resize( &gui_pilot_batch, 0 );
+}
+
 /**
  * @brief Renders a pilot in the GUI radar.
  *
@@ -1122,8 +1245,10 @@ void gui_renderPilot( const Pilot* p, RadarShape shape, double w, double h, doub
             ((pow2(x)+pow2(y)) > pow2(w))) ) {
 
       /* Draw little targeted symbol. */
-      if (p->id == player.p->target && !overlay)
+      if (p->id == player.p->target && !overlay) {
+         gui_pilotBatchFlush();
          gui_renderRadarOutOfRange( shape, w, h, x, y, &cRadar_tPilot );
+      }
       return;
    }
 
@@ -1147,21 +1272,25 @@ void gui_renderPilot( const Pilot* p, RadarShape shape, double w, double h, doub
    if (pilot_isFlag(p, PILOT_HILIGHT)) {
       glColour highlighted = cRadar_hilight;
       highlighted.a = 0.3;
+      gui_pilotBatchFlush();
       glUseProgram( shaders.hilight.program );
       glUniform1f( shaders.hilight.dt, animation_dt );
       gl_renderShader( x, y, scale*2.0, scale*2.0, 0., &shaders.hilight, &highlighted, 1 );
    }
 
-   glUseProgram(shaders.pilotmarker.program);
-   gl_renderShader( x, y, scale, scale, p->solid->dir, &shaders.pilotmarker, col, 1 );
+   gui_pilotBatchAdd( x, y, scale, p->solid->dir, col );
 
    /* Draw selection if targeted. */
-   if (p->id == player.p->target)
+   if (p->id == player.p->target) {
+      gui_pilotBatchFlush();
       gui_blink( x, y, MAX(scale*2.,10.0), &cRadar_hilight, RADAR_BLINK_PILOT, blink_pilot);
+   }
 
    /* Draw name. */
-   if (overlay && pilot_isFlag(p, PILOT_HILIGHT))
+   if (overlay && pilot_isFlag(p, PILOT_HILIGHT)) {
+      gui_pilotBatchFlush();
       gl_printMarkerRaw( &gl_smallFont, x+scale+5., y-gl_smallFont.h/2., col, p->name );
+   }
 }
 
 /**
@@ -1968,6 +2097,11 @@ void gui_free (void)
 
    gl_vboDestroy( gui_radar_select_vbo );
    gui_radar_select_vbo = NULL;
+   gl_vboDestroy( gui_pilot_vbo );
+   gui_pilot_vbo = NULL;
+   gui_pilot_vboSize = 0;
+   array_free( gui_pilot_batch );
+   gui_pilot_batch = NULL;
 
    osd_exit();
 
@@ -65,6 +65,8 @@ int gui_radarClickEvent( SDL_Event* event );
 void gui_renderPlanet( int ind, RadarShape shape, double w, double h, double res, double alpha, int overlay );
 void gui_renderJumpPoint( int ind, RadarShape shape, double w, double h, double res, double alpha, int overlay );
 void gui_renderPilot( const Pilot* p, RadarShape shape, double w, double h, double res, int overlay );
+void gui_renderPilotBegin (void);
+void gui_renderPilotEnd (void);
 void gui_renderAsteroid( const Asteroid* a, double w, double h, double res, int overlay );
 void gui_renderPlayer( double res, int overlay );
 
@@ -865,10 +865,6 @@ static int hooks_executeParam( const char* stack, const HookParam *param )
    }
    hook_runningstack--; /* not running hooks anymore */
 
-   /* Check claims. */
-   if (run)
-      claim_activateAll();
-
    return run;
 }
 
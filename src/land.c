@@ -1000,6 +1000,7 @@ void land_genWindows( int load, int changetab )
    }
    land_wid = window_create( "wdwLand", _(p->name), -1, -1, w, h );
    window_onClose( land_wid, land_cleanupWindow );
+   window_setCache( land_wid, 1 ); /* Mostly static while landed. */
 
    /* Create tabbed window. */
    land_setupTabs();
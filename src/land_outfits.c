@@ -17,6 +17,7 @@
 #include "land_outfits.h"
 
 #include "array.h"
+#include "conf.h"
 #include "dialogue.h"
 #include "equipment.h"
 #include "hook.h"
@@ -175,6 +176,7 @@ void outfits_open( unsigned int wid, const Outfit **outfits )
    /* cust draws the modifier */
    window_addCust( wid, -40-bw, 60+2*bh,
          bw, bh, "cstMod", 0, outfits_renderMod, NULL, NULL, NULL, NULL );
+   window_custSetDynamic( wid, "cstMod", 0 ); /* Only changes with key input. */
 
    /* the descriptive text */
    window_addText( wid, 20 + iw + 20, -40,
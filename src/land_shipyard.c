@@ -18,6 +18,7 @@
 #include "land_shipyard.h"
 
 #include "array.h"
+#include "conf.h"
 #include "dialogue.h"
 #include "hook.h"
 #include "log.h"
@@ -106,6 +107,7 @@ void shipyard_open( unsigned int wid )
    /* slot types */
    window_addCust( wid, -20, -sh-50, sw-10, 80, "cstSlots", 0.,
          shipyard_renderSlots, NULL, NULL, NULL, NULL );
+   window_custSetDynamic( wid, "cstSlots", 0 ); /* Only changes with the selected ship. */
 
    /* stat text */
    window_addText( wid, -4, -sw-50-70-20, sw, -sh-60-70-20+h-bh, 0, "txtStats",
@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <time.h> /* strftime */
 #include "physfs.h"
+#include "SDL_thread.h"
 
 #include "naev.h"
 /** @endcond */
@@ -43,6 +44,56 @@ static int copying = 0;
 static PHYSFS_File *logout_file = NULL;
 static PHYSFS_File *logerr_file = NULL;
 
+/*
+ * Asynchronous writer.
+ *
+ * Messages are pushed into a bounded lock-free ring (Vyukov's MPMC queue) and
+ * written out by a background thread, so a burst of warnings doesn't stall the
+ * game on file I/O. The writer collapses repeated lines and limits how many
+ * distinct lines get written per second.
+ */
+#define LOG_RING_SIZE   1024     /**< Messages the ring can hold, must be a power of two. */
+#define LOG_RING_BYTES  (1<<20)  /**< Maximum bytes of text in the ring. */
+#define LOG_RATE_LINES  200      /**< Maximum distinct lines written per second. */
+#define LOG_RATE_PERIOD 1000     /**< Rate limiting period in ms. */
+
+/**
+ * @brief Slot of the message ring.
+ */
+typedef struct LogMsg_ {
+   SDL_atomic_t seq; /**< Sequence number, tells whether the slot is free or filled. */
+   FILE *stream;     /**< Stream the message goes to. */
+   char *str;        /**< Message text. */
+   int len;          /**< Length of the text. */
+} LogMsg;
+
+/**
+ * @brief State the writer keeps per output stream.
+ */
+typedef struct LogStream_ {
+   char *line;       /**< Line being assembled from messages without newline. */
+   size_t nline;     /**< Length of line. */
+   size_t mline;     /**< Allocated size of line. */
+   char *last;       /**< Last line written, to detect repeats. */
+   int repeat;       /**< Number of times last was repeated and not written. */
+} LogStream;
+
+static LogMsg log_ring[LOG_RING_SIZE]; /**< Message ring. */
+static SDL_atomic_t log_head; /**< Next position to write to. */
+static SDL_atomic_t log_tail; /**< Next position to read from. */
+static SDL_atomic_t log_bytes; /**< Bytes of text in the ring. */
+static SDL_atomic_t log_dropped; /**< Messages dropped because the ring was full. */
+static SDL_atomic_t log_quit; /**< Tells the writer to stop. */
+static SDL_sem *log_sem = NULL; /**< Wakes up the writer. */
+static SDL_Thread *log_thread = NULL; /**< Writer thread, NULL when writing synchronously. */
+static SDL_SpinLock log_drainLock = 0; /**< Only one thread may drain the ring. */
+static LogStream log_out; /**< Writer state for stdout. */
+static LogStream log_err; /**< Writer state for stderr. */
+static Uint32 log_rateStart = 0; /**< Start of the current rate limiting period. */
+static int log_rateLines = 0; /**< Lines written in the current period. */
+static int log_rateSuppressed = 0; /**< Lines suppressed in the current period. */
+static Uint32 log_lastPop = 0; /**< When a message was last popped from the ring. */
+
 /*
  * Prototypes
  */
@@ -50,6 +101,17 @@ static void log_copy( int enable );
 static void log_append( FILE *stream, char *str );
 static void log_cleanStream( PHYSFS_File **file, const char *fname, const char *filedouble );
 static void log_purge (void);
+/* Asynchronous writer. */
+static int log_push( FILE *stream, const char *str, int len );
+static int log_pop( FILE **stream, char **str, int *len );
+static void log_write( FILE *stream, const char *str, size_t len );
+static void log_writeLine( FILE *stream, LogStream *ls, const char *str, size_t len, int final );
+static void log_writeRepeat( FILE *stream, LogStream *ls );
+static void log_process( FILE *stream, const char *str, int len, int final );
+static void log_drain( int final );
+static int log_writer( void *data );
+static void log_startWriter (void);
+static void log_stopWriter (void);
 
 /**
  * @brief Like fprintf but also prints to the naev console.
@@ -93,6 +155,13 @@ int logprintf( FILE *stream, int newline, const char *fmt, ... )
    if (copying)
       log_append(stream, &buf[2]);
 
+   /* Leave the writing to the writer thread. */
+   if (log_thread != NULL) {
+      n = newline ? n+2 : n+1;
+      log_push( stream, &buf[2], n );
+      return n;
+   }
+
    if (stream == stdout && logout_file != NULL) {
       PHYSFS_writeBytes( logout_file, &buf[2], newline ? n+2 : n+1 );
       if (newline)
@@ -122,8 +191,10 @@ void log_redirect (void)
    struct tm *ts;
    char timestr[20];
 
-   if (!conf.redirect_file)
+   if (!conf.redirect_file) {
+      log_startWriter();
       return;
+   }
 
    time(&cur);
    ts = localtime(&cur);
@@ -142,6 +213,7 @@ void log_redirect (void)
    asprintf( &errfiledouble, "logs/%s_stderr.txt", timestr );
 
    log_copy(0);
+   log_startWriter();
 }
 
 /**
@@ -215,6 +287,7 @@ static void log_purge (void)
  */
 void log_clean (void)
 {
+   log_stopWriter();
    log_cleanStream( &logout_file, "logs/stdout.txt", outfiledouble );
    log_cleanStream( &logerr_file, "logs/stderr.txt", errfiledouble );
 }
@@ -278,3 +351,373 @@ copy_err:
    WARN(_("An error occurred while buffering %s!"),
       stream == stdout ? "stdout" : "stderr");
 }
+
+/**
+ * @brief Pushes a message into the ring.
+ *
+ * Safe to call from any thread, never blocks.
+ *
+ *    @param stream Destination stream (stdout or stderr).
+ *    @param str Message to push.
+ *    @param len Length of the message.
+ *    @return 0 on success, -1 if the message was dropped.
+ */
+static int log_push( FILE *stream, const char *str, int len )
+{
+   int pos;
+   LogMsg *m;
+
+   /* Keep memory bounded. */
+   if (SDL_AtomicAdd( &log_bytes, len ) + len > LOG_RING_BYTES) {
+      SDL_AtomicAdd( &log_bytes, -len );
+      SDL_AtomicIncRef( &log_dropped );
+      return -1;
+   }
+
+   /* Claim a slot. */
+   pos = SDL_AtomicGet( &log_head );
+   for (;;) {
+      int dif;
+      m   = &log_ring[ pos & (LOG_RING_SIZE-1) ];
+      dif = (int)((unsigned int)SDL_AtomicGet( &m->seq ) - (unsigned int)pos);
+      if (dif == 0) {
+         if (SDL_AtomicCAS( &log_head, pos, pos+1 ))
+            break;
+      }
+      else if (dif < 0) { /* Full. */
+         SDL_AtomicAdd( &log_bytes, -len );
+         SDL_AtomicIncRef( &log_dropped );
+         return -1;
+      }
+      pos = SDL_AtomicGet( &log_head );
+   }
+
+   /* Fill and publish it. */
+   m->stream = stream;
+   m->str    = malloc( len+1 );
+   memcpy( m->str, str, len );
+   m->str[len] = '\0';
+   m->len    = len;
+   SDL_AtomicSet( &m->seq, pos+1 );
+
+   SDL_SemPost( log_sem );
+   return 0;
+}
+
+/**
+ * @brief Pops a message from the ring.
+ *
+ * Must be called with log_drainLock held.
+ *
+ *    @param[out] stream Destination stream of the message.
+ *    @param[out] str Message, must be freed by the caller.
+ *    @param[out] len Length of the message.
+ *    @return 1 if a message was popped, 0 if the ring is empty.
+ */
+static int log_pop( FILE **stream, char **str, int *len )
+{
+   int pos = SDL_AtomicGet( &log_tail );
+   LogMsg *m = &log_ring[ pos & (LOG_RING_SIZE-1) ];
+
+   if ((int)((unsigned int)SDL_AtomicGet( &m->seq ) - (unsigned int)(pos+1)) < 0)
+      return 0;
+
+   *stream  = m->stream;
+   *str     = m->str;
+   *len     = m->len;
+   m->str   = NULL;
+   SDL_AtomicSet( &log_tail, pos+1 );
+   SDL_AtomicSet( &m->seq, pos+LOG_RING_SIZE );
+   SDL_AtomicAdd( &log_bytes, -*len );
+   return 1;
+}
+
+/**
+ * @brief Writes text to a stream and its log file.
+ */
+static void log_write( FILE *stream, const char *str, size_t len )
+{
+   if (stream == stdout && logout_file != NULL)
+      PHYSFS_writeBytes( logout_file, str, len );
+   else if (stream == stderr && logerr_file != NULL)
+      PHYSFS_writeBytes( logerr_file, str, len );
+   fwrite( str, 1, len, stream );
+}
+
+/**
+ * @brief Writes how many times the last line of a stream was repeated.
+ */
+static void log_writeRepeat( FILE *stream, LogStream *ls )
+{
+   char buf[STRMAX_SHORT];
+   int n;
+
+   if (ls->repeat <= 0)
+      return;
+
+   n = scnprintf( buf, sizeof(buf), n_("Last message repeated %d time.\n",
+            "Last message repeated %d times.\n", ls->repeat), ls->repeat );
+   log_write( stream, buf, n );
+   ls->repeat = 0;
+}
+
+/**
+ * @brief Writes a complete line, collapsing repeats and limiting the rate.
+ *
+ *    @param final Whether this is the final flush (e.g. a crash), in which
+ *           case the line is always written.
+ */
+static void log_writeLine( FILE *stream, LogStream *ls, const char *str, size_t len, int final )
+{
+   Uint32 t;
+
+   /* The last lines before a crash are the ones that matter. */
+   if (final) {
+      log_writeRepeat( stream, ls );
+      free( ls->last );
+      ls->last = strndup( str, len );
+      log_write( stream, str, len );
+      return;
+   }
+
+   /* Same as last time. */
+   if ((ls->last != NULL) && (strlen(ls->last) == len) &&
+         (strncmp( ls->last, str, len ) == 0)) {
+      ls->repeat++;
+      return;
+   }
+   log_writeRepeat( stream, ls );
+   free( ls->last );
+   ls->last = strndup( str, len );
+
+   /* Rate limiting. */
+   t = SDL_GetTicks();
+   if (t - log_rateStart >= LOG_RATE_PERIOD) {
+      log_rateStart = t;
+      log_rateLines = 0;
+   }
+   if (log_rateLines >= LOG_RATE_LINES) {
+      log_rateSuppressed++;
+      return;
+   }
+   log_rateLines++;
+
+   log_write( stream, str, len );
+}
+
+/**
+ * @brief Processes a message popped from the ring.
+ *
+ *    @param final Whether this is the final flush, bypassing the rate limit.
+ */
+static void log_process( FILE *stream, const char *str, int len, int final )
+{
+   LogStream *ls = (stream == stderr) ? &log_err : &log_out;
+   const char *nl;
+
+   /* Only whole lines can be compared, so assemble them first. */
+   while ((nl = memchr( str, '\n', len )) != NULL) {
+      size_t l = nl - str + 1;
+      if (ls->nline > 0) {
+         while (ls->nline + l > ls->mline) {
+            ls->mline = MAX( 2*ls->mline, BUFSIZ );
+            ls->line  = realloc( ls->line, ls->mline );
+         }
+         memcpy( &ls->line[ls->nline], str, l );
+         log_writeLine( stream, ls, ls->line, ls->nline + l, final );
+         ls->nline = 0;
+      }
+      else
+         log_writeLine( stream, ls, str, l, final );
+      str += l;
+      len -= l;
+   }
+
+   /* Keep the rest for later. */
+   if (len > 0) {
+      while (ls->nline + len > ls->mline) {
+         ls->mline = MAX( 2*ls->mline, BUFSIZ );
+         ls->line  = realloc( ls->line, ls->mline );
+      }
+      memcpy( &ls->line[ls->nline], str, len );
+      ls->nline += len;
+   }
+}
+
+/**
+ * @brief Writes out everything in the ring.
+ *
+ *    @param final Whether to also write out unfinished lines and pending counts.
+ */
+static void log_drain( int final )
+{
+   FILE *stream;
+   char *str, buf[STRMAX_SHORT];
+   int len, n, dropped, popped, wrote;
+   Uint32 t;
+
+   /* Say what the rate limit held back before the last lines go out. */
+   if (final && (log_rateSuppressed > 0)) {
+      n = scnprintf( buf, sizeof(buf), n_("%d log line suppressed.\n",
+               "%d log lines suppressed.\n", log_rateSuppressed), log_rateSuppressed );
+      log_write( stderr, buf, n );
+      log_rateSuppressed = 0;
+   }
+
+   popped = 0;
+   while (log_pop( &stream, &str, &len )) {
+      log_process( stream, str, len, final );
+      free( str );
+      popped++;
+   }
+   t = SDL_GetTicks();
+   if (popped > 0)
+      log_lastPop = t;
+   wrote = (popped > 0);
+
+   /* Report what got lost. */
+   dropped = SDL_AtomicSet( &log_dropped, 0 );
+   if (dropped > 0) {
+      n = scnprintf( buf, sizeof(buf), n_("%d log message dropped.\n",
+               "%d log messages dropped.\n", dropped), dropped );
+      log_write( stderr, buf, n );
+      wrote = 1;
+   }
+   if ((log_rateSuppressed > 0) && (final ||
+            (t - log_rateStart >= LOG_RATE_PERIOD))) {
+      n = scnprintf( buf, sizeof(buf), n_("%d log line suppressed.\n",
+               "%d log lines suppressed.\n", log_rateSuppressed), log_rateSuppressed );
+      log_write( stderr, buf, n );
+      log_rateSuppressed = 0;
+      wrote = 1;
+   }
+
+   /* Things went quiet, so report repeats instead of waiting for a new line.
+    * An empty drain alone doesn't mean quiet, it may just be a leftover wake
+    * from a burst that an earlier drain already handled. */
+   if (final || (t - log_lastPop >= LOG_RATE_PERIOD)) {
+      if ((log_out.repeat > 0) || (log_err.repeat > 0))
+         wrote = 1;
+      log_writeRepeat( stdout, &log_out );
+      log_writeRepeat( stderr, &log_err );
+   }
+   if (final) {
+      if (log_out.nline > 0)
+         log_write( stdout, log_out.line, log_out.nline );
+      if (log_err.nline > 0)
+         log_write( stderr, log_err.line, log_err.nline );
+      log_out.nline = 0;
+      log_err.nline = 0;
+   }
+
+   /* Flush once per batch instead of per line, and not at all if nothing
+    * was written. */
+   if (!final && !wrote)
+      return;
+   if (logout_file != NULL)
+      PHYSFS_flush( logout_file );
+   if (logerr_file != NULL)
+      PHYSFS_flush( logerr_file );
+   fflush( stdout );
+   fflush( stderr );
+}
+
+/**
+ * @brief Writer thread.
+ */
+static int log_writer( void *data )
+{
+   (void) data;
+
+   while (!SDL_AtomicGet( &log_quit )) {
+      /* Time out to report repeated lines once things go quiet. */
+      SDL_SemWaitTimeout( log_sem, LOG_RATE_PERIOD );
+      /* Every message posts, but one drain handles the whole burst. */
+      while (SDL_SemTryWait( log_sem ) == 0)
+         ;
+      SDL_AtomicLock( &log_drainLock );
+      log_drain( 0 );
+      SDL_AtomicUnlock( &log_drainLock );
+   }
+
+   return 0;
+}
+
+/**
+ * @brief Starts writing the logs from a background thread.
+ */
+static void log_startWriter (void)
+{
+   if (log_thread != NULL)
+      return;
+
+   for (int i=0; i<LOG_RING_SIZE; i++)
+      SDL_AtomicSet( &log_ring[i].seq, i );
+   SDL_AtomicSet( &log_head, 0 );
+   SDL_AtomicSet( &log_tail, 0 );
+   SDL_AtomicSet( &log_bytes, 0 );
+   SDL_AtomicSet( &log_dropped, 0 );
+   SDL_AtomicSet( &log_quit, 0 );
+
+   log_sem = SDL_CreateSemaphore( 0 );
+   if (log_sem == NULL) {
+      WARN(_("Unable to create log semaphore: %s"), SDL_GetError());
+      return;
+   }
+   log_thread = SDL_CreateThread( log_writer, "log_writer", NULL );
+   if (log_thread == NULL) {
+      SDL_DestroySemaphore( log_sem );
+      log_sem = NULL;
+      WARN(_("Unable to create log thread: %s"), SDL_GetError());
+      return;
+   }
+
+   /* Don't lose messages if something calls exit() directly. */
+   atexit( log_flush );
+}
+
+/**
+ * @brief Stops the writer thread, writing out everything left.
+ */
+static void log_stopWriter (void)
+{
+   if (log_thread == NULL)
+      return;
+
+   SDL_AtomicSet( &log_quit, 1 );
+   SDL_SemPost( log_sem );
+   SDL_WaitThread( log_thread, NULL );
+   log_thread = NULL;
+
+   /* Nothing else drains now. */
+   log_drain( 1 );
+   SDL_DestroySemaphore( log_sem );
+   log_sem = NULL;
+
+   free( log_out.line );
+   free( log_out.last );
+   free( log_err.line );
+   free( log_err.last );
+   memset( &log_out, 0, sizeof(LogStream) );
+   memset( &log_err, 0, sizeof(LogStream) );
+}
+
+/**
+ * @brief Writes out all the pending log messages right away.
+ *
+ * Meant for crashes, where the writer thread won't get a chance to.
+ */
+void log_flush (void)
+{
+   if (log_thread == NULL)
+      return;
+
+   /* The writer may be the one crashing, so don't wait on it forever. */
+   for (int i=0; !SDL_AtomicTryLock( &log_drainLock ); i++) {
+      if (i >= 100)
+         return;
+      SDL_Delay( 1 );
+   }
+   log_drain( 1 );
+   SDL_AtomicUnlock( &log_drainLock );
+}
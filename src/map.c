@@ -42,6 +42,34 @@ typedef struct FactionPresence_ {
    int known;        /**< Whether or not the faction is known. */
 } FactionPresence;
 
+/**
+ * @brief Map geometry that is built once and drawn with a single draw call.
+ *
+ * Vertices are stored in universe coordinates so panning and zooming only
+ * change uniforms. The geometry gets rebuilt when the map is set up (which
+ * is when knowledge, diffs and the like may have changed), when the map
+ * mode changes, or when map_geomDirty is called because system flags
+ * changed while a map is open.
+ */
+/**
+ * @brief Vertices of map geometry belonging to a single system.
+ */
+typedef struct MapGeometrySpan_ {
+   int sys;          /**< Index of the system. */
+   GLint first;      /**< First vertex. */
+   GLsizei count;    /**< Number of vertices. */
+} MapGeometrySpan;
+
+typedef struct MapGeometry_ {
+   GLfloat *data;    /**< Vertex data (array.h). */
+   MapGeometrySpan *spans; /**< Vertices of each system (array.h), only kept when culling. */
+   gl_vbo *vbo;      /**< VBO holding the vertex data. */
+   GLsizei vbosize;  /**< Size of the VBO in bytes. */
+   int nfloats;      /**< Floats per vertex. */
+   int dirty;        /**< Needs to be rebuilt. */
+   int mode;         /**< Map mode it was built for. */
+} MapGeometry;
+
 /**
  * @brief Different map modes available to the player.
  */
@@ -84,6 +112,9 @@ static int listMapModeVisible = 0; /**< Whether the map mode list widget is visi
 static double commod_av_gal_price = 0; /**< Average price across the galaxy. */
 static double map_dt     = 0.; /**< Nebula animation stuff. */
 static int map_minimal_mode = 0; /**< Map is in minimal mode. */
+static MapGeometry map_geom_faction = { .nfloats=4+4+1, .dirty=1 }; /**< Faction disk geometry. */
+static MapGeometry map_geom_jumps   = { .nfloats=4+4+4+4, .dirty=1 }; /**< Jump lane geometry. */
+static MapGeometry map_geom_systems = { .nfloats=4+4+2, .dirty=1 }; /**< System disk geometry. */
 
 /*
  * extern
@@ -107,6 +138,15 @@ static void map_renderMarkers( double x, double y, double r, double a );
 static void map_renderCommod( double bx, double by, double x, double y,
                               double w, double h, double r, int editor );
 static void map_renderCommodIgnorance( double x, double y, StarSystem *sys, Commodity *c );
+static void map_geomQuad( MapGeometry *g, double x, double y, const GLfloat *attr );
+static void map_geomBegin( MapGeometry *g );
+static void map_geomEnd( MapGeometry *g, int editor );
+static void map_geomAttrib( MapGeometry *g, GLuint attrib, int offset, int size );
+static void map_geomFree( MapGeometry *g );
+static void map_buildFactionDisks( int editor );
+static void map_buildJumps( int editor );
+static void map_buildSystemCircle( const StarSystem *sys, double scale, const glColour *col, int filled );
+static void map_buildSystems( int editor );
 static void map_drawMarker( double x, double y, double r, double a,
       int num, int cur, int type );
 /* Mouse. */
@@ -141,6 +181,10 @@ int map_init (void)
  */
 void map_exit (void)
 {
+   map_geomFree( &map_geom_faction );
+   map_geomFree( &map_geom_jumps );
+   map_geomFree( &map_geom_systems );
+
    if (decorator_stack != NULL) {
       for (int i=0; i<array_size(decorator_stack); i++)
          gl_freeTexture( decorator_stack[i].image );
@@ -212,6 +256,22 @@ static void map_setup (void)
 
    /* mark systems as needed */
    mission_sysMark();
+
+   /* Knowledge may have changed, so rebuild the geometry. */
+   map_geomDirty();
+}
+
+/**
+ * @brief Marks the cached map geometry as stale.
+ *
+ * Must be called whenever the system flags it depends on (known, hidden and
+ * the mission markers) change, it gets rebuilt on the next render.
+ */
+void map_geomDirty (void)
+{
+   map_geom_faction.dirty = 1;
+   map_geom_jumps.dirty   = 1;
+   map_geom_systems.dirty = 1;
 }
 
 /**
@@ -656,7 +716,6 @@ static void map_update( unsigned int wid )
    }
    buf[0] = '\0';
    p = 0;
-   /*snprintf(buf, sizeof(buf), "%f\n", sys->prices[0]);*/ /*Hack to control prices. */
    for (int i=PLANET_SERVICE_MISSIONS; i<=PLANET_SERVICE_SHIPYARD; i<<=1)
       if (services & i)
          p += scnprintf( &buf[p], sizeof(buf)-p, "%s\n", _(planet_getServiceName(i)) );
@@ -996,13 +1055,107 @@ void map_renderDecorators( double x, double y, int editor, double alpha )
 }
 
 /**
- * @brief Renders the faction disks.
+ * @brief Adds a quad to map geometry.
+ *
+ *    @param g Geometry to add to.
+ *    @param x X position of the centre in universe coordinates.
+ *    @param y Y position of the centre in universe coordinates.
+ *    @param attr Remaining per-vertex attributes (g->nfloats-4 of them).
  */
-void map_renderFactionDisks( double x, double y, double r, int editor, double alpha )
+static void map_geomQuad( MapGeometry *g, double x, double y, const GLfloat *attr )
+{
+   /* Same corners as gl_circleVBO, split into two triangles. */
+   const GLfloat corners[6][2] = {
+      { -1., -1. }, { 1., -1. }, { -1., 1. },
+      {  1., -1. }, { 1.,  1. }, { -1., 1. } };
+   int n = array_size( g->data );
+
+   array_resize( &g->data, n + 6*g->nfloats );
+   for (int i=0; i<6; i++) {
+      GLfloat *d = &g->data[ n + i*g->nfloats ];
+      d[0] = x;
+      d[1] = y;
+      d[2] = corners[i][0];
+      d[3] = corners[i][1];
+      memcpy( &d[4], attr, sizeof(GLfloat) * (g->nfloats-4) );
+   }
+}
+
+/**
+ * @brief Starts (re)building map geometry.
+ */
+static void map_geomBegin( MapGeometry *g )
+{
+   if (g->data == NULL)
+      g->data = array_create( GLfloat );
+   array_resize( &g->data, 0 );
+   if (g->spans != NULL)
+      array_resize( &g->spans, 0 );
+}
+
+/**
+ * @brief Uploads freshly built map geometry.
+ *
+ *    @param g Geometry to upload.
+ *    @param editor Whether it was built for the editor, in which case it is not kept.
+ */
+static void map_geomEnd( MapGeometry *g, int editor )
+{
+   GLsizei size = sizeof(GLfloat) * array_size( g->data );
+   g->dirty = editor;
+   g->mode  = map_mode;
+   if (size <= 0)
+      return;
+   if (size > g->vbosize) {
+      g->vbosize = sizeof(GLfloat) * array_reserved( g->data );
+      if (g->vbo == NULL)
+         g->vbo = gl_vboCreateStatic( g->vbosize, NULL );
+      else
+         gl_vboData( g->vbo, g->vbosize, NULL );
+   }
+   gl_vboSubData( g->vbo, 0, size, g->data );
+}
+
+/**
+ * @brief Enables and binds a vertex attribute of map geometry.
+ *
+ *    @param g Geometry to bind.
+ *    @param attrib Shader attribute location.
+ *    @param offset Offset in floats within the vertex.
+ *    @param size Number of floats of the attribute.
+ */
+static void map_geomAttrib( MapGeometry *g, GLuint attrib, int offset, int size )
+{
+   glEnableVertexAttribArray( attrib );
+   gl_vboActivateAttribOffset( g->vbo, attrib, sizeof(GLfloat) * offset,
+         size, GL_FLOAT, sizeof(GLfloat) * g->nfloats );
+}
+
+/**
+ * @brief Frees map geometry.
+ */
+static void map_geomFree( MapGeometry *g )
 {
+   array_free( g->data );
+   g->data = NULL;
+   array_free( g->spans );
+   g->spans = NULL;
+   gl_vboDestroy( g->vbo );
+   g->vbo = NULL;
+   g->vbosize = 0;
+   g->dirty = 1;
+}
+
+/**
+ * @brief Builds the faction disk geometry.
+ */
+static void map_buildFactionDisks( int editor )
+{
+   MapGeometry *g = &map_geom_faction;
+   map_geomBegin( g );
    for (int i=0; i<array_size(systems_stack); i++) {
-      glColour c;
-      double tx, ty;
+      const glColour *col;
+      GLfloat attr[5];
       StarSystem *sys = system_getIndex( i );
 
       if (sys_isFlag(sys,SYSTEM_HIDDEN))
@@ -1011,28 +1164,53 @@ void map_renderFactionDisks( double x, double y, double r, int editor, double al
       if ((!sys_isFlag(sys, SYSTEM_HAS_KNOWN_LANDABLE) || !sys_isKnown(sys)) && !editor)
          continue;
 
-      tx = x + sys->pos.x*map_zoom;
-      ty = y + sys->pos.y*map_zoom;
-
       /* System has faction and is known or we are in editor. */
-      if (sys->faction != -1) {
-         const glColour *col;
-         double presence = sqrt(sys->ownerpresence);
-
-         /* draws the disk representing the faction */
-         double sr = (40. + presence * 3.) * map_zoom * 0.5;
-
-         col = faction_colour(sys->faction);
-         c.r = col->r;
-         c.g = col->g;
-         c.b = col->b;
-         c.a = 0.6 * alpha;
-
-         glUseProgram(shaders.factiondisk.program);
-         glUniform1f(shaders.factiondisk.paramf, r / sr );
-         gl_renderShader( tx, ty, sr, sr, 0., &shaders.factiondisk, &c, 1 );
-      }
+      if (sys->faction == -1)
+         continue;
+
+      col = faction_colour(sys->faction);
+      attr[0] = col->r;
+      attr[1] = col->g;
+      attr[2] = col->b;
+      attr[3] = 0.6;
+      /* Radius of the disk representing the faction, scaled by zoom in the shader. */
+      attr[4] = (40. + sqrt(sys->ownerpresence) * 3.) * 0.5;
+      map_geomQuad( g, sys->pos.x, sys->pos.y, attr );
    }
+   map_geomEnd( g, editor );
+}
+
+/**
+ * @brief Renders the faction disks.
+ */
+void map_renderFactionDisks( double x, double y, double r, int editor, double alpha )
+{
+   gl_Matrix4 projection;
+   MapGeometry *g = &map_geom_faction;
+
+   if (editor || g->dirty)
+      map_buildFactionDisks( editor );
+   if (array_size(g->data) <= 0)
+      return;
+
+   projection = gl_Matrix4_Translate( gl_view_matrix, x, y, 0 );
+
+   glUseProgram( shaders.factiondisk.program );
+   gl_Matrix4_Uniform( shaders.factiondisk.projection, projection );
+   glUniform1f( shaders.factiondisk.zoom, map_zoom );
+   glUniform1f( shaders.factiondisk.radius, r );
+   glUniform1f( shaders.factiondisk.alpha, alpha );
+   map_geomAttrib( g, shaders.factiondisk.vertex, 0, 4 );
+   map_geomAttrib( g, shaders.factiondisk.vertex_color, 4, 4 );
+   map_geomAttrib( g, shaders.factiondisk.vertex_radius, 8, 1 );
+
+   glDrawArrays( GL_TRIANGLES, 0, array_size(g->data) / g->nfloats );
+
+   glDisableVertexAttribArray( shaders.factiondisk.vertex );
+   glDisableVertexAttribArray( shaders.factiondisk.vertex_color );
+   glDisableVertexAttribArray( shaders.factiondisk.vertex_radius );
+   glUseProgram(0);
+   gl_checkErr();
 }
 
 /**
@@ -1092,12 +1270,13 @@ void map_renderSystemEnvironment( double x, double y, int editor, double alpha )
 }
 
 /**
- * @brief Renders the jump routes between systems.
+ * @brief Builds the jump route geometry.
  */
-void map_renderJumps( double x, double y, double radius, int editor )
+static void map_buildJumps( int editor )
 {
+   MapGeometry *g = &map_geom_jumps;
+   map_geomBegin( g );
    for (int i=0; i<array_size(systems_stack); i++) {
-      double x1,y1;
       StarSystem *sys = system_getIndex( i );
 
       if (sys_isFlag(sys,SYSTEM_HIDDEN))
@@ -1106,12 +1285,10 @@ void map_renderJumps( double x, double y, double radius, int editor )
       if (!sys_isKnown(sys) && !editor)
          continue; /* we don't draw hyperspace lines */
 
-      x1 = x + sys->pos.x * map_zoom;
-      y1 = y + sys->pos.y * map_zoom;
-
       for (int j=0; j < array_size(sys->jumps); j++) {
-         double x2,y2, rx,ry, r, rw,rh;
+         double rx,ry, r, rh;
          const glColour *col, *cole;
+         GLfloat attr[12];
          StarSystem *jsys = sys->jumps[j].target;
          if (sys_isFlag(jsys,SYSTEM_HIDDEN))
             continue;
@@ -1136,13 +1313,6 @@ void map_renderJumps( double x, double y, double radius, int editor )
          else
             col = &cAquaBlue;
 
-         x2 = x + jsys->pos.x * map_zoom;
-         y2 = y + jsys->pos.y * map_zoom;
-         rx = x2-x1;
-         ry = y2-y1;
-         r  = atan2( ry, rx );
-         rw = MOD(rx,ry)/2.;
-
          if (sys->jumps[j].hide<=0.) {
             col = &cGreen;
             rh = 2.5;
@@ -1151,23 +1321,89 @@ void map_renderJumps( double x, double y, double radius, int editor )
             rh = 1.5;
          }
 
-         glUseProgram( shaders.jumplane.program );
-         gl_uniformColor( shaders.jumplane.paramv, cole );
-         glUniform1f( shaders.jumplane.paramf, radius );
-         gl_renderShader( (x1+x2)/2., (y1+y2)/2., rw, rh, r, &shaders.jumplane, col, 1 );
+         rx = jsys->pos.x - sys->pos.x;
+         ry = jsys->pos.y - sys->pos.y;
+         r  = atan2( ry, rx );
+
+         attr[0]  = col->r;
+         attr[1]  = col->g;
+         attr[2]  = col->b;
+         attr[3]  = col->a;
+         attr[4]  = cole->r;
+         attr[5]  = cole->g;
+         attr[6]  = cole->b;
+         attr[7]  = cole->a;
+         attr[8]  = cos(r);
+         attr[9]  = sin(r);
+         attr[10] = MOD(rx,ry)/2.; /* Half length, scaled by zoom in the shader. */
+         attr[11] = rh;
+         map_geomQuad( g, (sys->pos.x+jsys->pos.x)/2., (sys->pos.y+jsys->pos.y)/2., attr );
       }
    }
+   map_geomEnd( g, editor );
 }
 
 /**
- * @brief Renders the systems.
+ * @brief Renders the jump routes between systems.
  */
-void map_renderSystems( double bx, double by, double x, double y,
-      double w, double h, double r, int editor)
+void map_renderJumps( double x, double y, double radius, int editor )
+{
+   gl_Matrix4 projection;
+   MapGeometry *g = &map_geom_jumps;
+
+   if (editor || g->dirty)
+      map_buildJumps( editor );
+   if (array_size(g->data) <= 0)
+      return;
+
+   projection = gl_Matrix4_Translate( gl_view_matrix, x, y, 0 );
+
+   glUseProgram( shaders.jumplane.program );
+   gl_Matrix4_Uniform( shaders.jumplane.projection, projection );
+   glUniform1f( shaders.jumplane.zoom, map_zoom );
+   glUniform1f( shaders.jumplane.radius, radius );
+   map_geomAttrib( g, shaders.jumplane.vertex, 0, 4 );
+   map_geomAttrib( g, shaders.jumplane.vertex_color, 4, 4 );
+   map_geomAttrib( g, shaders.jumplane.vertex_color2, 8, 4 );
+   map_geomAttrib( g, shaders.jumplane.vertex_lane, 12, 4 );
+
+   glDrawArrays( GL_TRIANGLES, 0, array_size(g->data) / g->nfloats );
+
+   glDisableVertexAttribArray( shaders.jumplane.vertex );
+   glDisableVertexAttribArray( shaders.jumplane.vertex_color );
+   glDisableVertexAttribArray( shaders.jumplane.vertex_color2 );
+   glDisableVertexAttribArray( shaders.jumplane.vertex_lane );
+   glUseProgram(0);
+   gl_checkErr();
+}
+
+/**
+ * @brief Adds a system circle to the system geometry.
+ */
+static void map_buildSystemCircle( const StarSystem *sys, double scale, const glColour *col, int filled )
+{
+   GLfloat attr[6];
+   attr[0] = col->r;
+   attr[1] = col->g;
+   attr[2] = col->b;
+   attr[3] = col->a;
+   attr[4] = scale; /* Relative to the system radius. */
+   attr[5] = filled;
+   map_geomQuad( &map_geom_systems, sys->pos.x, sys->pos.y, attr );
+}
+
+/**
+ * @brief Builds the system geometry for the current map mode.
+ */
+static void map_buildSystems( int editor )
 {
+   MapGeometry *g = &map_geom_systems;
+   map_geomBegin( g );
+   if (g->spans == NULL)
+      g->spans = array_create( MapGeometrySpan );
    for (int i=0; i<array_size(systems_stack); i++) {
       const glColour *col;
-      double tx, ty;
+      MapGeometrySpan *span;
       StarSystem *sys = system_getIndex( i );
 
       if (sys_isFlag(sys,SYSTEM_HIDDEN))
@@ -1178,16 +1414,14 @@ void map_renderSystems( double bx, double by, double x, double y,
            && !space_sysReachable(sys)) && !editor)
          continue;
 
-      tx = x + sys->pos.x*map_zoom;
-      ty = y + sys->pos.y*map_zoom;
-
-      /* Skip if out of bounds. */
-      if (!rectOverlap(tx-r, ty-r, 2.*r, 2.*r, bx, by, w, h))
-         continue;
+      /* Remember the vertices of the system so they can be culled. */
+      span        = &array_grow( &g->spans );
+      span->sys   = i;
+      span->first = array_size(g->data) / g->nfloats;
 
       /* Draw an outer ring. */
       if (map_mode == MAPMODE_TRAVEL || map_mode == MAPMODE_TRADE)
-         gl_renderCircle( tx, ty, r, &cInert, 0 );
+         map_buildSystemCircle( sys, 1., &cInert, 0 );
 
       /* Ignore not known systems when not in the editor. */
       if (!editor && !sys_isKnown(sys))
@@ -1214,19 +1448,85 @@ void map_renderSystems( double bx, double by, double x, double y,
          else
             col = &cNeutral;
 
-         if (editor) {
-            /* Radius slightly shorter. */
-            gl_renderCircle( tx, ty, 0.5 * r, col, 1 );
-         }
-         else
-            gl_renderCircle( tx, ty, 0.65 * r, col, 1 );
+         /* Radius slightly shorter in the editor. */
+         map_buildSystemCircle( sys, editor ? 0.5 : 0.65, col, 1 );
       }
       else if (map_mode == MAPMODE_DISCOVER) {
-         gl_renderCircle( tx, ty, r, &cInert, 0 );
+         map_buildSystemCircle( sys, 1., &cInert, 0 );
          if (sys_isFlag( sys, SYSTEM_DISCOVERED ))
-            gl_renderCircle( tx, ty,  0.65 * r, &cGreen, 1 );
+            map_buildSystemCircle( sys, 0.65, &cGreen, 1 );
+      }
+   }
+
+   /* Systems are skipped with continue above, so close the spans here. */
+   for (int i=0; i<array_size(g->spans); i++) {
+      GLint end = (i+1 < array_size(g->spans)) ? g->spans[i+1].first :
+            (GLint)(array_size(g->data) / g->nfloats);
+      g->spans[i].count = end - g->spans[i].first;
+   }
+   map_geomEnd( g, editor );
+}
+
+/**
+ * @brief Renders the systems.
+ *
+ * Systems outside of the widget are culled, the visible ones are drawn with
+ * one call per run of consecutive visible systems, so a fully visible map is
+ * still a single call.
+ */
+void map_renderSystems( double bx, double by, double x, double y,
+      double w, double h, double r, int editor)
+{
+   gl_Matrix4 projection;
+   MapGeometry *g = &map_geom_systems;
+   GLint first;
+   GLsizei count;
+
+   if (editor || g->dirty || (g->mode != (int)map_mode))
+      map_buildSystems( editor );
+   if (array_size(g->data) <= 0)
+      return;
+
+   projection = gl_Matrix4_Translate( gl_view_matrix, x, y, 0 );
+
+   glUseProgram( shaders.mapsystem.program );
+   gl_Matrix4_Uniform( shaders.mapsystem.projection, projection );
+   glUniform1f( shaders.mapsystem.zoom, map_zoom );
+   glUniform1f( shaders.mapsystem.radius, r );
+   map_geomAttrib( g, shaders.mapsystem.vertex, 0, 4 );
+   map_geomAttrib( g, shaders.mapsystem.vertex_color, 4, 4 );
+   map_geomAttrib( g, shaders.mapsystem.vertex_param, 8, 2 );
+
+   first = 0;
+   count = 0;
+   for (int i=0; i<array_size(g->spans); i++) {
+      const MapGeometrySpan *span = &g->spans[i];
+      const StarSystem *sys = system_getIndex( span->sys );
+      double tx = x + sys->pos.x*map_zoom;
+      double ty = y + sys->pos.y*map_zoom;
+
+      /* Skip if out of bounds. */
+      if ((span->count <= 0) || !rectOverlap(tx-r, ty-r, 2.*r, 2.*r, bx, by, w, h))
+         continue;
+
+      /* Extend the current run or start a new one. */
+      if ((count > 0) && (first+count == span->first))
+         count += span->count;
+      else {
+         if (count > 0)
+            glDrawArrays( GL_TRIANGLES, first, count );
+         first = span->first;
+         count = span->count;
       }
    }
+   if (count > 0)
+      glDrawArrays( GL_TRIANGLES, first, count );
+
+   glDisableVertexAttribArray( shaders.mapsystem.vertex );
+   glDisableVertexAttribArray( shaders.mapsystem.vertex_color );
+   glDisableVertexAttribArray( shaders.mapsystem.vertex_param );
+   glUseProgram(0);
+   gl_checkErr();
 }
 
 /**
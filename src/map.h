@@ -31,6 +31,7 @@ void map_select( const StarSystem *sys, char shifted );
 void map_cleanup (void);
 void map_clear (void);
 void map_jump (void);
+void map_geomDirty (void);
 
 /* manipulate universe stuff */
 StarSystem **map_getJumpPath( const char *sysstart, const char *sysend, int ignore_known, int show_hidden,
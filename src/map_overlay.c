@@ -731,6 +731,7 @@ void ovr_render( double dt )
    /* Render pilots. */
    Pilot *const* pstk = pilot_getAll();
    int t = 0;
+   gui_renderPilotBegin();
    for (int i=0; i<array_size(pstk); i++) {
       if (pstk[i]->id == PLAYER_ID) /* Skip player. */
          continue;
@@ -739,6 +740,7 @@ void ovr_render( double dt )
       else
          gui_renderPilot( pstk[i], RADAR_RECT, w, h, res, 1 );
    }
+   gui_renderPilotEnd();
 
    /* Stealth rendering. */
    if (pilot_isFlag( player.p, PILOT_STEALTH )) {
@@ -17,11 +17,13 @@
 
 #include "array.h"
 #include "cond.h"
+#include "conf.h"
 #include "faction.h"
 #include "gui_osd.h"
 #include "hook.h"
 #include "land.h"
 #include "log.h"
+#include "map.h"
 #include "ndata.h"
 #include "nlua.h"
 #include "nlua_faction.h"
@@ -39,6 +41,48 @@
 
 #define XML_MISSION_TAG       "mission" /**< XML mission tag. */
 
+#define MISSION_NLOC          (MIS_AVAIL_SPACE+1) /**< Number of mission locations. */
+#define MISSION_QUERY_SLOW    5. /**< Queries taking longer than this many ms get logged in devmode. */
+
+/**
+ * @brief A mission keyed by the planet or system it is restricted to.
+ */
+typedef struct MissionKeyName_ {
+   const char *name; /**< Planet or system name, owned by the mission data. */
+   int id; /**< Mission in mission_stack. */
+} MissionKeyName;
+
+/**
+ * @brief A mission keyed by one of the factions it is restricted to.
+ */
+typedef struct MissionKeyFaction_ {
+   int faction; /**< Faction. */
+   int id; /**< Mission in mission_stack. */
+} MissionKeyFaction;
+
+/**
+ * @brief Missions available at a location, split by their most selective
+ *        restriction so only plausible candidates get their conditional run.
+ */
+typedef struct MissionIndex_ {
+   MissionKeyName *planets; /**< Array (array.h): Missions restricted to a planet, sorted by name. */
+   MissionKeyName *systems; /**< Array (array.h): Missions restricted to a system, sorted by name. */
+   MissionKeyFaction *factions; /**< Array (array.h): Missions restricted to factions, sorted by faction. */
+   int *generic; /**< Array (array.h): Missions without restrictions. */
+   int n; /**< Number of missions at the location. */
+} MissionIndex;
+
+/**
+ * @brief How many missions made it past each stage of an availability check.
+ */
+typedef struct MissionStats_ {
+   int candidates; /**< Candidates from the index. */
+   int location; /**< Matching planet, system and faction. */
+   int unique; /**< Not already done or running if unique. */
+   int cond; /**< Passing the Lua conditional. */
+   int done; /**< Having the previous mission done. */
+} MissionStats;
+
 /*
  * current player missions
  */
@@ -49,6 +93,7 @@ Mission *player_missions[MISSION_MAX]; /**< Player's active missions. */
  * mission stack
  */
 static MissionData *mission_stack = NULL; /**< Unmutable after creation */
+static MissionIndex mission_index[MISSION_NLOC]; /**< Missions indexed by location. */
 
 /*
  * prototypes
@@ -61,9 +106,20 @@ static void mission_freeData( MissionData* mission );
 /* Matching. */
 static int mission_compare( const void* arg1, const void* arg2 );
 static int mission_meetReq( int mission, int faction,
-      const char* planet, const char* sysname );
+      const char* planet, const char* sysname, MissionStats *stats );
 static int mission_matchFaction( MissionData* misn, int faction );
 static int mission_location( const char *loc );
+static void missions_buildIndex (void);
+static void missions_freeIndex (void);
+static int mission_cmpKeyName( const void *a, const void *b );
+static int mission_cmpKeyFaction( const void *a, const void *b );
+static int mission_cmpInt( const void *a, const void *b );
+static void missions_addCandidatesName( int **candidates,
+      const MissionKeyName *keys, const char *name );
+static int *missions_getCandidates( int loc, int faction,
+      const char *planet, const char *sysname, MissionStats *stats );
+static void missions_dumpStats( int loc, int created,
+      const MissionStats *stats, Uint64 t0 );
 /* Loading. */
 static int missions_cmp( const void *a, const void *b );
 static int mission_parseFile( const char* file, MissionData *temp );
@@ -220,32 +276,37 @@ int mission_alreadyRunning( const MissionData* misn )
  *    @param faction Faction of the current planet.
  *    @param planet Name of the current planet.
  *    @param sysname Name of the current system.
+ *    @param[in,out] stats Statistics of the query the check is part of.
  *    @return 1 if requirements are met, 0 if they aren't.
  */
 static int mission_meetReq( int mission, int faction,
-      const char* planet, const char* sysname )
+      const char* planet, const char* sysname, MissionStats *stats )
 {
    MissionData* misn = mission_get( mission );
    if (misn == NULL) /* In case it doesn't exist */
       return 0;
 
    /* If planet, must match planet. */
-   if ((misn->avail.planet != NULL) && (strcmp(misn->avail.planet,planet)!=0))
+   if ((misn->avail.planet != NULL) &&
+         ((planet == NULL) || (strcmp(misn->avail.planet,planet)!=0)))
       return 0;
 
    /* If system, must match system. */
-   if ((misn->avail.system != NULL) && (strcmp(misn->avail.system,sysname)!=0))
+   if ((misn->avail.system != NULL) &&
+         ((sysname == NULL) || (strcmp(misn->avail.system,sysname)!=0)))
       return 0;
 
    /* Match faction. */
    if ((faction >= 0) && !mission_matchFaction(misn,faction))
       return 0;
+   stats->location++;
 
    /* Must not be already done or running if unique. */
    if (mis_isFlag(misn,MISSION_UNIQUE) &&
          (player_missionAlreadyDone(mission) ||
           mission_alreadyRunning(misn)))
       return 0;
+   stats->unique++;
 
    /* Must meet Lua condition. */
    if (misn->avail.cond != NULL) {
@@ -257,11 +318,13 @@ static int mission_meetReq( int mission, int faction,
       else if (!c)
          return 0;
    }
+   stats->cond++;
 
    /* Must meet previous mission requirements. */
    if ((misn->avail.done != NULL) &&
          (player_missionAlreadyDone( mission_getID(misn->avail.done) ) == 0))
       return 0;
+   stats->done++;
 
   return 1;
 }
@@ -276,15 +339,18 @@ static int mission_meetReq( int mission, int faction,
  */
 void missions_run( int loc, int faction, const char* planet, const char* sysname )
 {
-   for (int i=0; i<array_size(mission_stack); i++) {
+   MissionStats stats;
+   Uint64 t0 = SDL_GetPerformanceCounter();
+   int *candidates = missions_getCandidates( loc, faction, planet, sysname, &stats );
+   int created = 0;
+
+   for (int k=0; k<array_size(candidates); k++) {
       Mission mission;
       double chance;
+      int i = candidates[k];
       MissionData *misn = &mission_stack[i];
 
-      if (misn->avail.loc != loc)
-         continue;
-
-      if (!mission_meetReq(i, faction, planet, sysname))
+      if (!mission_meetReq(i, faction, planet, sysname, &stats))
          continue;
 
       chance = (double)(misn->avail.chance % 100)/100.;
@@ -294,8 +360,12 @@ void missions_run( int loc, int faction, const char* planet, const char* sysname
       if (RNGF() < chance) {
          mission_init( &mission, misn, 1, 1, NULL );
          mission_cleanup(&mission); /* it better clean up for itself or we do it */
+         created++;
       }
    }
+   array_free( candidates );
+
+   missions_dumpStats( loc, created, &stats, t0 );
 }
 
 /**
@@ -484,6 +554,9 @@ void mission_sysMark (void)
          space_addMarker( m->objid, m->type );
       }
    }
+
+   /* Marked systems are part of the map geometry. */
+   map_geomDirty();
 }
 
 /**
@@ -537,6 +610,9 @@ const StarSystem* mission_sysComputerMark( const Mission* misn )
       if (firstsys==NULL)
          firstsys = sys;
    }
+
+   /* Marked systems are part of the map geometry. */
+   map_geomDirty();
    return firstsys;
 }
 
@@ -799,43 +875,49 @@ Mission* missions_genList( int *n, int faction,
    int m, alloced;
    int rep;
    Mission* tmp;
+   int *candidates;
+   MissionStats stats;
+   Uint64 t0 = SDL_GetPerformanceCounter();
 
    /* Find available missions. */
    tmp      = NULL;
    m        = 0;
    alloced  = 0;
-   for (int i=0; i<array_size(mission_stack); i++) {
+   candidates = missions_getCandidates( loc, faction, planet, sysname, &stats );
+   for (int k=0; k<array_size(candidates); k++) {
+      int i = candidates[k];
       MissionData *misn = &mission_stack[i];
-      if (misn->avail.loc == loc) {
-         double chance;
+      double chance;
 
-         /* Must meet requirements. */
-         if (!mission_meetReq(i, faction, planet, sysname))
-            continue;
+      /* Must meet requirements. */
+      if (!mission_meetReq(i, faction, planet, sysname, &stats))
+         continue;
 
-         /* Must hit chance. */
-         chance = (double)(misn->avail.chance % 100)/100.;
-         if (chance == 0.) /* We want to consider 100 -> 100% not 0% */
-            chance = 1.;
-         rep = MAX(1, misn->avail.chance / 100);
-
-         for (int j=0; j<rep; j++) /* random chance of rep appearances */
-            if (RNGF() < chance) {
-               m++;
-               /* Extra allocation. */
-               if (m > alloced) {
-                  if (alloced == 0)
-                     alloced = 32;
-                  else
-                     alloced *= 2;
-                  tmp      = realloc( tmp, sizeof(Mission) * alloced );
-               }
-               /* Initialize the mission. */
-               if (mission_init( &tmp[m-1], misn, 1, 1, NULL ))
-                  m--;
+      /* Must hit chance. */
+      chance = (double)(misn->avail.chance % 100)/100.;
+      if (chance == 0.) /* We want to consider 100 -> 100% not 0% */
+         chance = 1.;
+      rep = MAX(1, misn->avail.chance / 100);
+
+      for (int j=0; j<rep; j++) /* random chance of rep appearances */
+         if (RNGF() < chance) {
+            m++;
+            /* Extra allocation. */
+            if (m > alloced) {
+               if (alloced == 0)
+                  alloced = 32;
+               else
+                  alloced *= 2;
+               tmp      = realloc( tmp, sizeof(Mission) * alloced );
             }
-      }
+            /* Initialize the mission. */
+            if (mission_init( &tmp[m-1], misn, 1, 1, NULL ))
+               m--;
+         }
    }
+   array_free( candidates );
+
+   missions_dumpStats( loc, m, &stats, t0 );
 
    /* Sort. */
    if (tmp != NULL) {
@@ -848,6 +930,223 @@ Mission* missions_genList( int *n, int faction,
    return tmp;
 }
 
+/**
+ * @brief Compares missions keyed by name, keeping mission_stack order within a name.
+ */
+static int mission_cmpKeyName( const void *a, const void *b )
+{
+   const MissionKeyName *ka = a;
+   const MissionKeyName *kb = b;
+   int ret = strcmp( ka->name, kb->name );
+   if (ret != 0)
+      return ret;
+   return ka->id - kb->id;
+}
+
+/**
+ * @brief Compares missions keyed by faction, keeping mission_stack order within a faction.
+ */
+static int mission_cmpKeyFaction( const void *a, const void *b )
+{
+   const MissionKeyFaction *ka = a;
+   const MissionKeyFaction *kb = b;
+   if (ka->faction != kb->faction)
+      return ka->faction - kb->faction;
+   return ka->id - kb->id;
+}
+
+/**
+ * @brief Indexes the missions by location and by their most selective
+ *        restriction: planet, then system, then factions.
+ *
+ * Must be rebuilt whenever mission_stack is sorted or a mission is reloaded.
+ */
+static void missions_buildIndex (void)
+{
+   missions_freeIndex();
+
+   for (int l=0; l<MISSION_NLOC; l++) {
+      MissionIndex *idx = &mission_index[l];
+      idx->planets   = array_create( MissionKeyName );
+      idx->systems   = array_create( MissionKeyName );
+      idx->factions  = array_create( MissionKeyFaction );
+      idx->generic   = array_create( int );
+   }
+
+   for (int i=0; i<array_size(mission_stack); i++) {
+      const MissionAvail_t *avail = &mission_stack[i].avail;
+      MissionIndex *idx;
+
+      if ((avail->loc < 0) || (avail->loc >= MISSION_NLOC))
+         continue;
+      idx = &mission_index[ avail->loc ];
+      idx->n++;
+
+      if (avail->planet != NULL) {
+         MissionKeyName *k = &array_grow( &idx->planets );
+         k->name  = avail->planet;
+         k->id    = i;
+      }
+      else if (avail->system != NULL) {
+         MissionKeyName *k = &array_grow( &idx->systems );
+         k->name  = avail->system;
+         k->id    = i;
+      }
+      else if (array_size(avail->factions) > 0) {
+         for (int j=0; j<array_size(avail->factions); j++) {
+            MissionKeyFaction *k = &array_grow( &idx->factions );
+            k->faction  = avail->factions[j];
+            k->id       = i;
+         }
+      }
+      else
+         array_push_back( &idx->generic, i );
+   }
+
+   for (int l=0; l<MISSION_NLOC; l++) {
+      MissionIndex *idx = &mission_index[l];
+      qsort( idx->planets, array_size(idx->planets), sizeof(MissionKeyName), mission_cmpKeyName );
+      qsort( idx->systems, array_size(idx->systems), sizeof(MissionKeyName), mission_cmpKeyName );
+      qsort( idx->factions, array_size(idx->factions), sizeof(MissionKeyFaction), mission_cmpKeyFaction );
+   }
+}
+
+/**
+ * @brief Frees the mission index.
+ */
+static void missions_freeIndex (void)
+{
+   for (int l=0; l<MISSION_NLOC; l++) {
+      MissionIndex *idx = &mission_index[l];
+      array_free( idx->planets );
+      array_free( idx->systems );
+      array_free( idx->factions );
+      array_free( idx->generic );
+      memset( idx, 0, sizeof(MissionIndex) );
+   }
+}
+
+/**
+ * @brief Adds the missions keyed by a name to the candidates.
+ */
+static void missions_addCandidatesName( int **candidates,
+      const MissionKeyName *keys, const char *name )
+{
+   int lo = 0;
+   int hi = array_size(keys);
+
+   /* Lower bound. */
+   while (lo < hi) {
+      int mid = (lo+hi)/2;
+      if (strcmp( keys[mid].name, name ) < 0)
+         lo = mid+1;
+      else
+         hi = mid;
+   }
+   for (int i=lo; (i<array_size(keys)) && (strcmp(keys[i].name,name)==0); i++)
+      array_push_back( candidates, keys[i].id );
+}
+
+/**
+ * @brief Compares integers for sorting the candidates.
+ */
+static int mission_cmpInt( const void *a, const void *b )
+{
+   return *(const int*)a - *(const int*)b;
+}
+
+/**
+ * @brief Gets the missions that may be available, in mission_stack order.
+ *
+ * Only filters by location, planet, system and faction, mission_meetReq still
+ *  has to be run on them.
+ *
+ *    @param loc Location to match.
+ *    @param faction Faction of the planet, -1 to accept all factions.
+ *    @param planet Name of the planet or NULL.
+ *    @param sysname Name of the system or NULL.
+ *    @param[out] stats Statistics of the query, reset here.
+ *    @return Array (array.h) of candidates, to be freed by the caller.
+ */
+static int *missions_getCandidates( int loc, int faction,
+      const char *planet, const char *sysname, MissionStats *stats )
+{
+   const MissionIndex *idx;
+   int *candidates;
+   int n;
+
+   /* Missions created while iterating may query again, so each query gets
+    * its own array and statistics. */
+   memset( stats, 0, sizeof(MissionStats) );
+   candidates = array_create( int );
+   if ((loc < 0) || (loc >= MISSION_NLOC))
+      return candidates;
+   idx = &mission_index[loc];
+
+   if (planet != NULL)
+      missions_addCandidatesName( &candidates, idx->planets, planet );
+   if (sysname != NULL)
+      missions_addCandidatesName( &candidates, idx->systems, sysname );
+   if (faction >= 0) {
+      int lo = 0;
+      int hi = array_size(idx->factions);
+      /* Lower bound. */
+      while (lo < hi) {
+         int mid = (lo+hi)/2;
+         if (idx->factions[mid].faction < faction)
+            lo = mid+1;
+         else
+            hi = mid;
+      }
+      for (int i=lo; (i<array_size(idx->factions)) && (idx->factions[i].faction==faction); i++)
+         array_push_back( &candidates, idx->factions[i].id );
+   }
+   else {
+      /* Any faction goes, duplicates are dropped below. */
+      for (int i=0; i<array_size(idx->factions); i++)
+         array_push_back( &candidates, idx->factions[i].id );
+   }
+   for (int i=0; i<array_size(idx->generic); i++)
+      array_push_back( &candidates, idx->generic[i] );
+
+   /* Keep the priority order of mission_stack and drop duplicates. */
+   qsort( candidates, array_size(candidates), sizeof(int), mission_cmpInt );
+   n = 0;
+   for (int i=0; i<array_size(candidates); i++)
+      if ((n==0) || (candidates[n-1] != candidates[i]))
+         candidates[n++] = candidates[i];
+   array_resize( &candidates, n );
+
+   stats->candidates = n;
+   return candidates;
+}
+
+/**
+ * @brief Prints how many missions each stage of a slow query filtered out.
+ *
+ *    @param loc Location that was queried.
+ *    @param created Number of missions created.
+ *    @param stats Statistics of the query.
+ *    @param t0 Performance counter when the query started.
+ */
+static void missions_dumpStats( int loc, int created,
+      const MissionStats *stats, Uint64 t0 )
+{
+   int total;
+   double ms;
+   if (!conf.devmode)
+      return;
+
+   ms = 1000. * (double)(SDL_GetPerformanceCounter()-t0) / (double)SDL_GetPerformanceFrequency();
+   if (ms <= MISSION_QUERY_SLOW)
+      return;
+
+   total = ((loc >= 0) && (loc < MISSION_NLOC)) ? mission_index[loc].n : 0;
+   DEBUG( _("Slow missions query at location %d (%.3f ms): %d indexed, %d candidates, %d matched location, %d unique, %d passed conditional, %d passed done, %d created."),
+         loc, ms, total, stats->candidates, stats->location,
+         stats->unique, stats->cond, stats->done, created );
+}
+
 /**
  * @brief Gets location based on a human readable string.
  *
@@ -995,6 +1294,7 @@ int missions_load (void)
 
    /* Sort based on priority so higher priority missions can establish claims first. */
    qsort( mission_stack, array_size(mission_stack), sizeof(MissionData), missions_cmp );
+   missions_buildIndex();
 
    DEBUG( n_("Loaded %d Mission", "Loaded %d Missions", array_size(mission_stack) ), array_size(mission_stack) );
 
@@ -1090,6 +1390,7 @@ void missions_free (void)
       mission_freeData( &mission_stack[i] );
    array_free( mission_stack );
    mission_stack = NULL;
+   missions_freeIndex();
 
    /* Free the player mission stack. */
    for (int i=0; i<MISSION_MAX; i++)
@@ -1414,8 +1715,10 @@ static int missions_parseActive( xmlNodePtr parent )
             }
 
             /* Claims. */
-            if (xml_isNode(cur,"claims"))
+            if (xml_isNode(cur,"claims")) {
                misn->claims = claim_xmlLoad( cur );
+               claim_setOwner( misn->claims, misn->data->name );
+            }
 
             if (xml_isNode(cur,"lua"))
                /* start the unpersist routine */
@@ -1439,8 +1742,11 @@ int mission_reload( const char *name )
       return -1;
    save = *temp;
    res = mission_parseFile( save.sourcefile, temp );
-   if (res == 0)
+   if (res == 0) {
       mission_freeData( &save );
+      /* The index points into the old data. */
+      missions_buildIndex();
+   }
    else
       *temp = save;
    return res;
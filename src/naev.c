@@ -36,6 +36,7 @@
 #include "console.h"
 #include "damagetype.h"
 #include "debug.h"
+#include "dev_stats.h"
 #include "dialogue.h"
 #include "economy.h"
 #include "env.h"
@@ -763,6 +764,9 @@ void main_loop( int update )
    render_all( game_dt, real_dt );
    /* Draw buffer. */
    SDL_GL_SwapWindow( gl_screen.window );
+
+   /* Close the Lua statistics of the frame. */
+   nlua_gcFrame();
 }
 
 
@@ -932,6 +936,8 @@ void display_fps( const double dt )
    if (conf.fps_show) {
       gl_print( NULL, x, y, &cFontWhite, "%3.2f", fps );
       y -= gl_defFont.h + 5.;
+      if (conf.devmode)
+         dstats_render( x, &y );
    }
 
    if ((player.p != NULL) && !player_isFlag(PLAYER_DESTROYED) &&
@@ -12,6 +12,7 @@
 
 #include "nebula.h"
 
+#include "array.h"
 #include "camera.h"
 #include "conf.h"
 #include "gui.h"
@@ -25,6 +26,10 @@
 
 #define NEBULA_PUFFS         32 /**< Amount of puffs to generate */
 #define NEBULA_PUFF_BUFFER   300 /**< Nebula buffer */
+#define NEBULA_PUFF_SIZE     64 /**< Largest puff, also the size of an atlas cell. */
+#define NEBULA_PUFF_COLS     8  /**< Columns of puffs in the atlas. */
+#define NEBULA_PUFF_VERTS    6  /**< Vertices per batched puff. */
+#define NEBULA_PUFF_FLOATS   8  /**< Floats per batched puff vertex. */
 
 /* Nebula properties */
 static double nebu_hue = 0.; /**< The hue. */
@@ -43,8 +48,22 @@ static GLfloat nebu_render_w= 0.;
 static GLfloat nebu_render_h= 0.;
 static gl_Matrix4 nebu_render_P;
 
+/**
+ * @brief Location of a puff in the puff atlas.
+ */
+typedef struct NebulaPuffTex_ {
+   int x; /**< X offset in the atlas, in pixels. */
+   int y; /**< Y offset in the atlas, in pixels. */
+   int w; /**< Width of the puff. */
+   int h; /**< Height of the puff. */
+} NebulaPuffTex;
+
 /* puff textures */
-static glTexture *nebu_pufftexs[NEBULA_PUFFS]; /**< Nebula puffs. */
+static glTexture *nebu_puffAtlas = NULL; /**< All the nebula puffs in a single texture. */
+static NebulaPuffTex nebu_pufftexs[NEBULA_PUFFS]; /**< Nebula puffs in the atlas. */
+static GLfloat *nebu_puffData = NULL; /**< Array (array.h): Vertices of the puffs being rendered. */
+static gl_vbo *nebu_puffVBO = NULL; /**< VBO the puffs are streamed through. */
+static GLsizei nebu_puffVBOSize = 0; /**< Size of nebu_puffVBO in bytes. */
 
 /**
  * @struct NebulaPuff
@@ -66,7 +85,8 @@ static double puff_y          = 0.;
 /*
  * prototypes
  */
-static SDL_Surface* nebu_surfaceFromNebulaMap( float* map, const int w, const int h );
+static void nebu_blitNebulaMap( SDL_Surface *sur, const float* map,
+      const NebulaPuffTex *pt );
 /* Puffs. */
 static void nebu_generatePuffs (void);
 static void nebu_renderPuffs( int below_player );
@@ -141,8 +161,13 @@ double nebu_getSightRadius (void)
 void nebu_exit (void)
 {
    /* Free the puffs. */
-   for (int i=0; i<NEBULA_PUFFS; i++)
-      gl_freeTexture( nebu_pufftexs[i] );
+   gl_freeTexture( nebu_puffAtlas );
+   nebu_puffAtlas = NULL;
+   array_free( nebu_puffData );
+   nebu_puffData = NULL;
+   gl_vboDestroy( nebu_puffVBO );
+   nebu_puffVBO = NULL;
+   nebu_puffVBOSize = 0;
 
    if (nebu_dofbo) {
       glDeleteFramebuffers( 1, &nebu_fbo );
@@ -298,20 +323,38 @@ void nebu_renderOverlay( const double dt )
 /**
  * @brief Renders the puffs.
  *
+ * All the puffs of a layer share the atlas, so they are drawn with a single
+ *  draw call.
+ *
  *    @param below_player Render the puffs below player or above player?
  */
 static void nebu_renderPuffs( int below_player )
 {
+   /* Corners of gl_squareVBO, split into two triangles. */
+   const GLfloat corners[NEBULA_PUFF_VERTS][2] = {
+      { 0., 0. }, { 1., 0. }, { 0., 1. },
+      { 1., 0. }, { 1., 1. }, { 0., 1. } };
+   GLsizei size, stride;
+   GLfloat aw, ah;
+   int n;
+
    /* Main menu shouldn't have puffs */
-   if (menu_isOpen(MENU_MAIN))
+   if (menu_isOpen(MENU_MAIN) || (nebu_puffAtlas == NULL))
       return;
 
+   if (nebu_puffData == NULL)
+      nebu_puffData = array_create( GLfloat );
+   array_resize( &nebu_puffData, 0 );
+   aw = nebu_puffAtlas->w;
+   ah = nebu_puffAtlas->h;
+
    for (int i=0; i<nebu_npuffs; i++) {
       NebulaPuff *puff = &nebu_puffs[i];
 
       /* Separate by layers */
       if ((below_player && (puff->height < 1.)) ||
             (!below_player && (puff->height > 1.))) {
+         const NebulaPuffTex *pt = &nebu_pufftexs[puff->tex];
          glColour col;
 
          /* calculate new position */
@@ -328,12 +371,56 @@ static void nebu_renderPuffs( int below_player )
          else if (puff->y < -NEBULA_PUFF_BUFFER)
             puff->y += SCREEN_H + 2*NEBULA_PUFF_BUFFER;
 
-         /* Render */
+         /* Queue */
          col_blend( &col, &puff->col, &cBlack, conf.nebu_brightness );
-         gl_renderStatic( nebu_pufftexs[puff->tex],
-               puff->x, puff->y, &col );
+         n = array_size( nebu_puffData );
+         array_resize( &nebu_puffData, n + NEBULA_PUFF_VERTS*NEBULA_PUFF_FLOATS );
+         for (int j=0; j<NEBULA_PUFF_VERTS; j++) {
+            GLfloat *d = &nebu_puffData[ n + j*NEBULA_PUFF_FLOATS ];
+            d[0] = puff->x + corners[j][0] * pt->w;
+            d[1] = puff->y + corners[j][1] * pt->h;
+            d[2] = (pt->x + corners[j][0] * pt->w) / aw;
+            d[3] = (pt->y + corners[j][1] * pt->h) / ah;
+            d[4] = col.r;
+            d[5] = col.g;
+            d[6] = col.b;
+            d[7] = col.a;
+         }
       }
    }
+
+   n = array_size( nebu_puffData );
+   if (n <= 0)
+      return;
+
+   /* Upload, growing the VBO if needed. */
+   size = sizeof(GLfloat) * n;
+   if (size > nebu_puffVBOSize) {
+      nebu_puffVBOSize = sizeof(GLfloat) * array_reserved( nebu_puffData );
+      if (nebu_puffVBO == NULL)
+         nebu_puffVBO = gl_vboCreateStream( nebu_puffVBOSize, NULL );
+      else
+         gl_vboData( nebu_puffVBO, nebu_puffVBOSize, NULL );
+   }
+   gl_vboSubData( nebu_puffVBO, 0, size, nebu_puffData );
+
+   stride = sizeof(GLfloat) * NEBULA_PUFF_FLOATS;
+   glUseProgram( shaders.texture_batch.program );
+   glBindTexture( GL_TEXTURE_2D, nebu_puffAtlas->texture );
+   glEnableVertexAttribArray( shaders.texture_batch.vertex );
+   glEnableVertexAttribArray( shaders.texture_batch.vertex_color );
+   gl_vboActivateAttribOffset( nebu_puffVBO, shaders.texture_batch.vertex,
+         0, 4, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( nebu_puffVBO, shaders.texture_batch.vertex_color,
+         sizeof(GLfloat) * 4, 4, GL_FLOAT, stride );
+   gl_Matrix4_Uniform( shaders.texture_batch.projection, gl_view_matrix );
+
+   glDrawArrays( GL_TRIANGLES, 0, n / NEBULA_PUFF_FLOATS );
+
+   glDisableVertexAttribArray( shaders.texture_batch.vertex );
+   glDisableVertexAttribArray( shaders.texture_batch.vertex_color );
+   glUseProgram( 0 );
+   gl_checkErr();
 }
 
 /**
@@ -399,47 +486,67 @@ void nebu_prep( double density, double volatility, double hue )
 
 /**
  * @brief Generates nebula puffs.
+ *
+ * The puff maps are generated in parallel and packed into a single atlas
+ *  texture so they can be rendered in a batch.
  */
 static void nebu_generatePuffs (void)
 {
+   int w[NEBULA_PUFFS], h[NEBULA_PUFFS];
+   float *maps[NEBULA_PUFFS];
+   SDL_Surface *sur;
+
+   /* Choose the sizes here so the RNG is only used from this thread. */
+   for (int i=0; i<NEBULA_PUFFS; i++) {
+      NebulaPuffTex *pt = &nebu_pufftexs[i];
+      w[i] = h[i] = RNG(20,NEBULA_PUFF_SIZE);
+      pt->x = (i % NEBULA_PUFF_COLS) * NEBULA_PUFF_SIZE;
+      pt->y = (i / NEBULA_PUFF_COLS) * NEBULA_PUFF_SIZE;
+      pt->w = w[i];
+      pt->h = h[i];
+   }
+
    /* Generate the nebula puffs */
+   if (noise_genNebulaPuffMaps( NEBULA_PUFFS, w, h, 1., maps ) != 0)
+      return;
+
+   /* Pack them into the atlas, fully transparent between puffs. */
+   sur = SDL_CreateRGBSurface( SDL_SWSURFACE,
+         NEBULA_PUFF_COLS * NEBULA_PUFF_SIZE,
+         (NEBULA_PUFFS + NEBULA_PUFF_COLS - 1) / NEBULA_PUFF_COLS * NEBULA_PUFF_SIZE,
+         32, RGBAMASK );
+   SDL_FillRect( sur, NULL, RMASK + BMASK + GMASK );
    for (int i=0; i<NEBULA_PUFFS; i++) {
-      /* Generate the nebula */
-      int w, h;
-      w = h = RNG(20,64);
-      float *nebu = noise_genNebulaPuffMap( w, h, 1. );
-      SDL_Surface *sur = nebu_surfaceFromNebulaMap( nebu, w, h );
-      free(nebu);
-
-      /* Load the texture */
-      nebu_pufftexs[i] = gl_loadImage( sur, 0 );
+      nebu_blitNebulaMap( sur, maps[i], &nebu_pufftexs[i] );
+      free( maps[i] );
    }
+
+   /* Load the texture */
+   nebu_puffAtlas = gl_loadImage( sur, 0 );
 }
 
 /**
- * @brief Generates a SDL_Surface from a 2d nebula map
+ * @brief Writes a 2d nebula map into a region of a surface.
  *
+ *    @param sur Surface to write to.
  *    @param map Nebula map to use.
- *    @param w Map width.
- *    @param h Map height.
- *    @return A SDL Surface with the nebula.
+ *    @param pt Region of the surface to write to.
  */
-static SDL_Surface* nebu_surfaceFromNebulaMap( float* map, const int w, const int h )
+static void nebu_blitNebulaMap( SDL_Surface *sur, const float* map,
+      const NebulaPuffTex *pt )
 {
-   SDL_Surface *sur;
    uint32_t *pix;
-
-   /* the good surface */
-   sur = SDL_CreateRGBSurface( SDL_SWSURFACE, w, h, 32, RGBAMASK );
-   pix = sur->pixels;
+   int pitch;
 
    /* convert from mapping to actual colours */
    SDL_LockSurface( sur );
-   for (int i=0; i<h*w; i++) {
-      double c = map[i];
-      pix[i] = RMASK + BMASK + GMASK + (AMASK & (uint32_t)((double)AMASK*c));
+   pix   = sur->pixels;
+   pitch = sur->pitch / sizeof(uint32_t);
+   for (int y=0; y<pt->h; y++) {
+      for (int x=0; x<pt->w; x++) {
+         double c = map[y*pt->w + x];
+         pix[(pt->y+y)*pitch + pt->x+x] = RMASK + BMASK + GMASK + (AMASK & (uint32_t)((double)AMASK*c));
+      }
    }
    SDL_UnlockSurface( sur );
-
-   return sur;
 }
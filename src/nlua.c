@@ -47,6 +47,13 @@
 lua_State *naevL = NULL;
 nlua_env __NLUA_CURENV = LUA_NOREF;
 
+/*
+ * Interned userdata statistics.
+ */
+static unsigned int nlua_intern_alloc  = 0; /**< Interned userdata allocated this frame. */
+static unsigned int nlua_intern_reused = 0; /**< Pushes served by interned userdata this frame. */
+static NLuaGCStats nlua_gc_last = { .alloc = 0, .reused = 0, .memory = 0. }; /**< Statistics of the last frame. */
+
 /*
  * prototypes
  */
@@ -700,3 +707,60 @@ int nlua_reffield( int objref, const char *name )
    lua_pop(naevL, 1);
    return LUA_NOREF;
 }
+
+/**
+ * @brief Pushes a cache of interned userdata.
+ *
+ * The cache lives in the registry of the state and has weak values, so
+ *  userdata no longer referenced from Lua can still be collected.
+ *
+ *    @param L State to get the cache of.
+ *    @param name Name of the cache.
+ */
+void nlua_internCache( lua_State *L, const char *name )
+{
+   lua_getfield( L, LUA_REGISTRYINDEX, name );  /* c */
+   if (lua_istable( L, -1 ))
+      return;
+   lua_pop( L, 1 );                             /* */
+   lua_newtable( L );                           /* c */
+   lua_newtable( L );                           /* c, m */
+   lua_pushstring( L, "v" );                    /* c, m, "v" */
+   lua_setfield( L, -2, "__mode" );             /* c, m */
+   lua_setmetatable( L, -2 );                   /* c */
+   lua_pushvalue( L, -1 );                      /* c, c */
+   lua_setfield( L, LUA_REGISTRYINDEX, name );  /* c */
+}
+
+/**
+ * @brief Counts a push of interned userdata.
+ *
+ *    @param reused Whether the userdata was reused instead of allocated.
+ */
+void nlua_internCount( int reused )
+{
+   if (reused)
+      nlua_intern_reused++;
+   else
+      nlua_intern_alloc++;
+}
+
+/**
+ * @brief Closes the statistics of the current frame, should be called once per frame.
+ */
+void nlua_gcFrame (void)
+{
+   nlua_gc_last.alloc   = nlua_intern_alloc;
+   nlua_gc_last.reused  = nlua_intern_reused;
+   nlua_gc_last.memory  = (naevL != NULL) ? (double)lua_gc( naevL, LUA_GCCOUNT, 0 ) : 0.;
+   nlua_intern_alloc    = 0;
+   nlua_intern_reused   = 0;
+}
+
+/**
+ * @brief Gets the userdata statistics of the last frame.
+ */
+const NLuaGCStats* nlua_gcStats (void)
+{
+   return &nlua_gc_last;
+}
@@ -16,6 +16,16 @@
    (lua_isnoneornil(L,ind) ? (def) : checkfunc(L,ind))
 
 typedef int nlua_env;
+
+/**
+ * @brief Statistics on the userdata created by pushing objects to Lua.
+ */
+typedef struct NLuaGCStats_ {
+   unsigned int alloc;  /**< Userdata allocated during the last frame. */
+   unsigned int reused; /**< Pushes served by interned userdata during the last frame. */
+   double memory;       /**< Memory used by Lua in KiB at the end of the last frame. */
+} NLuaGCStats;
+
 extern lua_State *naevL;
 extern nlua_env __NLUA_CURENV;
 
@@ -42,3 +52,11 @@ int nlua_pcall( nlua_env env, int nargs, int nresults );
 int nlua_refenv( nlua_env env, const char *name );
 int nlua_refenvtype( nlua_env env, const char *name, int type );
 int nlua_reffield( int objref, const char *name );
+
+/*
+ * interned userdata
+ */
+void nlua_internCache( lua_State *L, const char *name );
+void nlua_internCount( int reused );
+void nlua_gcFrame (void);
+const NLuaGCStats* nlua_gcStats (void);
@@ -16,6 +16,7 @@
 
 #include "nlua_evt.h"
 
+#include "conf.h"
 #include "event.h"
 #include "land.h"
 #include "log.h"
@@ -308,6 +309,7 @@ static int evtL_claim( lua_State *L )
 {
    Claim_t *claim;
    Event_t *cur_event;
+   const char *holder;
    int onlytest;
 
    /* Get current event. */
@@ -351,13 +353,17 @@ static int evtL_claim( lua_State *L )
    }
 
    /* Test claim. */
-   if (claim_test( claim )) {
+   holder = claim_conflict( claim );
+   if (holder != NULL) {
+      if (conf.devmode)
+         DEBUG(_("'%s' claim conflicts with claim held by '%s'"), event_dataName( cur_event->data ), holder);
       claim_destroy( claim );
       lua_pushboolean(L,0);
       return 1;
    }
 
    /* Set the claim. */
+   claim_setOwner( claim, event_dataName( cur_event->data ) );
    cur_event->claims = claim;
    claim_activate( claim );
    lua_pushboolean(L,1);
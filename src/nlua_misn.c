@@ -17,6 +17,7 @@
 #include "nlua_misn.h"
 
 #include "array.h"
+#include "conf.h"
 #include "gui_osd.h"
 #include "land.h"
 #include "log.h"
@@ -988,6 +989,7 @@ static int misn_claim( lua_State *L )
 {
    Claim_t *claim;
    Mission *cur_mission;
+   const char *holder;
    int onlytest;
 
    /* Get mission. */
@@ -1030,13 +1032,17 @@ static int misn_claim( lua_State *L )
    }
 
    /* Test claim. */
-   if (claim_test( claim )) {
+   holder = claim_conflict( claim );
+   if (holder != NULL) {
+      if (conf.devmode)
+         DEBUG(_("'%s' claim conflicts with claim held by '%s'"), cur_mission->data->name, holder);
       claim_destroy( claim );
       lua_pushboolean(L,0);
       return 1;
    }
 
    /* Set the claim. */
+   claim_setOwner( claim, cur_mission->data->name );
    cur_mission->claims = claim;
    claim_activate( claim );
    lua_pushboolean(L,1);
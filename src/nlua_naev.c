@@ -14,6 +14,8 @@
 
 #include "nlua_naev.h"
 
+#include "dev_stats.h"
+#include "economy.h"
 #include "input.h"
 #include "land.h"
 #include "log.h"
@@ -21,11 +23,32 @@
 #include "nlua_misn.h"
 #include "nluadef.h"
 #include "nstring.h"
+#include "perlin.h"
+#include "pilot.h"
 #include "player.h"
 #include "semver.h"
+#include "tech.h"
+#include "weapon.h"
 
 static int cache_table = LUA_NOREF; /* No reference. */
 
+#if DEBUGGING
+/**
+ * @brief Benchmarks that can be run on demand with naev.benchmark().
+ */
+static const struct {
+   const char *name;    /**< Name to run the benchmark by. */
+   void (*func)(void);  /**< Runs the benchmark, logging the results. */
+} naev_benchmarks[] = {
+   { "pilot_handles", pilot_handleBenchmark },
+   { "weapon_asteroids", weapon_benchmarkAsteroids },
+   { "nebula_puffs", noise_benchmarkPuffs },
+   { "tech", tech_benchmark },
+   { "economy", economy_benchmark },
+   { NULL, NULL }
+};
+#endif /* DEBUGGING */
+
 /* Naev methods. */
 static int naevL_version( lua_State *L );
 static int naevL_versionTest( lua_State *L);
@@ -44,6 +67,9 @@ static int naevL_isSimulation( lua_State *L );
 static int naevL_conf( lua_State *L );
 static int naevL_confSet( lua_State *L );
 static int naevL_cache( lua_State *L );
+static int naevL_gcStats( lua_State *L );
+static int naevL_stats( lua_State *L );
+static int naevL_benchmark( lua_State *L );
 static const luaL_Reg naev_methods[] = {
    { "version", naevL_version },
    { "versionTest", naevL_versionTest },
@@ -62,6 +88,9 @@ static const luaL_Reg naev_methods[] = {
    { "conf", naevL_conf },
    { "confSet", naevL_confSet },
    { "cache", naevL_cache },
+   { "gcStats", naevL_gcStats },
+   { "stats", naevL_stats },
+   { "benchmark", naevL_benchmark },
    {0,0}
 }; /**< Naev Lua methods. */
 
@@ -482,3 +511,88 @@ static int naevL_cache( lua_State *L )
    lua_rawgeti( L, LUA_REGISTRYINDEX, cache_table );
    return 1;
 }
+
+/**
+ * @brief Gets how much garbage pushing game objects to Lua generated in the last frame.
+ *
+ * Pilots and pilot outfits are interned, so pushing them again while Lua
+ *  still references them reuses the same userdata.
+ *
+ * @usage s = naev.gcStats(); print( s.alloc, s.reused, s.memory )
+ *
+ *    @luatreturn table Table with the number of userdata allocated ("alloc"),
+ *       the pushes that reused userdata ("reused") and the memory used by Lua
+ *       in KiB ("memory").
+ * @luafunc gcStats
+ */
+static int naevL_gcStats( lua_State *L )
+{
+   const NLuaGCStats *gcs = nlua_gcStats();
+   lua_newtable( L );
+   lua_pushnumber( L, gcs->alloc );
+   lua_setfield( L, -2, "alloc" );
+   lua_pushnumber( L, gcs->reused );
+   lua_setfield( L, -2, "reused" );
+   lua_pushnumber( L, gcs->memory );
+   lua_setfield( L, -2, "memory" );
+   return 1;
+}
+
+/**
+ * @brief Gets the developer statistics of the last frame.
+ *
+ * These are the same statistics shown under the FPS counter in devmode, but
+ *  they can be read without displaying them, e.g. when running headless.
+ *
+ * @usage s = naev.stats(); print( s.asteroid_sprites.sprites, s.asteroid_sprites.draws )
+ *
+ *    @luatreturn table Table of statistics by name, each a table of values by name.
+ * @luafunc stats
+ */
+static int naevL_stats( lua_State *L )
+{
+   int n;
+   const DevStat *stats = dstats_getAll( &n );
+   lua_newtable( L );
+   for (int i=0; i<n; i++) {
+      double v[DSTATS_VALUES] = { 0., 0., 0. };
+      stats[i].get( v );
+      lua_newtable( L );
+      for (int j=0; (j<DSTATS_VALUES) && (stats[i].values[j] != NULL); j++) {
+         lua_pushnumber( L, v[j] );
+         lua_setfield( L, -2, stats[i].values[j] );
+      }
+      lua_setfield( L, -2, stats[i].name );
+   }
+   return 1;
+}
+
+/**
+ * @brief Runs developer benchmarks, logging their results.
+ *
+ * Only available in debug builds.
+ *
+ * @usage naev.benchmark( "pilot_handles" ) -- Runs a single benchmark
+ * @usage naev.benchmark() -- Runs all of them
+ *
+ *    @luatparam[opt] string name Name of the benchmark to run, runs all if omitted.
+ * @luafunc benchmark
+ */
+static int naevL_benchmark( lua_State *L )
+{
+#if DEBUGGING
+   const char *name = luaL_optstring( L, 1, NULL );
+   int found = 0;
+   for (int i=0; naev_benchmarks[i].name != NULL; i++) {
+      if ((name != NULL) && (strcmp( name, naev_benchmarks[i].name ) != 0))
+         continue;
+      naev_benchmarks[i].func();
+      found = 1;
+   }
+   if (!found)
+      NLUA_ERROR( L, _("Benchmark '%s' not found!"), name );
+   return 0;
+#else /* DEBUGGING */
+   return NLUA_ERROR( L, _("Benchmarks are only available in debug builds.") );
+#endif /* DEBUGGING */
+}
@@ -9,6 +9,9 @@
  * These bindings control the planets and systems.
  */
 /** @cond */
+#include <stdlib.h>
+#include <string.h>
+
 #include "naev.h"
 /** @endcond */
 
@@ -40,6 +43,31 @@
 #include "space.h"
 #include "weapon.h"
 
+#define PILOTL_GRID_CELL      1024. /**< Size of a cell of the pilot grid. */
+#define PILOTL_GRID_BUCKETS   256   /**< Buckets of the pilot grid, must be a power of two. */
+#define PILOTL_GRID_SLACK     256.  /**< Padding for pilots that moved since the grid was built. */
+
+/**
+ * @brief Pilots of the stack bucketized by position for range queries.
+ */
+typedef struct PilotGrid_ {
+   Pilot **pilots;   /**< Pilots sorted by bucket (array.h). */
+   int start[PILOTL_GRID_BUCKETS+1]; /**< Offset of each bucket in pilots. */
+   int visited[PILOTL_GRID_BUCKETS]; /**< Stamp of the last query that looked at each bucket. */
+   int stamp;        /**< Stamp of the current query. */
+   unsigned int gen; /**< Pilot stack generation the grid was built at. */
+   int valid;        /**< Whether or not the grid has been built. */
+} PilotGrid;
+static PilotGrid pilotL_grid = { .pilots = NULL, .valid = 0 }; /**< Grid used by pilot.getInRange. */
+
+/**
+ * @brief Pilot found by a range query.
+ */
+typedef struct PilotInRange_ {
+   Pilot *p;   /**< Pilot found. */
+   double d2;  /**< Squared distance to the centre. */
+} PilotInRange;
+
 /*
  * From ai.c
  */
@@ -49,6 +77,13 @@ extern Pilot *cur_pilot;
  * Prototypes.
  */
 static int pilotL_getFriendOrFoe( lua_State *L, int friend );
+static int pilotL_gridCell( double x );
+static int pilotL_gridBucket( int ix, int iy );
+static void pilotL_gridBuild (void);
+static void pilotL_gridInvalidate (void);
+static int pilotL_inRangeCmp( const void *a, const void *b );
+static int pilotL_inRangeRef( lua_State *L, int ind, const char *field,
+      Pilot *centre, Pilot **p, int *f );
 static Task *pilotL_newtask( lua_State *L, Pilot* p, const char *task );
 static int outfit_compareActive( const void *slot1, const void *slot2 );
 static int pilotL_setFlagWrapper( lua_State *L, int flag );
@@ -63,6 +98,7 @@ static int pilotL_getPilots( lua_State *L );
 static int pilotL_getAllies( lua_State *L );
 static int pilotL_getHostiles( lua_State *L );
 static int pilotL_getVisible( lua_State *L );
+static int pilotL_getInRange( lua_State *L );
 static int pilotL_eq( lua_State *L );
 static int pilotL_name( lua_State *L );
 static int pilotL_id( lua_State *L );
@@ -181,6 +217,7 @@ static const luaL_Reg pilotL_methods[] = {
    { "getAllies", pilotL_getAllies },
    { "getHostiles", pilotL_getHostiles },
    { "getVisible", pilotL_getVisible },
+   { "getInRange", pilotL_getInRange },
    { "__eq", pilotL_eq },
    { "__tostring", pilotL_name },
    /* Info. */
@@ -410,12 +447,43 @@ Pilot* luaL_validpilot( lua_State *L, int ind )
  */
 LuaPilot* lua_pushpilot( lua_State *L, LuaPilot pilot )
 {
-   LuaPilot *p = (LuaPilot*) lua_newuserdata(L, sizeof(LuaPilot));
+   LuaPilot *p;
+
+   /* Reuse the userdata of the pilot if Lua still has it. */
+   nlua_internCache( L, PILOT_CACHE );          /* c */
+   lua_rawgeti( L, -1, pilot );                 /* c, u */
+   if (lua_isuserdata( L, -1 )) {
+      lua_remove( L, -2 );                      /* u */
+      nlua_internCount( 1 );
+      return (LuaPilot*) lua_touserdata( L, -1 );
+   }
+   lua_pop( L, 1 );                             /* c */
+
+   p = (LuaPilot*) lua_newuserdata(L, sizeof(LuaPilot)); /* c, u */
    *p = pilot;
    luaL_getmetatable(L, PILOT_METATABLE);
    lua_setmetatable(L, -2);
+   lua_pushvalue( L, -1 );                      /* c, u, u */
+   lua_rawseti( L, -3, pilot );                 /* c, u */
+   lua_remove( L, -2 );                         /* u */
+   nlua_internCount( 0 );
    return p;
 }
+/**
+ * @brief Drops the interned userdata of a pilot.
+ *
+ *    @param L Lua state to drop it from.
+ *    @param pilot Pilot that is going away.
+ */
+void lua_uncachepilot( lua_State *L, LuaPilot pilot )
+{
+   if (L == NULL)
+      return;
+   nlua_internCache( L, PILOT_CACHE );          /* c */
+   lua_pushnil( L );                            /* c, nil */
+   lua_rawseti( L, -2, pilot );                 /* c */
+   lua_pop( L, 1 );                             /* */
+}
 /**
  * @brief Checks to see if ind is a pilot.
  *
@@ -1042,6 +1110,304 @@ static int pilotL_getVisible( lua_State *L )
    return 1;
 }
 
+/**
+ * @brief Gets the grid cell of a coordinate.
+ */
+static int pilotL_gridCell( double x )
+{
+   return (int)floor( CLAMP( -1e9, 1e9, x / PILOTL_GRID_CELL ) );
+}
+
+/**
+ * @brief Hashes a grid cell into a bucket.
+ */
+static int pilotL_gridBucket( int ix, int iy )
+{
+   return (((unsigned int)ix * 73856093u) ^ ((unsigned int)iy * 19349663u)) & (PILOTL_GRID_BUCKETS-1);
+}
+
+/**
+ * @brief Bucketizes pilot_stack on a coarse grid so range queries only look at
+ *        nearby pilots.
+ *
+ * The grid is rebuilt lazily the first time it is queried after the pilot
+ * stack generation changes, that is, at most once a frame plus once per pilot
+ * added or removed.
+ */
+static void pilotL_gridBuild (void)
+{
+   int count[PILOTL_GRID_BUCKETS];
+   Pilot *const* pilot_stack = pilot_getAll();
+   int n = array_size(pilot_stack);
+
+   if (pilotL_grid.pilots == NULL)
+      pilotL_grid.pilots = array_create_size( Pilot*, MAX(n,1) );
+   array_resize( &pilotL_grid.pilots, n );
+
+   /* Count the pilots per bucket. */
+   memset( count, 0, sizeof(count) );
+   for (int i=0; i<n; i++) {
+      const Vector2d *pos = &pilot_stack[i]->solid->pos;
+      count[ pilotL_gridBucket( pilotL_gridCell(pos->x), pilotL_gridCell(pos->y) ) ]++;
+   }
+
+   /* Prefix sum into bucket offsets. */
+   pilotL_grid.start[0] = 0;
+   for (int i=0; i<PILOTL_GRID_BUCKETS; i++) {
+      pilotL_grid.start[i+1] = pilotL_grid.start[i] + count[i];
+      count[i] = pilotL_grid.start[i];
+   }
+
+   /* Scatter the pilots. */
+   for (int i=0; i<n; i++) {
+      const Vector2d *pos = &pilot_stack[i]->solid->pos;
+      int b = pilotL_gridBucket( pilotL_gridCell(pos->x), pilotL_gridCell(pos->y) );
+      pilotL_grid.pilots[ count[b]++ ] = pilot_stack[i];
+   }
+
+   pilotL_grid.gen   = pilot_stackGeneration();
+   pilotL_grid.valid = 1;
+}
+
+/**
+ * @brief Forces the pilot grid to be rebuilt on the next query.
+ */
+static void pilotL_gridInvalidate (void)
+{
+   pilotL_grid.valid = 0;
+}
+
+/**
+ * @brief Frees the grid used by pilot.getInRange, called when the pilot stack is freed.
+ */
+void lua_freePilotGrid (void)
+{
+   array_free( pilotL_grid.pilots );
+   pilotL_grid.pilots = NULL;
+   pilotL_gridInvalidate();
+}
+
+/**
+ * @brief Compares pilots in range by distance (for use with qsort).
+ */
+static int pilotL_inRangeCmp( const void *a, const void *b )
+{
+   const PilotInRange *pa = a;
+   const PilotInRange *pb = b;
+   if (pa->d2 < pb->d2)
+      return -1;
+   else if (pa->d2 > pb->d2)
+      return +1;
+   /* Break ties by ID so the result is deterministic. */
+   if (pa->p->id < pb->p->id)
+      return -1;
+   return (pa->p->id > pb->p->id);
+}
+
+/**
+ * @brief Parses a pilot or faction reference of a pilot.getInRange filter.
+ *
+ *    @param L Lua state.
+ *    @param ind Index of the options table.
+ *    @param field Field of the options table to parse.
+ *    @param centre Pilot the query is centred on (or NULL).
+ *    @param[out] p Pilot to filter by or NULL if using a faction.
+ *    @param[out] f Faction to filter by or -1 if using a pilot.
+ *    @return 1 if the filter is set, 0 otherwise.
+ */
+static int pilotL_inRangeRef( lua_State *L, int ind, const char *field,
+      Pilot *centre, Pilot **p, int *f )
+{
+   int ret = 1;
+   *p = NULL;
+   *f = -1;
+   lua_getfield(L,ind,field);
+   if (lua_isnil(L,-1) || (lua_isboolean(L,-1) && !lua_toboolean(L,-1)))
+      ret = 0;
+   else if (lua_isboolean(L,-1)) {
+      if (centre == NULL) {
+         NLUA_ERROR(L, _("'%s' needs a pilot or faction when not centred on a pilot"), field);
+         return 0;
+      }
+      *p = centre;
+   }
+   else if (lua_ispilot(L,-1))
+      *p = luaL_validpilot(L,-1);
+   else
+      *f = luaL_validfaction(L,-1);
+   lua_pop(L,1);
+   return ret;
+}
+
+/**
+ * @brief Gets the pilots within a radius of a position, sorted by distance.
+ *
+ * Unlike pilot.get or pilot.getHostiles this only looks at the pilots near
+ * the position, so it is cheap to call every frame from AI or missions.
+ *
+ * The filter table supports the following fields:<br/>
+ * <ul>
+ *  <li>faction: Only get pilots belonging to this faction.</li>
+ *  <li>ally: Only get allies of this pilot or faction (true uses the centre pilot).</li>
+ *  <li>enemy: Only get enemies of this pilot or faction (true uses the centre pilot).</li>
+ *  <li>visible: Only get pilots this pilot can see (true uses the centre pilot).</li>
+ *  <li>disabled: Whether or not to also get disabled pilots (default false).</li>
+ *  <li>limit: Maximum number of pilots to return, the nearest are kept.</li>
+ * </ul>
+ *
+ * @usage p = pilot.getInRange( vec2.new(0,0), 3000 ) -- All pilots within 3000 of origin
+ * @usage p = pilot.getInRange( plt, 5000, { enemy=true, visible=true, limit=1 } ) -- Nearest visible enemy of plt
+ * @usage p = pilot.getInRange( pos, 2000, { ally=faction.get("Empire") } ) -- Allies of the Empire near pos
+ *
+ *    @luatparam Pilot|Vec2 centre Pilot or position to look around. A pilot is never part of its own results.
+ *    @luatparam number radius Distance to look for pilots.
+ *    @luatparam[opt] table filter Filters to apply to the pilots.
+ *    @luatreturn {Pilot,...} A table containing the pilots sorted by distance.
+ * @luafunc getInRange
+ */
+static int pilotL_getInRange( lua_State *L )
+{
+   PilotInRange *found;
+   Pilot *centre, *ally_p, *enemy_p, *vis_p;
+   int ally_f, enemy_f, vis_f, fac;
+   int ally, enemy, vis, dis, limit, all;
+   const Vector2d *v;
+   double r, r2, slack;
+   int ix0, iy0, ix1, iy1;
+
+   /* Centre. */
+   if (lua_ispilot(L,1)) {
+      centre = luaL_validpilot(L,1);
+      v      = &centre->solid->pos;
+   }
+   else {
+      centre = NULL;
+      v      = luaL_checkvector(L,1);
+   }
+   r = luaL_checknumber(L,2);
+   if (r < 0.)
+      NLUA_INVALID_PARAMETER(L);
+   r2 = pow2(r);
+
+   /* Filters. */
+   ally  = enemy = vis = dis = 0;
+   fac   = -1;
+   limit = 0;
+   ally_p = enemy_p = vis_p = NULL;
+   ally_f = enemy_f = vis_f = -1;
+   if (lua_istable(L,3)) {
+      lua_getfield(L,3,"faction");
+      if (!lua_isnil(L,-1))
+         fac = luaL_validfaction(L,-1);
+      lua_pop(L,1);
+
+      ally  = pilotL_inRangeRef( L, 3, "ally", centre, &ally_p, &ally_f );
+      enemy = pilotL_inRangeRef( L, 3, "enemy", centre, &enemy_p, &enemy_f );
+      vis   = pilotL_inRangeRef( L, 3, "visible", centre, &vis_p, &vis_f );
+      if (vis && (vis_p == NULL))
+         NLUA_ERROR(L, _("'visible' filter needs a pilot"));
+
+      lua_getfield(L,3,"disabled");
+      dis = lua_toboolean(L,-1);
+      lua_pop(L,1);
+
+      lua_getfield(L,3,"limit");
+      limit = luaL_optinteger(L,-1,0);
+      lua_pop(L,1);
+   }
+   else if (!lua_isnoneornil(L,3))
+      NLUA_INVALID_PARAMETER(L);
+
+   /* Make sure the grid is up to date. */
+   if (!pilotL_grid.valid || (pilotL_grid.gen != pilot_stackGeneration()))
+      pilotL_gridBuild();
+
+   /* Cells to look at, padded for pilots that moved since the grid was built. */
+   slack = r + PILOTL_GRID_SLACK;
+   ix0 = pilotL_gridCell( v->x - slack );
+   iy0 = pilotL_gridCell( v->y - slack );
+   ix1 = pilotL_gridCell( v->x + slack );
+   iy1 = pilotL_gridCell( v->y + slack );
+   /* Covering more cells than there are buckets, just look at them all. */
+   all = ((ix1-ix0+1.) * (iy1-iy0+1.) >= PILOTL_GRID_BUCKETS);
+   if (all)
+      ix0 = iy0 = ix1 = iy1 = 0;
+   else
+      pilotL_grid.stamp++;
+
+   found = array_create( PilotInRange );
+
+   for (int ix=ix0; ix<=ix1; ix++) {
+      for (int iy=iy0; iy<=iy1; iy++) {
+         int b0, b1;
+         if (all) {
+            b0 = 0;
+            b1 = PILOTL_GRID_BUCKETS;
+         }
+         else {
+            b0 = pilotL_gridBucket( ix, iy );
+            /* Different cells may share a bucket, only look at it once. */
+            if (pilotL_grid.visited[b0] == pilotL_grid.stamp)
+               continue;
+            pilotL_grid.visited[b0] = pilotL_grid.stamp;
+            b1 = b0+1;
+         }
+
+         for (int j=pilotL_grid.start[b0]; j<pilotL_grid.start[b1]; j++) {
+            Pilot *plt = pilotL_grid.pilots[j];
+            double d2;
+
+            if (plt == centre)
+               continue;
+            if (pilot_isFlag(plt, PILOT_DELETE))
+               continue;
+            d2 = vect_dist2( &plt->solid->pos, v );
+            if (d2 > r2)
+               continue;
+            if (!dis && pilot_isDisabled(plt))
+               continue;
+            if ((fac >= 0) && (plt->faction != fac))
+               continue;
+            if (ally) {
+               if (ally_p != NULL) {
+                  if (!pilot_areAllies( ally_p, plt ))
+                     continue;
+               }
+               else if (!areAllies( ally_f, plt->faction ))
+                  continue;
+            }
+            if (enemy) {
+               if (enemy_p != NULL) {
+                  if (!pilot_areEnemies( enemy_p, plt ))
+                     continue;
+               }
+               else if (!areEnemies( enemy_f, plt->faction ))
+                  continue;
+            }
+            if (vis && !pilot_validTarget( vis_p, plt ))
+               continue;
+
+            PilotInRange *pr = &array_grow( &found );
+            pr->p  = plt;
+            pr->d2 = d2;
+         }
+      }
+   }
+
+   /* Sort by distance and trim. */
+   qsort( found, array_size(found), sizeof(PilotInRange), pilotL_inRangeCmp );
+   if ((limit > 0) && (array_size(found) > limit))
+      array_resize( &found, limit );
+
+   lua_createtable(L, array_size(found), 0);
+   for (int i=0; i<array_size(found); i++) {
+      lua_pushpilot(L, found[i].p->id); /* value */
+      lua_rawseti(L,-2,i+1); /* table[key] = value */
+   }
+   array_free( found );
+   return 1;
+}
+
 /**
  * @brief Checks to see if pilot and p are the same.
  *
@@ -2050,6 +2416,7 @@ static int pilotL_setPosition( lua_State *L )
 
    /* Warp pilot to new position. */
    p->solid->pos = *vec;
+   pilotL_gridInvalidate();
 
    /* Update if necessary. */
    if (pilot_isPlayer(p))
@@ -2836,7 +3203,7 @@ static int pilotL_intrinsicReset( lua_State *L )
 {
    Pilot *p = luaL_validpilot(L,1);
    ss_statsInit( &p->intrinsic_stats );
-   pilot_calcStats( p );
+   pilot_calcStatsLayers( p, PILOT_STATS_INTRINSIC );
    return 0;
 }
 
@@ -2861,7 +3228,7 @@ static int pilotL_intrinsicSet( lua_State *L )
       value    = luaL_checknumber(L,3);
       replace  = lua_toboolean(L,4);
       ss_statsSet( &p->intrinsic_stats, name, value, replace );
-      pilot_calcStats( p );
+      pilot_calcStatsLayers( p, PILOT_STATS_INTRINSIC );
       return 0;
    }
    replace = lua_toboolean(L,4);
@@ -2874,7 +3241,7 @@ static int pilotL_intrinsicSet( lua_State *L )
       lua_pop(L,1);
    }
    lua_pop(L,1);
-   pilot_calcStats( p );
+   pilot_calcStatsLayers( p, PILOT_STATS_INTRINSIC );
    return 0;
 }
 
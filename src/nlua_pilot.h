@@ -10,6 +10,7 @@
 #include "pilot.h"
 
 #define PILOT_METATABLE   "pilot" /**< Pilot metatable identifier. */
+#define PILOT_CACHE       "pilot_cache" /**< Registry field of the interned pilot userdata. */
 
 /**
  * @brief Lua Pilot wrapper.
@@ -27,5 +28,7 @@ int nlua_loadPilot( nlua_env env );
 LuaPilot lua_topilot( lua_State *L, int ind );
 LuaPilot luaL_checkpilot( lua_State *L, int ind );
 LuaPilot* lua_pushpilot( lua_State *L, LuaPilot pilot );
+void lua_uncachepilot( lua_State *L, LuaPilot pilot );
 Pilot* luaL_validpilot( lua_State *L, int ind );
 int lua_ispilot( lua_State *L, int ind );
+void lua_freePilotGrid (void);
@@ -112,12 +112,47 @@ PilotOutfitSlot* luaL_validpilotoutfit( lua_State *L, int ind )
 PilotOutfitSlot** lua_pushpilotoutfit( lua_State *L, PilotOutfitSlot *po )
 {
    PilotOutfitSlot **lpo;
-   lpo = (PilotOutfitSlot**) lua_newuserdata(L, sizeof(PilotOutfitSlot*));
+
+   /* Reuse the userdata of the slot if Lua still has it. */
+   nlua_internCache( L, PILOTOUTFIT_CACHE );    /* c */
+   lua_pushlightuserdata( L, po );              /* c, k */
+   lua_rawget( L, -2 );                         /* c, u */
+   if (lua_isuserdata( L, -1 )) {
+      lua_remove( L, -2 );                      /* u */
+      nlua_internCount( 1 );
+      return (PilotOutfitSlot**) lua_touserdata( L, -1 );
+   }
+   lua_pop( L, 1 );                             /* c */
+
+   lpo = (PilotOutfitSlot**) lua_newuserdata(L, sizeof(PilotOutfitSlot*)); /* c, u */
    *lpo = po;
    luaL_getmetatable(L, PILOTOUTFIT_METATABLE);
    lua_setmetatable(L, -2);
+   lua_pushlightuserdata( L, po );              /* c, u, k */
+   lua_pushvalue( L, -2 );                      /* c, u, k, u */
+   lua_rawset( L, -4 );                         /* c, u */
+   lua_remove( L, -2 );                         /* u */
+   nlua_internCount( 0 );
    return lpo;
 }
+/**
+ * @brief Drops the interned userdata of a pilot outfit.
+ *
+ * Must be called before the slot is freed, as its memory may be reused.
+ *
+ *    @param L Lua state to drop it from.
+ *    @param po Pilot outfit that is going away.
+ */
+void lua_uncachepilotoutfit( lua_State *L, const PilotOutfitSlot *po )
+{
+   if (L == NULL)
+      return;
+   nlua_internCache( L, PILOTOUTFIT_CACHE );    /* c */
+   lua_pushlightuserdata( L, (void*)po );       /* c, k */
+   lua_pushnil( L );                            /* c, k, nil */
+   lua_rawset( L, -3 );                         /* c */
+   lua_pop( L, 1 );                             /* */
+}
 /**
  * @brief Checks to see if ind is a pilot outfit.
  *
@@ -7,6 +7,7 @@
 #include "pilot.h"
 
 #define PILOTOUTFIT_METATABLE   "pilotoutfit" /**< Pilot outfit metatable identifier. */
+#define PILOTOUTFIT_CACHE       "pilotoutfit_cache" /**< Registry field of the interned pilot outfit userdata. */
 
 extern int pilotoutfit_modified;
 
@@ -22,4 +23,5 @@ PilotOutfitSlot* lua_topilotpilotoutfit( lua_State *L, int ind );
 PilotOutfitSlot* luaL_checkpilotoutfit( lua_State *L, int ind );
 PilotOutfitSlot* luaL_validpilotoutfit( lua_State *L, int ind );
 PilotOutfitSlot** lua_pushpilotoutfit( lua_State *L, PilotOutfitSlot* po );
+void lua_uncachepilotoutfit( lua_State *L, const PilotOutfitSlot *po );
 int lua_ispilotoutfit( lua_State *L, int ind );
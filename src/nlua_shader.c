@@ -30,6 +30,7 @@ static int shaderL_sendRaw( lua_State *L );
 static int shaderL_hasUniform( lua_State *L );
 static int shaderL_addPostProcess( lua_State *L );
 static int shaderL_rmPostProcess( lua_State *L );
+static int shaderL_setPostProcessNoop( lua_State *L );
 static const luaL_Reg shaderL_methods[] = {
    { "__gc", shaderL_gc },
    { "__eq", shaderL_eq },
@@ -39,6 +40,7 @@ static const luaL_Reg shaderL_methods[] = {
    { "hasUniform", shaderL_hasUniform },
    { "addPPShader", shaderL_addPostProcess },
    { "rmPPShader", shaderL_rmPostProcess },
+   { "setPPNoop", shaderL_setPostProcessNoop },
    {0,0}
 }; /**< Shader metatable methods. */
 
@@ -445,7 +447,7 @@ static int shaderL_addPostProcess( lua_State *L )
       NLUA_ERROR(L,_("Layer was '%s', but must be one of 'final' or 'game'"), str);
 
    if (ls->pp_id == 0)
-      ls->pp_id = render_postprocessAdd( ls, layer, priority );
+      ls->pp_id = render_postprocessAdd( ls, layer, priority, 0 );
    lua_pushboolean(L, ls->pp_id>0);
    return 1;
 }
@@ -464,3 +466,26 @@ static int shaderL_rmPostProcess( lua_State *L )
    ls->pp_id = 0;
    return 1;
 }
+
+/**
+ * @brief Marks a post-processing shader as doing nothing, so its pass gets skipped.
+ *
+ * Cheaper than removing and adding the shader again when an effect fades
+ * in and out.
+ *
+ *    @luatparam Shader shader Post-processing shader to mark.
+ *    @luatparam boolean noop Whether or not the shader currently does nothing.
+ *    @luatreturn boolean True on success.
+ * @luafunc setPPNoop
+ */
+static int shaderL_setPostProcessNoop( lua_State *L )
+{
+   LuaShader_t *ls = luaL_checkshader(L,1);
+   int noop = lua_toboolean(L,2);
+   if (ls->pp_id == 0) {
+      lua_pushboolean( L, 0 );
+      return 1;
+   }
+   lua_pushboolean( L, render_postprocessSetNoop( ls->pp_id, noop )==0 );
+   return 1;
+}
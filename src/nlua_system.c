@@ -989,6 +989,7 @@ static int systemL_setknown( lua_State *L )
             jp_rmFlag( &sys->jumps[i], JP_KNOWN );
      }
    }
+   map_geomDirty();
 
    /* Update outfits image array. */
    outfits_updateEquipmentOutfits();
@@ -1029,6 +1030,7 @@ static int systemL_setHidden( lua_State *L )
       sys_setFlag( sys, SYSTEM_HIDDEN );
    else
       sys_rmFlag( sys, SYSTEM_HIDDEN );
+   map_geomDirty();
    return 0;
 }
 
@@ -10,6 +10,7 @@
  */
 /** @cond */
 #include <lauxlib.h>
+#include <string.h>
 
 #include "naev.h"
 /** @endcond */
@@ -39,6 +40,14 @@ static int vectorL_distance( lua_State *L );
 static int vectorL_distance2( lua_State *L );
 static int vectorL_mod( lua_State *L );
 static int vectorL_normalize( lua_State *L );
+static int vectorL_checkxy( lua_State *L, double *x, double *y );
+static int vectorL_addInPlace( lua_State *L );
+static int vectorL_subInPlace( lua_State *L );
+static int vectorL_mulInPlace( lua_State *L );
+static int vectorL_divInPlace( lua_State *L );
+static int vectorL_normalizeInPlace( lua_State *L );
+static int vectorL_diff( lua_State *L );
+static int vectorL_polarDiff( lua_State *L );
 static const luaL_Reg vector_methods[] = {
    { "new", vectorL_new },
    { "newP", vectorL_newP },
@@ -59,9 +68,113 @@ static const luaL_Reg vector_methods[] = {
    { "dist2", vectorL_distance2 },
    { "mod", vectorL_mod },
    { "normalize", vectorL_normalize },
+   { "add_", vectorL_addInPlace },
+   { "sub_", vectorL_subInPlace },
+   { "mul_", vectorL_mulInPlace },
+   { "div_", vectorL_divInPlace },
+   { "normalize_", vectorL_normalizeInPlace },
+   { "diff", vectorL_diff },
+   { "polarDiff", vectorL_polarDiff },
    {0,0}
 }; /**< Vector metatable methods. */
 
+/**
+ * @brief LuaJIT FFI versions of the methods that don't create vectors.
+ *
+ * Must be kept in sync with Vector2d and vect_cset().
+ */
+static const char vector_ffi[] =
+   "local ffi, vec = ...\n"
+   "ffi.cdef[[ typedef struct { double x, y, mod, angle; } nlua_Vector2d; ]]\n"
+   "local P = ffi.typeof('nlua_Vector2d*')\n"
+   "local cast, getmt, type = ffi.cast, getmetatable, type\n"
+   "local sqrt, atan2 = math.sqrt, math.atan2\n"
+   "local function check( v, n )\n"
+   "   if getmt(v) ~= vec then\n"
+   "      error( string.format( 'bad argument #%d (vec2 expected, got %s)', n, type(v) ), 3 )\n"
+   "   end\n"
+   "   return cast( P, v )\n"
+   "end\n"
+   "local function xy( x, y )\n"
+   "   if getmt(x) == vec then\n"
+   "      local w = cast( P, x )\n"
+   "      return w.x, w.y\n"
+   "   elseif type(x) == 'number' and type(y) == 'number' then\n"
+   "      return x, y\n"
+   "   end\n"
+   "   error( 'invalid parameter', 3 )\n"
+   "end\n"
+   "local function cset( p, x, y )\n"
+   "   p.x, p.y = x, y\n"
+   "   p.mod    = sqrt( x*x + y*y )\n"
+   "   p.angle  = atan2( y, x )\n"
+   "end\n"
+   "function vec.get( v )\n"
+   "   local p = check( v, 1 )\n"
+   "   return p.x, p.y\n"
+   "end\n"
+   "function vec.polar( v )\n"
+   "   local p = check( v, 1 )\n"
+   "   return p.mod, p.angle\n"
+   "end\n"
+   "function vec.mod( v )\n"
+   "   return check( v, 1 ).mod\n"
+   "end\n"
+   "function vec.dot( a, b )\n"
+   "   local p, q = check( a, 1 ), check( b, 2 )\n"
+   "   return p.x*q.x + p.y*q.y\n"
+   "end\n"
+   "function vec.dist2( a, b )\n"
+   "   local p = check( a, 1 )\n"
+   "   if b == nil then return p.x*p.x + p.y*p.y end\n"
+   "   local q = check( b, 2 )\n"
+   "   local dx, dy = q.x-p.x, q.y-p.y\n"
+   "   return dx*dx + dy*dy\n"
+   "end\n"
+   "function vec.dist( a, b )\n"
+   "   return sqrt( vec.dist2( a, b ) )\n"
+   "end\n"
+   "function vec.diff( a, b )\n"
+   "   local p, q = check( a, 1 ), check( b, 2 )\n"
+   "   return p.x-q.x, p.y-q.y\n"
+   "end\n"
+   "function vec.polarDiff( a, b )\n"
+   "   local p, q = check( a, 1 ), check( b, 2 )\n"
+   "   local dx, dy = p.x-q.x, p.y-q.y\n"
+   "   return sqrt( dx*dx + dy*dy ), atan2( dy, dx )\n"
+   "end\n"
+   "function vec.set( v, x, y )\n"
+   "   cset( check( v, 1 ), x, y )\n"
+   "end\n"
+   "function vec.add_( v, x, y )\n"
+   "   local p = check( v, 1 )\n"
+   "   x, y = xy( x, y )\n"
+   "   cset( p, p.x+x, p.y+y )\n"
+   "   return v\n"
+   "end\n"
+   "function vec.sub_( v, x, y )\n"
+   "   local p = check( v, 1 )\n"
+   "   x, y = xy( x, y )\n"
+   "   cset( p, p.x-x, p.y-y )\n"
+   "   return v\n"
+   "end\n"
+   "function vec.mul_( v, m )\n"
+   "   local p = check( v, 1 )\n"
+   "   cset( p, p.x*m, p.y*m )\n"
+   "   return v\n"
+   "end\n"
+   "function vec.div_( v, m )\n"
+   "   local p = check( v, 1 )\n"
+   "   cset( p, p.x/m, p.y/m )\n"
+   "   return v\n"
+   "end\n"
+   "function vec.normalize_( v )\n"
+   "   local p = check( v, 1 )\n"
+   "   cset( p, p.x/p.mod, p.y/p.mod )\n"
+   "   return v\n"
+   "end\n";
+static void vector_loadFFI (void);
+
 /**
  * @brief Loads the vector metatable.
  *
@@ -71,9 +184,63 @@ static const luaL_Reg vector_methods[] = {
 int nlua_loadVector( nlua_env env )
 {
    nlua_register(env, VECTOR_METATABLE, vector_methods, 1);
+   vector_loadFFI();
    return 0;
 }
 
+/**
+ * @brief Replaces the non-allocating vector methods with FFI versions when
+ *        running on LuaJIT.
+ *
+ * Calls to lua_CFunctions can not be compiled by LuaJIT and abort traces, so
+ * hot loops using vectors end up interpreted. The replacements access the
+ * Vector2d inside the very same userdata through the FFI, so vectors are
+ * still interchangeable with the C API.
+ *
+ * This only has to be done once as the metatable is shared by all the
+ * environments, and does nothing on plain Lua.
+ */
+static void vector_loadFFI (void)
+{
+   static int loaded = 0;
+   if (loaded)
+      return;
+   loaded = 1;
+
+   /* Only LuaJIT provides the ffi library. */
+   lua_getglobal(naevL, "package");          /* pkg */
+   if (!lua_istable(naevL,-1)) {
+      lua_pop(naevL,1);                      /* */
+      return;
+   }
+   lua_getfield(naevL, -1, "loaded");        /* pkg, loaded */
+   if (!lua_istable(naevL,-1)) {
+      lua_pop(naevL,2);                      /* */
+      return;
+   }
+   lua_getfield(naevL, -1, "ffi");           /* pkg, loaded, ffi */
+   if (lua_isnil(naevL,-1)) {
+      lua_pop(naevL,3);                      /* */
+      return;
+   }
+   lua_remove(naevL, -2);                    /* pkg, ffi */
+   lua_remove(naevL, -2);                    /* ffi */
+
+   if (luaL_loadbuffer(naevL, vector_ffi, strlen(vector_ffi), "=vec2_ffi") != 0) {
+      WARN(_("Failed to load vec2 FFI methods: %s"), lua_tostring(naevL,-1));
+      lua_pop(naevL,2);                      /* */
+      return;
+   }                                         /* ffi, f */
+   lua_insert(naevL, -2);                    /* f, ffi */
+   luaL_getmetatable(naevL, VECTOR_METATABLE); /* f, ffi, mt */
+   if (lua_pcall(naevL, 2, 0, 0) != 0) {
+      WARN(_("Failed to load vec2 FFI methods: %s"), lua_tostring(naevL,-1));
+      lua_pop(naevL,1);                      /* */
+      return;
+   }
+   DEBUG(_("Using FFI vec2 methods."));
+}
+
 /**
  * @brief Represents a 2D vector in Lua.
  *
@@ -659,3 +826,167 @@ static int vectorL_normalize( lua_State *L )
    lua_pushvector(L, *v);
    return 1;
 }
+
+/**
+ * @brief Gets the cartesian coordinates passed to a vector method at index 2,
+ *        either as a vector or as two numbers.
+ *
+ *    @return 1 on success, raises a Lua error otherwise.
+ */
+static int vectorL_checkxy( lua_State *L, double *x, double *y )
+{
+   if (lua_isvector(L,2)) {
+      Vector2d *v2 = lua_tovector(L,2);
+      *x = v2->x;
+      *y = v2->y;
+   }
+   else if ((lua_gettop(L) > 2) && lua_isnumber(L,2) && lua_isnumber(L,3)) {
+      *x = lua_tonumber(L,2);
+      *y = lua_tonumber(L,3);
+   }
+   else
+      NLUA_INVALID_PARAMETER(L);
+   return 1;
+}
+
+/**
+ * @brief Adds a vector or cartesian coordinates to a vector in place.
+ *
+ * Unlike add, this does not create a new vector so it should be preferred in
+ * code that runs every frame.
+ *
+ * @usage my_vec:add_( your_vec ) -- my_vec is now my_vec + your_vec
+ * @usage my_vec:add_( 5, 3 ):mul_( 2 ) -- Operations can be chained
+ *
+ *    @luatparam Vec2 v Vector to modify.
+ *    @luatparam number|Vec2 x X coordinate or vector to add.
+ *    @luatparam number|nil y Y coordinate or nil to add.
+ *    @luatreturn Vec2 The vector v itself.
+ * @luafunc add_
+ */
+static int vectorL_addInPlace( lua_State *L )
+{
+   double x, y;
+   Vector2d *v1 = luaL_checkvector(L,1);
+   vectorL_checkxy( L, &x, &y );
+   vect_cset( v1, v1->x + x, v1->y + y );
+   lua_pushvalue(L,1);
+   return 1;
+}
+
+/**
+ * @brief Subtracts a vector or cartesian coordinates from a vector in place.
+ *
+ * @usage my_vec:sub_( your_vec ) -- my_vec is now my_vec - your_vec
+ *
+ *    @luatparam Vec2 v Vector to modify.
+ *    @luatparam number|Vec2 x X coordinate or vector to subtract.
+ *    @luatparam number|nil y Y coordinate or nil to subtract.
+ *    @luatreturn Vec2 The vector v itself.
+ * @luafunc sub_
+ */
+static int vectorL_subInPlace( lua_State *L )
+{
+   double x, y;
+   Vector2d *v1 = luaL_checkvector(L,1);
+   vectorL_checkxy( L, &x, &y );
+   vect_cset( v1, v1->x - x, v1->y - y );
+   lua_pushvalue(L,1);
+   return 1;
+}
+
+/**
+ * @brief Multiplies a vector by a number in place.
+ *
+ *    @luatparam Vec2 v Vector to modify.
+ *    @luatparam number mod Amount to multiply by.
+ *    @luatreturn Vec2 The vector v itself.
+ * @luafunc mul_
+ */
+static int vectorL_mulInPlace( lua_State *L )
+{
+   Vector2d *v1 = luaL_checkvector(L,1);
+   double mod   = luaL_checknumber(L,2);
+   vect_cset( v1, v1->x * mod, v1->y * mod );
+   lua_pushvalue(L,1);
+   return 1;
+}
+
+/**
+ * @brief Divides a vector by a number in place.
+ *
+ *    @luatparam Vec2 v Vector to modify.
+ *    @luatparam number mod Amount to divide by.
+ *    @luatreturn Vec2 The vector v itself.
+ * @luafunc div_
+ */
+static int vectorL_divInPlace( lua_State *L )
+{
+   Vector2d *v1 = luaL_checkvector(L,1);
+   double mod   = luaL_checknumber(L,2);
+   vect_cset( v1, v1->x / mod, v1->y / mod );
+   lua_pushvalue(L,1);
+   return 1;
+}
+
+/**
+ * @brief Normalizes a vector in place.
+ *
+ *    @luatparam Vec2 v Vector to normalize.
+ *    @luatreturn Vec2 The vector v itself.
+ * @luafunc normalize_
+ */
+static int vectorL_normalizeInPlace( lua_State *L )
+{
+   Vector2d *v = luaL_checkvector(L,1);
+   double m = VMOD(*v);
+   vect_cset( v, v->x / m, v->y / m );
+   lua_pushvalue(L,1);
+   return 1;
+}
+
+/**
+ * @brief Gets the cartesian coordinates of the difference of two vectors
+ *        without creating a new vector.
+ *
+ * @usage dx, dy = vec2.diff( target, pos ) -- Same as (target-pos):get()
+ *
+ *    @luatparam Vec2 a Vector to subtract from.
+ *    @luatparam Vec2 b Vector to subtract.
+ *    @luatreturn number X coordinate of a-b.
+ *    @luatreturn number Y coordinate of a-b.
+ * @luafunc diff
+ */
+static int vectorL_diff( lua_State *L )
+{
+   Vector2d *a = luaL_checkvector(L,1);
+   Vector2d *b = luaL_checkvector(L,2);
+   lua_pushnumber(L, a->x - b->x);
+   lua_pushnumber(L, a->y - b->y);
+   return 2;
+}
+
+/**
+ * @brief Gets the polar coordinates of the difference of two vectors without
+ *        creating a new vector.
+ *
+ * The angle is in radians.
+ *
+ * @usage dist, angle = vec2.polarDiff( target, pos ) -- Same as (target-pos):polar()
+ *
+ *    @luatparam Vec2 a Vector to subtract from.
+ *    @luatparam Vec2 b Vector to subtract.
+ *    @luatreturn number The modulus of a-b.
+ *    @luatreturn number The angle of a-b.
+ * @luafunc polarDiff
+ */
+static int vectorL_polarDiff( lua_State *L )
+{
+   Vector2d *a = luaL_checkvector(L,1);
+   Vector2d *b = luaL_checkvector(L,2);
+   double x = a->x - b->x;
+   double y = a->y - b->y;
+   lua_pushnumber(L, MOD(x,y));
+   lua_pushnumber(L, ANGLE(x,y));
+   return 2;
+}
@@ -311,6 +311,14 @@ static int gl_getGLInfo (void)
       gl_screen.flags |= OPENGL_DOUBLEBUF;
    if (GLAD_GL_ARB_shader_subroutine && glGetSubroutineIndex && glGetSubroutineUniformLocation && glUniformSubroutinesuiv)
       gl_screen.flags |= OPENGL_SUBROUTINES;
+   if (GLAD_GL_ARB_timer_query && glGetQueryObjectui64v)
+      gl_screen.flags |= OPENGL_TIMER_QUERY;
+   if (GLAD_GL_ARB_get_program_binary && glGetProgramBinary && glProgramBinary && glProgramParameteri) {
+      GLint nformats = 0;
+      glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &nformats );
+      if (nformats > 0)
+         gl_screen.flags |= OPENGL_PROGRAM_BINARY;
+   }
    /* Calculate real depth. */
    gl_screen.depth = gl_screen.r + gl_screen.g + gl_screen.b + gl_screen.a;
 
@@ -463,6 +471,7 @@ int gl_init (void)
    glBindVertexArray(VaoId);
 
    shaders_load();
+   gl_program_cacheReport();
 
    /* Set colorblind shader if necessary. */
    gl_colorblind( conf.colorblind );
@@ -617,7 +626,8 @@ void gl_colorblind( int enable )
       shader.VertexPosition = shaders.colorblind.VertexPosition;
       shader.ClipSpaceFromLocal = shaders.colorblind.ClipSpaceFromLocal;
       shader.MainTex    = shaders.colorblind.MainTex;
-      colorblind_pp = render_postprocessAdd( &shader, PP_LAYER_FINAL, 99 );
+      colorblind_pp = render_postprocessAdd( &shader, PP_LAYER_FINAL, 99,
+            PP_SHADER_PERMANENT | PP_SHADER_COLORBLIND );
    } else {
       if (colorblind_pp != 0)
          render_postprocessRm( colorblind_pp );
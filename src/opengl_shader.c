@@ -9,13 +9,33 @@
 
 #include "conf.h"
 #include "log.h"
+#include "md5.h"
 #include "ndata.h"
+#include "nfile.h"
 #include "nstring.h"
 #include "opengl.h"
 
 #define GLSL_VERSION    "#version 140\n\n" /**< Version to use for all shaders. */
 #define GLSL_SUBROUTINE "#define HAS_GL_ARB_shader_subroutine 1\n" /**< Has subroutines. */
 
+#define GLSL_CACHE_PATH    "glsl/" /**< Cache subdirectory for program binaries. */
+#define GLSL_CACHE_MAGIC   0x4e42494e /**< Magic number of program binary cache files. */
+
+/**
+ * @brief Header of a cached program binary file.
+ */
+typedef struct ProgramBinaryHeader_ {
+   uint32_t magic;   /**< Should be GLSL_CACHE_MAGIC. */
+   uint32_t format;  /**< Binary format as reported by the driver. */
+} ProgramBinaryHeader;
+
+/*
+ * Program binary cache statistics.
+ */
+static int gl_program_cache_hits     = 0; /**< Programs loaded from the cache. */
+static int gl_program_cache_misses   = 0; /**< Programs not in the cache. */
+static int gl_program_cache_rejected = 0; /**< Cached programs the driver refused. */
+
 /*
  * Prototypes.
  */
@@ -26,6 +46,12 @@ static GLuint gl_shader_compile( GLuint type, const char *buf,
       GLint length, const char *filename);
 static int gl_program_link( GLuint program );
 static GLuint gl_program_make( GLuint vertex_shader, GLuint fragment_shader );
+static void gl_program_cachePath( char *path, size_t pathlen,
+      const char *vbuf, size_t vlen, const char *fbuf, size_t flen );
+static GLuint gl_program_cacheLoad( const char *path );
+static void gl_program_cacheSave( GLuint program, const char *path );
+static GLuint gl_program_buf( const char *vbuf, size_t vlen, const char *fbuf, size_t flen,
+      const char *vertfile, const char *fragfile );
 static int gl_log_says_anything( const char* log );
 
 /**
@@ -217,6 +243,165 @@ static int gl_program_link( GLuint program )
    return 0;
 }
 
+/**
+ * @brief Computes the cache path of a program from its preprocessed sources.
+ *
+ * The driver identification is part of the hash so that binaries never get
+ * fed to a different driver or driver version.
+ *
+ *    @param[out] path Buffer to write the path to.
+ *    @param pathlen Length of the path buffer.
+ *    @param vbuf Preprocessed vertex shader.
+ *    @param vlen Length of the vertex shader.
+ *    @param fbuf Preprocessed fragment shader.
+ *    @param flen Length of the fragment shader.
+ */
+static void gl_program_cachePath( char *path, size_t pathlen,
+      const char *vbuf, size_t vlen, const char *fbuf, size_t flen )
+{
+   md5_state_t md5;
+   md5_byte_t md5val[16];
+   char digest[33];
+   const GLenum ids[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+
+   md5_init( &md5 );
+   for (size_t i=0; i<sizeof(ids)/sizeof(ids[0]); i++) {
+      const char *str = (const char*)glGetString( ids[i] );
+      if (str != NULL)
+         md5_append( &md5, (const md5_byte_t*)str, strlen(str)+1 );
+   }
+   md5_append( &md5, (const md5_byte_t*)vbuf, vlen );
+   md5_append( &md5, (const md5_byte_t*)"", 1 );
+   md5_append( &md5, (const md5_byte_t*)fbuf, flen );
+   md5_finish( &md5, md5val );
+
+   for (int i=0; i<16; i++)
+      snprintf( &digest[i * 2], 3, "%02x", md5val[i] );
+   snprintf( path, pathlen, "%s"GLSL_CACHE_PATH"%s.bin", nfile_cachePath(), digest );
+}
+
+/**
+ * @brief Tries to load a linked program from the binary cache.
+ *
+ *    @param path Path of the cached binary.
+ *    @return The program or 0 if not cached or rejected by the driver.
+ */
+static GLuint gl_program_cacheLoad( const char *path )
+{
+   char *buf;
+   size_t size;
+   ProgramBinaryHeader hdr;
+   GLuint program;
+   GLint link_status;
+
+   if (!nfile_fileExists( path )) {
+      gl_program_cache_misses++;
+      return 0;
+   }
+   buf = nfile_readFile( &size, path );
+   if (buf == NULL) {
+      gl_program_cache_misses++;
+      return 0;
+   }
+   if (size <= sizeof(hdr)) {
+      free( buf );
+      gl_program_cache_rejected++;
+      return 0;
+   }
+   memcpy( &hdr, buf, sizeof(hdr) );
+   if (hdr.magic != GLSL_CACHE_MAGIC) {
+      free( buf );
+      gl_program_cache_rejected++;
+      return 0;
+   }
+
+   program = glCreateProgram();
+   glProgramBinary( program, hdr.format, &buf[sizeof(hdr)], size-sizeof(hdr) );
+   free( buf );
+
+   /* Drivers are free to refuse binaries at any time, e.g., after an update. */
+   glGetProgramiv( program, GL_LINK_STATUS, &link_status );
+   if (link_status == GL_FALSE) {
+      glDeleteProgram( program );
+      /* Clear the error the driver may have raised for the binary. */
+      while (glGetError() != GL_NO_ERROR);
+      gl_program_cache_rejected++;
+      return 0;
+   }
+
+   gl_program_cache_hits++;
+   return program;
+}
+
+/**
+ * @brief Stores a linked program in the binary cache.
+ *
+ *    @param program Program to store.
+ *    @param path Path to store it at.
+ */
+static void gl_program_cacheSave( GLuint program, const char *path )
+{
+   GLint len;
+   GLenum format;
+   char *buf, dirpath[PATH_MAX];
+   ProgramBinaryHeader hdr;
+
+   glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &len );
+   if (len <= 0)
+      return;
+
+   buf = malloc( sizeof(hdr) + len );
+   glGetProgramBinary( program, len, &len, &format, &buf[sizeof(hdr)] );
+   if ((glGetError() != GL_NO_ERROR) || (len <= 0)) {
+      free( buf );
+      return;
+   }
+   hdr.magic  = GLSL_CACHE_MAGIC;
+   hdr.format = format;
+   memcpy( buf, &hdr, sizeof(hdr) );
+
+   snprintf( dirpath, sizeof(dirpath), "%s"GLSL_CACHE_PATH, nfile_cachePath() );
+   nfile_dirMakeExist( dirpath );
+   if (nfile_writeFile( buf, sizeof(hdr) + len, path ))
+      WARN(_("Failed to write program binary cache '%s'!"), path);
+   free( buf );
+}
+
+/**
+ * @brief Builds a program from preprocessed sources, going through the binary cache when possible.
+ *
+ *    @param vbuf Preprocessed vertex shader.
+ *    @param vlen Length of the vertex shader.
+ *    @param fbuf Preprocessed fragment shader.
+ *    @param flen Length of the fragment shader.
+ *    @param vertfile Vertex shader filename (for errors) or NULL.
+ *    @param fragfile Fragment shader filename (for errors) or NULL.
+ *    @return The shader program or 0 on failure.
+ */
+static GLuint gl_program_buf( const char *vbuf, size_t vlen, const char *fbuf, size_t flen,
+      const char *vertfile, const char *fragfile )
+{
+   GLuint vertex_shader, fragment_shader, program;
+   char path[PATH_MAX];
+   int cache = gl_has( OPENGL_PROGRAM_BINARY );
+
+   if (cache) {
+      gl_program_cachePath( path, sizeof(path), vbuf, vlen, fbuf, flen );
+      program = gl_program_cacheLoad( path );
+      if (program != 0)
+         return program;
+   }
+
+   vertex_shader     = gl_shader_compile( GL_VERTEX_SHADER, vbuf, vlen, vertfile );
+   fragment_shader   = gl_shader_compile( GL_FRAGMENT_SHADER, fbuf, flen, fragfile );
+
+   program = gl_program_make( vertex_shader, fragment_shader );
+   if (cache && (program != 0))
+      gl_program_cacheSave( program, path );
+
+   return program;
+}
+
 /**
  * @brief Loads a vertex and fragment shader from files.
  *
@@ -228,7 +413,7 @@ GLuint gl_program_vert_frag( const char *vertfile, const char *fragfile )
 {
    char *vert_str, *frag_str, prepend[STRMAX];
    size_t vert_size, frag_size;
-   GLuint vertex_shader, fragment_shader, program;
+   GLuint program;
 
    strncpy( prepend, GLSL_VERSION, sizeof(prepend)-1 );
    if (gl_has( OPENGL_SUBROUTINES ))
@@ -236,14 +421,18 @@ GLuint gl_program_vert_frag( const char *vertfile, const char *fragfile )
 
    vert_str = gl_shader_loadfile( vertfile, &vert_size, prepend );
    frag_str = gl_shader_loadfile( fragfile, &frag_size, prepend );
+   if ((vert_str == NULL) || (frag_str == NULL)) {
+      free( vert_str );
+      free( frag_str );
+      WARN(_("Failed to link vertex shader '%s' and fragment shader '%s'!"), vertfile, fragfile);
+      return 0;
+   }
 
-   vertex_shader     = gl_shader_compile( GL_VERTEX_SHADER, vert_str, vert_size, vertfile );
-   fragment_shader   = gl_shader_compile( GL_FRAGMENT_SHADER, frag_str, frag_size, fragfile );
+   program = gl_program_buf( vert_str, vert_size, frag_str, frag_size, vertfile, fragfile );
 
    free( vert_str );
    free( frag_str );
 
-   program = gl_program_make( vertex_shader, fragment_shader );
    if (program==0)
       WARN(_("Failed to link vertex shader '%s' and fragment shader '%s'!"), vertfile, fragfile);
 
@@ -261,23 +450,34 @@ GLuint gl_program_vert_frag( const char *vertfile, const char *fragfile )
  */
 GLuint gl_program_vert_frag_string( const char *vert, size_t vert_size, const char *frag, size_t frag_size )
 {
-   GLuint vertex_shader, fragment_shader;
+   GLuint program;
    char *vbuf, *fbuf;
    size_t vlen, flen;
 
    vbuf = gl_shader_preprocess( &vlen, vert, vert_size, NULL, NULL );
    fbuf = gl_shader_preprocess( &flen, frag, frag_size, NULL, NULL );
 
-   /* Compile the shaders. */
-   vertex_shader     = gl_shader_compile( GL_VERTEX_SHADER, vbuf, vlen, NULL );
-   fragment_shader   = gl_shader_compile( GL_FRAGMENT_SHADER, fbuf, flen, NULL );
+   /* Compile and link, or load from the cache. */
+   program = gl_program_buf( vbuf, vlen, fbuf, flen, NULL, NULL );
 
    /* Clean up. */
    free( vbuf );
    free( fbuf );
 
-   /* Link. */
-   return gl_program_make( vertex_shader, fragment_shader );
+   return program;
+}
+
+/**
+ * @brief Prints statistics of the program binary cache.
+ */
+void gl_program_cacheReport (void)
+{
+   if (!gl_has( OPENGL_PROGRAM_BINARY )) {
+      DEBUG(_("Program binary cache: unsupported"));
+      return;
+   }
+   DEBUG(_("Program binary cache: %d hits, %d misses, %d rejected"),
+         gl_program_cache_hits, gl_program_cache_misses, gl_program_cache_rejected );
 }
 
 /**
@@ -294,6 +494,8 @@ static GLuint gl_program_make( GLuint vertex_shader, GLuint fragment_shader )
       program = glCreateProgram();
       glAttachShader(program, vertex_shader);
       glAttachShader(program, fragment_shader);
+      if (gl_has( OPENGL_PROGRAM_BINARY ))
+         glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
       if (gl_program_link(program) == -1) {
          /* Spec specifies 0 as failure value for glCreateProgram() */
          program = 0;
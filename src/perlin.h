@@ -23,4 +23,7 @@ float noise_simplex1( perlin_data_t* noise, float f[1] );
 
 /* High level. */
 float* noise_genRadarInt( const int w, const int h, float rug );
-float* noise_genNebulaPuffMap( const int w, const int h, float rug );
+int noise_genNebulaPuffMaps( int n, const int *w, const int *h, float rug, float **maps );
+#if DEBUGGING
+void noise_benchmarkPuffs (void);
+#endif /* DEBUGGING */
@@ -36,6 +36,8 @@
 #include "map.h"
 #include "music.h"
 #include "ndata.h"
+#include "nlua_pilot.h"
+#include "nlua_pilotoutfit.h"
 #include "nstring.h"
 #include "ntime.h"
 #include "nxml.h"
@@ -53,6 +55,42 @@ static unsigned int pilot_id = PLAYER_ID; /**< Stack of pilot ids to assure uniq
 /* stack of pilots */
 static Pilot** pilot_stack = NULL; /**< All the pilots in space. (Player may have other Pilot objects, e.g. backup ships.) */
 
+/**
+ * @brief Slot of the pilot handle table.
+ *
+ * The slot of an ID is its low bits, and since IDs are never reused the
+ *  remaining bits act as the generation of the slot.
+ */
+typedef struct PilotHandle_ {
+   unsigned int id;  /**< ID of the pilot using the slot, 0 if it was never used. */
+   Pilot *p;         /**< Pilot with the ID, NULL if it was removed. */
+} PilotHandle;
+
+/**
+ * @brief Open addressed table resolving pilot IDs in constant time.
+ */
+typedef struct PilotHandleTable_ {
+   PilotHandle *h;   /**< Slots, the size is a power of two. */
+   unsigned int mask;/**< Number of slots minus one. */
+   int used;         /**< Slots with an ID, including removed pilots. */
+} PilotHandleTable;
+
+static PilotHandleTable pilot_handles = { .h = NULL, .mask = 0, .used = 0 }; /**< Handles of all the pilots in pilot_stack. */
+static unsigned int pilot_stack_gen = 0; /**< Bumped every frame and whenever pilot_stack changes. */
+
+/**
+ * @brief Pilot queued for rendering.
+ */
+typedef struct PilotRender_ {
+   Pilot *p;         /**< Pilot to render. */
+   const void *gfx;  /**< Ship graphic used as sort key. */
+   int id;           /**< Position in pilot_stack, to keep the order stable. */
+} PilotRender;
+
+static PilotRender *pilot_renderList = NULL; /**< Array (array.h): Visible pilots of the current frame. */
+static int pilot_renderVisible = 0; /**< Pilots rendered last frame. */
+static int pilot_renderCulled = 0; /**< Pilots culled last frame. */
+
 /* misc */
 static const double pilot_commTimeout  = 15.; /**< Time for text above pilot to time out. */
 static const double pilot_commFade     = 5.; /**< Time for text above pilot to fade out. */
@@ -71,8 +109,16 @@ static void pilot_refuel( Pilot *p, double dt );
 static void pilot_dead( Pilot* p, unsigned int killer );
 /* Misc. */
 static int pilot_getStackPos( unsigned int id );
+static Pilot* pilot_handleGet( const PilotHandleTable *t, unsigned int id );
+static void pilot_handleSet( PilotHandleTable *t, unsigned int id, Pilot *p );
+static void pilot_handleClear( PilotHandleTable *t );
+static void pilot_handlesRebuild (void);
 static void pilot_init_trails( Pilot* p );
 static int pilot_trail_generated( Pilot* p, int generator );
+/* Render. */
+static void pilot_renderTrails( Pilot* p );
+static int pilot_inView( const Pilot* p, double margin );
+static int pilot_renderCompare( const void *p1, const void *p2 );
 
 /**
  * @brief Gets the pilot stack.
@@ -82,6 +128,20 @@ Pilot*const* pilot_getAll (void)
    return pilot_stack;
 }
 
+/**
+ * @brief Gets the generation of the pilot stack.
+ *
+ * The generation changes every frame and whenever a pilot is added, removed
+ * or replaced, so anything derived from pilot_stack with the same generation
+ * is still valid.
+ *
+ *    @return Current generation of the pilot stack.
+ */
+unsigned int pilot_stackGeneration (void)
+{
+   return pilot_stack_gen;
+}
+
 /**
  * @brief Compare id (for use with bsearch)
  */
@@ -106,6 +166,166 @@ static int pilot_getStackPos( unsigned int id )
       return pp - pilot_stack;
 }
 
+/**
+ * @brief Looks up a pilot in a handle table.
+ *
+ *    @param t Table to look in.
+ *    @param id ID of the pilot to get.
+ *    @return The pilot or NULL if not found.
+ */
+static Pilot* pilot_handleGet( const PilotHandleTable *t, unsigned int id )
+{
+   if (t->h == NULL)
+      return NULL;
+   for (unsigned int i=id; ; i++) {
+      const PilotHandle *h = &t->h[ i & t->mask ];
+      if (h->id == id)
+         return h->p;
+      if (h->id == 0)
+         return NULL;
+   }
+}
+
+/**
+ * @brief Sets the pilot of an ID in a handle table, NULL removes it.
+ *
+ *    @param t Table to modify.
+ *    @param id ID to set.
+ *    @param p Pilot with the ID or NULL.
+ */
+static void pilot_handleSet( PilotHandleTable *t, unsigned int id, Pilot *p )
+{
+   PilotHandle *h, *free_h;
+
+   /* Keep at most half the slots used, dropping removed pilots when rehashing. */
+   if ((t->h == NULL) || (2*(t->used+1) > (int)t->mask+1)) {
+      PilotHandleTable n;
+      unsigned int live = 1;
+      unsigned int size = PILOT_SIZE_MIN;
+      for (unsigned int i=0; (t->h != NULL) && (i<=t->mask); i++)
+         if (t->h[i].p != NULL)
+            live++;
+      while (size < 4*live)
+         size *= 2;
+      n.h    = calloc( size, sizeof(PilotHandle) );
+      n.mask = size-1;
+      n.used = 0;
+      for (unsigned int i=0; (t->h != NULL) && (i<=t->mask); i++)
+         if (t->h[i].p != NULL)
+            pilot_handleSet( &n, t->h[i].id, t->h[i].p );
+      free( t->h );
+      *t = n;
+   }
+
+   free_h = NULL;
+   for (unsigned int i=id; ; i++) {
+      h = &t->h[ i & t->mask ];
+      if (h->id == id) {
+         h->p = p;
+         return;
+      }
+      if ((free_h == NULL) && (h->id != 0) && (h->p == NULL))
+         free_h = h;
+      if (h->id == 0)
+         break;
+   }
+   if (p == NULL)
+      return;
+
+   /* Reuse the slot of a removed pilot if we went past one. */
+   if (free_h != NULL)
+      h = free_h;
+   else
+      t->used++;
+   h->id = id;
+   h->p  = p;
+}
+
+/**
+ * @brief Empties a handle table.
+ *
+ *    @param t Table to clear.
+ */
+static void pilot_handleClear( PilotHandleTable *t )
+{
+   free( t->h );
+   t->h     = NULL;
+   t->mask  = 0;
+   t->used  = 0;
+}
+
+/**
+ * @brief Rebuilds the pilot handles from the pilot stack.
+ */
+static void pilot_handlesRebuild (void)
+{
+   pilot_handleClear( &pilot_handles );
+   pilot_stack_gen++;
+   for (int i=0; i<array_size(pilot_stack); i++)
+      pilot_handleSet( &pilot_handles, pilot_stack[i]->id, pilot_stack[i] );
+}
+
+#if DEBUGGING
+/**
+ * @brief Compares pilot lookups through the handle table against a binary search.
+ *
+ * Uses its own fixed pseudo-random sequence so the game RNG is left alone.
+ */
+void pilot_handleBenchmark (void)
+{
+   const int sizes[] = { 50, 500, 5000 };
+   const int lookups = 1000000;
+   unsigned int ids[4096]; /* Looked up cyclically, must be a power of two. */
+   Pilot *pilots, **stack;
+   PilotHandleTable t;
+   Uint64 t0, t1, t2;
+   uintptr_t sum;
+   uint32_t seed = 2463534242u;
+
+   DEBUG(_("Pilot lookup benchmark (%d lookups):"), lookups);
+   for (size_t k=0; k<sizeof(sizes)/sizeof(sizes[0]); k++) {
+      int n = sizes[k];
+      unsigned int id = PLAYER_ID;
+
+      /* IDs with gaps like a stack where pilots come and go. */
+      pilots = calloc( n, sizeof(Pilot) );
+      stack  = malloc( n * sizeof(Pilot*) );
+      memset( &t, 0, sizeof(t) );
+      for (int i=0; i<n; i++) {
+         seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+         id += 1 + seed % 4;
+         pilots[i].id = id;
+         stack[i] = &pilots[i];
+         pilot_handleSet( &t, id, &pilots[i] );
+      }
+      for (size_t i=0; i<sizeof(ids)/sizeof(ids[0]); i++) {
+         seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+         ids[i] = PLAYER_ID+1 + seed % (id - PLAYER_ID);
+      }
+
+      sum = 0;
+      t0 = SDL_GetPerformanceCounter();
+      for (int i=0; i<lookups; i++) {
+         Pilot **pp = bsearch( &ids[i & 4095], stack, n, sizeof(Pilot*), compid );
+         sum += (uintptr_t)pp;
+      }
+      t1 = SDL_GetPerformanceCounter();
+      for (int i=0; i<lookups; i++)
+         sum += (uintptr_t)pilot_handleGet( &t, ids[i & 4095] );
+      t2 = SDL_GetPerformanceCounter();
+
+      DEBUG(_("   %5d pilots: %6.1f ns bsearch, %6.1f ns handle (%u)"), n,
+            1e9 * (double)(t1-t0) / (double)SDL_GetPerformanceFrequency() / lookups,
+            1e9 * (double)(t2-t1) / (double)SDL_GetPerformanceFrequency() / lookups,
+            (unsigned int)(sum & 1) );
+
+      pilot_handleClear( &t );
+      free( stack );
+      free( pilots );
+   }
+}
+#endif /* DEBUGGING */
+
 /**
  * @brief Gets the next pilot based on id.
  *
@@ -580,17 +800,24 @@ double pilot_getNearestAng( const Pilot *p, unsigned int *tp, double ang, int di
  */
 Pilot* pilot_get( unsigned int id )
 {
-   int m;
+   Pilot *p;
 
    if (id==PLAYER_ID)
       return player.p; /* special case player.p */
 
-   m = pilot_getStackPos(id);
+   p = pilot_handleGet( &pilot_handles, id );
+#if DEBUG_PARANOID
+   {
+      int m = pilot_getStackPos(id);
+      if (p != ((m==-1) ? NULL : pilot_stack[m]))
+         WARN(_("Pilot handle of ID %u is out of sync with the pilot stack."), id);
+   }
+#endif /* DEBUG_PARANOID */
 
-   if ((m==-1) || (pilot_isFlag(pilot_stack[m], PILOT_DELETE)))
+   if ((p==NULL) || (pilot_isFlag(p, PILOT_DELETE)))
       return NULL;
    else
-      return pilot_stack[m];
+      return p;
 }
 
 /**
@@ -1801,6 +2028,16 @@ void pilot_render( Pilot* p, const double dt )
             p->tsx, p->tsy, &c );
    }
 
+   pilot_renderTrails( p );
+}
+
+/**
+ * @brief Renders the trails of a pilot that are drawn on top of it.
+ *
+ *    @param p Pilot to render trails of.
+ */
+static void pilot_renderTrails( Pilot* p )
+{
 #ifdef DEBUGGING
    double dircos, dirsin, x, y;
    int debug_mark_emitter = debug_isFlag(DEBUG_MARK_EMITTER);
@@ -2341,10 +2578,10 @@ void pilot_update( Pilot* pilot, double dt )
    /* Update the trail. */
    pilot_sample_trails( pilot, 0 );
 
-   /* Update outfits if necessary. */
+   /* Queue outfit updates, they are run for all pilots in pilots_outfitLUpdate(). */
    pilot->otimer += dt;
    while (pilot->otimer > PILOT_OUTFIT_LUA_UPDATE_DT) {
-      pilot_outfitLUpdate( pilot, PILOT_OUTFIT_LUA_UPDATE_DT );
+      pilot->oticks++;
       pilot->otimer -= PILOT_OUTFIT_LUA_UPDATE_DT;
    }
 }
@@ -2774,6 +3011,12 @@ static void pilot_init( Pilot* pilot, const Ship* ship, const char* name, int fa
    else
       pilot->id = ++pilot_id; /* new unique pilot id based on pilot_id, can't be 0 */
 
+   /* Pilots being added to the stack must be found while initializing, the AI may look them up. */
+   if ((array_size(pilot_stack) > 0) && (pilot_stack[array_size(pilot_stack)-1] == pilot)) {
+      pilot_handleSet( &pilot_handles, pilot->id, pilot );
+      pilot_stack_gen++;
+   }
+
    /* Defaults. */
    pilot->autoweap = 1;
    pilot->aimLines = 0;
@@ -2997,6 +3240,8 @@ Pilot* pilot_replacePlayer( Pilot* after )
       spfx_trail_remove( pilot_stack[i]->trail[j] );
    array_erase( &pilot_stack[i]->trail, array_begin(pilot_stack[i]->trail), array_end(pilot_stack[i]->trail) );
    pilot_stack[i] = after;
+   pilot_handleSet( &pilot_handles, after->id, after );
+   pilot_stack_gen++;
    pilot_init_trails( after );
    /* Run Lua stuff. */
    pilot_outfitLInitAll( after );
@@ -3103,6 +3348,11 @@ void pilot_free( Pilot* p )
 
    pilot_weapSetFree(p);
 
+   /* Drop the interned Lua userdata, the memory may be reused by new pilots. */
+   lua_uncachepilot( naevL, p->id );
+   for (int i=0; i<array_size(p->outfits); i++)
+      lua_uncachepilotoutfit( naevL, p->outfits[i] );
+
    array_free(p->outfits);
    array_free(p->outfit_structure);
    array_free(p->outfit_utility);
@@ -3176,6 +3426,8 @@ void pilot_destroy(Pilot* p)
    }
 
    /* pilot is eliminated */
+   pilot_handleSet( &pilot_handles, p->id, NULL );
+   pilot_stack_gen++;
    pilot_free(p);
    array_erase( &pilot_stack, &pilot_stack[i], &pilot_stack[i+1] );
 }
@@ -3208,7 +3460,13 @@ void pilots_free (void)
       pilot_free(pilot_stack[i]);
    array_free(pilot_stack);
    pilot_stack = NULL;
+   array_free(pilot_renderList);
+   pilot_renderList = NULL;
+   lua_freePilotGrid();
+   pilot_handleClear( &pilot_handles );
+   pilot_stack_gen++;
    player.p = NULL;
+   pilots_outfitLFree();
 }
 
 /**
@@ -3258,6 +3516,7 @@ void pilots_clean( int persist )
          pilot_free(pilot_stack[i]);
    }
    array_erase( &pilot_stack, &pilot_stack[persist_count], array_end(pilot_stack) );
+   pilot_handlesRebuild();
 
    /* Clear global hooks. */
    pilots_clearGlobalHooks();
@@ -3295,6 +3554,8 @@ void pilots_cleanAll (void)
       player.p = NULL;
    }
    array_erase( &pilot_stack, array_begin(pilot_stack), array_end(pilot_stack) );
+   pilot_handleClear( &pilot_handles );
+   pilot_stack_gen++;
 }
 
 /**
@@ -3304,6 +3565,9 @@ void pilots_cleanAll (void)
  */
 void pilots_update( double dt )
 {
+   /* Positions change from here on. */
+   pilot_stack_gen++;
+
    /* Delete loop - this should be atomic or we get hook fuckery! */
    for (int i=array_size(pilot_stack)-1; i>=0; i--) {
       Pilot *p = pilot_stack[i];
@@ -3371,6 +3635,9 @@ void pilots_update( double dt )
       if (p->update) /* update */
          p->update( p, dt );
    }
+
+   /* Run the Lua outfit updates queued by the pilots. */
+   pilots_outfitLUpdate();
 }
 
 /**
@@ -3380,15 +3647,88 @@ void pilots_update( double dt )
  */
 void pilots_render( double dt )
 {
+   if (pilot_renderList == NULL)
+      pilot_renderList = array_create_size( PilotRender, PILOT_SIZE_MIN );
+   array_resize( &pilot_renderList, 0 );
+   pilot_renderCulled = 0;
+
    for (int i=0; i<array_size(pilot_stack); i++) {
+      Pilot *p = pilot_stack[i];
+      PilotRender *pr;
 
       /* Invisible, not doing anything. */
-      if (pilot_isFlag(pilot_stack[i], PILOT_HIDE))
+      if (pilot_isFlag(p, PILOT_HIDE))
+         continue;
+
+      if (p->render == NULL)
          continue;
 
-      if (pilot_stack[i]->render != NULL) /* render */
-         pilot_stack[i]->render(pilot_stack[i], dt);
+      /* Off screen, only the trails can still reach into view. The radar
+       * works off pilot_stack so it is not affected. */
+      if (!pilot_inView( p, 0. )) {
+         if (!pilot_isFlag( p, PILOT_NORENDER ))
+            pilot_renderTrails( p );
+         pilot_renderCulled++;
+         continue;
+      }
+
+      pr       = &array_grow( &pilot_renderList );
+      pr->p    = p;
+      pr->gfx  = (p->ship->gfx_3d != NULL) ? (const void*)p->ship->gfx_3d : (const void*)p->ship->gfx_space;
+      pr->id   = i;
    }
+   pilot_renderVisible = array_size( pilot_renderList );
+
+   /* Group by hull so consecutive draws share the same texture. */
+   qsort( pilot_renderList, array_size(pilot_renderList), sizeof(PilotRender), pilot_renderCompare );
+   for (int i=0; i<array_size(pilot_renderList); i++)
+      pilot_renderList[i].p->render( pilot_renderList[i].p, dt );
+}
+
+/**
+ * @brief Checks to see if a pilot is on screen.
+ *
+ *    @param p Pilot to check.
+ *    @param margin Extra size in game units to add to the sprite radius.
+ *    @return 1 if the pilot may be visible, 0 otherwise.
+ */
+static int pilot_inView( const Pilot* p, double margin )
+{
+   double x, y, r, z;
+   const glTexture *gfx = p->ship->gfx_space;
+
+   /* Same bounds as gl_renderSpriteInterpolateScale uses for the sprite. */
+   gl_gameToScreenCoords( &x, &y, p->solid->pos.x, p->solid->pos.y );
+   z = cam_getZoom();
+   r = (MAX( gfx->sw, gfx->sh ) + margin) * z;
+   if ((x < -r) || (x > SCREEN_W+r) ||
+         (y < -r) || (y > SCREEN_H+r))
+      return 0;
+   return 1;
+}
+
+/**
+ * @brief Sorts pilots to render by ship graphic, keeping the stack order otherwise.
+ */
+static int pilot_renderCompare( const void *p1, const void *p2 )
+{
+   const PilotRender *r1 = p1;
+   const PilotRender *r2 = p2;
+   if (r1->gfx != r2->gfx)
+      return (r1->gfx < r2->gfx) ? -1 : 1;
+   return r1->id - r2->id;
+}
+
+/**
+ * @brief Gets the pilot rendering statistics of the last frame.
+ *
+ *    @param[out] visible Number of pilots rendered.
+ *    @param[out] culled Number of pilots skipped for being off screen.
+ */
+void pilots_renderStats( int *visible, int *culled )
+{
+   *visible = pilot_renderVisible;
+   *culled  = pilot_renderCulled;
 }
 
 /**
@@ -3399,13 +3739,19 @@ void pilots_render( double dt )
 void pilots_renderOverlay( double dt )
 {
    for (int i=0; i<array_size(pilot_stack); i++) {
+      Pilot *p = pilot_stack[i];
 
       /* Invisible, not doing anything. */
-      if (pilot_isFlag(pilot_stack[i], PILOT_HIDE))
+      if (pilot_isFlag(p, PILOT_HIDE))
+         continue;
+
+      /* Messages have to keep timing out even when off screen. */
+      if ((p->comm_msg == NULL) && (!pilot_isFlag(p, PILOT_HAILING) ||
+               !pilot_inView( p, MAX( p->ship->gfx_space->sw, p->ship->gfx_space->sh ) )))
          continue;
 
-      if (pilot_stack[i]->render_overlay != NULL) /* render */
-         pilot_stack[i]->render_overlay(pilot_stack[i], dt);
+      if (p->render_overlay != NULL) /* render */
+         p->render_overlay(p, dt);
    }
 }
 
@@ -3426,6 +3772,7 @@ void pilot_clearTimers( Pilot *pilot )
    pilot->stimer     = 0.; /* Shield timer. */
    pilot->dtimer     = 0.; /* Disable timer. */
    pilot->otimer     = 0.; /* Outfit timer. */
+   pilot->oticks     = 0;
    for (int i=0; i<MAX_AI_TIMERS; i++)
       pilot->timer[i] = 0.; /* Specific AI timers. */
    n = 0;
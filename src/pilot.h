@@ -224,6 +224,7 @@ typedef struct Pilot_ {
    /* Properties. */
    int cpu;       /**< Amount of CPU the pilot has left. */
    int cpu_max;   /**< Maximum amount of CPU the pilot has. */
+   int cpu_outfits; /**< CPU used by the outfits, negative. */
    double crew;   /**< Crew amount the player has (display it as (int)floor(), but it's analogue. */
    double cap_cargo;/**< Pilot's cargo capacity. */
 
@@ -255,6 +256,7 @@ typedef struct Pilot_ {
    double energy_regen; /**< Energy regeneration rate (per second). */
    double energy_tau; /**< Tau regeneration rate for energy. */
    double energy_loss; /**< Linear loss that bypasses the actual RC circuit stuff. */
+   double energy_loss_outfits; /**< Part of energy_loss coming from the outfits. */
 
    /* Defensive Electronic Warfare. */
    double ew_detection; /**< Main detection. */
@@ -280,6 +282,8 @@ typedef struct Pilot_ {
    /* Ship statistics. */
    ShipStats intrinsic_stats; /**< Intrinsic statistics to the ship create on the fly. */
    ShipStats stats;  /**< Pilot's copy of ship statistics, used for comparisons.. */
+   ShipStats stats_outfits; /**< Cached stat layer of the outfits. */
+   ShipStats stats_lua; /**< Cached stat layer of the Lua outfit modifiers. */
 
    /* Associated functions */
    void (*think)(struct Pilot_*, const double); /**< AI thinking for the pilot */
@@ -357,6 +361,7 @@ typedef struct Pilot_ {
    double dtimer;    /**< Disable timer. */
    double dtimer_accum; /**< Accumulated disable timer. */
    double otimer;    /**< Lua outfit timer. */
+   int oticks;       /**< Lua outfit updates due this frame. */
    double scantimer; /**< Electronic warfare scanning timer. */
    int hail_pos;     /**< Hail animation position. */
    int lockons;      /**< Stores how many seeking weapons are targeting pilot */
@@ -380,6 +385,7 @@ typedef struct Pilot_ {
  * Getting pilot stuff.
  */
 Pilot*const* pilot_getAll (void);
+unsigned int pilot_stackGeneration (void);
 Pilot* pilot_get( unsigned int id );
 Pilot* pilot_getTarget( Pilot *p );
 unsigned int pilot_getNextID( unsigned int id, int mode );
@@ -460,6 +466,9 @@ void pilot_delete( Pilot *p );
 void pilot_destroy( Pilot* p );
 void pilots_init (void);
 void pilots_free (void);
+#if DEBUGGING
+void pilot_handleBenchmark (void);
+#endif /* DEBUGGING */
 void pilots_clean (int persist);
 void pilots_newSystem (void);
 void pilots_clear (void);
@@ -479,6 +488,7 @@ void pilot_update( Pilot* pilot, double dt );
 void pilots_update( double dt );
 void pilots_render( double dt );
 void pilots_renderOverlay( double dt );
+void pilots_renderStats( int *visible, int *culled );
 void pilot_render( Pilot* pilot, const double dt );
 void pilot_renderOverlay( Pilot* p, const double dt );
 
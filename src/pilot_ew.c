@@ -554,7 +554,7 @@ void pilot_destealth( Pilot *p )
    pilot_rmFlag( p, PILOT_STEALTH );
    p->ew_stealth_timer = 0.;
    if (!pilot_outfitLOnstealth( p ))
-      pilot_calcStats(p);
+      pilot_calcStatsLayers( p, PILOT_STATS_STEALTH );
 
    /* Run hook. */
    const HookParam hparam = { .type = HOOK_PARAM_BOOL, .u.b = 0 };
@@ -94,9 +94,6 @@ int pilot_runHookParam( Pilot* p, int hook_type, const HookParam* param, int npa
    /* Clean up. */
    free( hdynparam );
 
-   if (run > 0)
-      claim_activateAll(); /* Reset claims. */
-
    return run;
 }
 
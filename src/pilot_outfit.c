@@ -7,6 +7,8 @@
  * @brief Handles pilot outfits.
  */
 /** @cond */
+#include <stdlib.h>
+
 #include "naev.h"
 /** @endcond */
 
@@ -26,10 +28,29 @@
 #include "nlua_pilot.h"
 #include "nlua_pilotoutfit.h"
 
+/**
+ * @brief A pending run of a Lua outfit update script.
+ */
+typedef struct OutfitLUpdate_ {
+   nlua_env env;        /**< Environment of the outfit. */
+   unsigned int id;     /**< ID of the pilot. */
+   int slot;            /**< Position of the slot in the pilot's outfits. */
+   const Outfit *outfit;/**< Outfit in the slot when the update was queued. */
+   int ticks;           /**< Number of times to run the update. */
+   int modified;        /**< 1 if the Lua stats changed, 2 if the outfit state changed. */
+} OutfitLUpdate;
+static OutfitLUpdate *outfitl_updates = NULL; /**< Pending Lua outfit updates, reused every frame. */
+
 /*
  * Prototypes.
  */
 static int pilot_hasOutfitLimit( const Pilot *p, const char *limit );
+static void pilot_calcStatsOutfits( Pilot* pilot );
+static void pilot_calcStatsLua( Pilot* pilot );
+static const ShipStats* pilot_systemStats (void);
+static void pilot_calcStatsFinal( Pilot* pilot, double tm );
+static int outfitl_cmpEnv( const void *a, const void *b );
+static int outfitl_cmpPilot( const void *a, const void *b );
 
 /**
  * @brief Updates the lockons on the pilot's launchers
@@ -856,53 +877,55 @@ void pilot_fillAmmo( Pilot* pilot )
  */
 void pilot_calcStats( Pilot* pilot )
 {
-   double ac, sc, ec, tm; /* temporary health coefficients to set */
-   ShipStats *s;
+   pilot_calcStatsLayers( pilot, PILOT_STATS_ALL );
+}
+
+/**
+ * @brief Recalculates the pilot's stats when only some of the sources changed.
+ *
+ * The stats are the combination of a few layers: ship, outfits, intrinsic,
+ * system, Lua outfit modifiers and stealth. The outfit and Lua layers are
+ * cached in the pilot and only rebuilt when marked as dirty, the rest are
+ * cheap to combine and always merged again.
+ *
+ *    @param pilot Pilot to recalculate his stats.
+ *    @param dirty Layers that changed (PILOT_STATS_*).
+ */
+void pilot_calcStatsLayers( Pilot* pilot, unsigned int dirty )
+{
+   double tm = pilot->stats.time_mod;
+
+   if (dirty & PILOT_STATS_OUTFITS)
+      pilot_calcStatsOutfits( pilot );
+   if (dirty & PILOT_STATS_LUA)
+      pilot_calcStatsLua( pilot );
+
+   pilot_calcStatsFinal( pilot, tm );
+}
+
+/**
+ * @brief Rebuilds the outfit layer of the pilot's stats.
+ *
+ * Also sets the outfit mass, CPU usage and energy loss.
+ *
+ *    @param pilot Pilot to rebuild the outfit layer of.
+ */
+static void pilot_calcStatsOutfits( Pilot* pilot )
+{
+   ShipStats *s = &pilot->stats_outfits;
 
-   /*
-    * set up the basic stuff
-    */
    /* mass */
-   pilot->solid->mass   = pilot->ship->mass;
-   pilot->base_mass     = pilot->solid->mass;
+   pilot->base_mass     = pilot->ship->mass;
+   pilot->mass_outfit   = 0.;
    /* cpu */
-   pilot->cpu           = 0.;
-   /* movement */
-   pilot->thrust_base   = pilot->ship->thrust;
-   pilot->turn_base     = pilot->ship->turn;
-   pilot->speed_base    = pilot->ship->speed;
-   /* crew */
-   pilot->crew          = pilot->ship->crew;
-   /* cargo */
-   pilot->cap_cargo     = pilot->ship->cap_cargo;
-   /* fuel_consumption. */
-   pilot->fuel_consumption = pilot->ship->fuel_consumption;
-   /* health */
-   ac = (pilot->armour_max > 0.) ? pilot->armour / pilot->armour_max : 0.;
-   sc = (pilot->shield_max > 0.) ? pilot->shield / pilot->shield_max : 0.;
-   ec = (pilot->energy_max > 0.) ? pilot->energy / pilot->energy_max : 0.;
-   pilot->armour_max    = pilot->ship->armour;
-   pilot->shield_max    = pilot->ship->shield;
-   pilot->fuel_max      = pilot->ship->fuel;
-   pilot->armour_regen  = pilot->ship->armour_regen;
-   pilot->shield_regen  = pilot->ship->shield_regen;
-   /* Absorption. */
-   pilot->dmg_absorb    = pilot->ship->dmg_absorb;
+   pilot->cpu_outfits   = 0.;
    /* Energy. */
-   pilot->energy_max    = pilot->ship->energy;
-   pilot->energy_regen  = pilot->ship->energy_regen;
-   pilot->energy_loss   = 0.; /* Initially no net loss. */
+   pilot->energy_loss_outfits = 0.;
    /* Misc. */
    pilot->outfitlupdate = 0;
    /* Stats. */
-   s = &pilot->stats;
-   tm = s->time_mod;
-   *s = pilot->ship->stats_array;
+   ss_statsInit( s );
 
-   /*
-    * Now add outfit changes
-    */
-   pilot->mass_outfit   = 0.;
    for (int i=0; i<array_size(pilot->outfits); i++) {
       PilotOutfitSlot *slot = pilot->outfits[i];
       const Outfit* o       = slot->outfit;
@@ -912,7 +935,7 @@ void pilot_calcStats( Pilot* pilot )
          continue;
 
       /* Modify CPU. */
-      pilot->cpu           += outfit_cpu(o);
+      pilot->cpu_outfits   += outfit_cpu(o);
 
       /* Add mass. */
       pilot->mass_outfit   += o->mass;
@@ -929,10 +952,6 @@ void pilot_calcStats( Pilot* pilot )
       if (outfit_isAfterburner(o)) /* Afterburner */
          pilot->afterburner = pilot->outfits[i]; /* Set afterburner */
 
-      /* Lua mods apply their stats. */
-      if (slot->lua_mem != LUA_NOREF)
-         ss_statsMerge( &pilot->stats, &slot->lua_stats );
-
       /* Apply modifications. */
       if (outfit_isMod(o)) { /* Modification */
          /* Has update function. */
@@ -952,20 +971,102 @@ void pilot_calcStats( Pilot* pilot )
          /* Add stats. */
          ss_statsModFromList( s, o->stats );
          pilot_setFlag( pilot, PILOT_AFTERBURNER ); /* We use old school flags for this still... */
-         pilot->energy_loss += pilot->afterburner->outfit->u.afb.energy; /* energy loss */
+         pilot->energy_loss_outfits += pilot->afterburner->outfit->u.afb.energy; /* energy loss */
       }
       else {
          /* Always add stats for non mod/afterburners. */
          ss_statsModFromList( s, o->stats );
       }
    }
+}
+
+/**
+ * @brief Rebuilds the Lua outfit modifier layer of the pilot's stats.
+ *
+ *    @param pilot Pilot to rebuild the Lua layer of.
+ */
+static void pilot_calcStatsLua( Pilot* pilot )
+{
+   ss_statsInit( &pilot->stats_lua );
+   for (int i=0; i<array_size(pilot->outfits); i++) {
+      const PilotOutfitSlot *slot = pilot->outfits[i];
+      if ((slot->outfit != NULL) && (slot->lua_mem != LUA_NOREF))
+         ss_statsMerge( &pilot->stats_lua, &slot->lua_stats );
+   }
+}
 
-   /* Merge stats. */
-   ss_statsMerge( &pilot->stats, &pilot->intrinsic_stats );
+/**
+ * @brief Gets the stat layer of the current system.
+ *
+ * It is the same for all the pilots, so it is only built when the system
+ * changes.
+ */
+static const ShipStats* pilot_systemStats (void)
+{
+   static ShipStats sys_stats;
+   static const ShipStatList *sys_list = NULL;
+   static int sys_init = 0;
+   const ShipStatList *list = (cur_system != NULL) ? cur_system->stats : NULL;
+
+   if (!sys_init || (list != sys_list)) {
+      ss_statsInit( &sys_stats );
+      if (list != NULL)
+         ss_statsModFromList( &sys_stats, list );
+      sys_list = list;
+      sys_init = 1;
+   }
+   return &sys_stats;
+}
 
-   /* Apply system effects. */
-   if (cur_system->stats != NULL)
-      ss_statsModFromList( &pilot->stats, cur_system->stats );
+/**
+ * @brief Combines the stat layers and computes all the values derived from
+ *        the stats.
+ *
+ *    @param pilot Pilot to recalculate his stats.
+ *    @param tm Time modifier before the stats changed.
+ */
+static void pilot_calcStatsFinal( Pilot* pilot, double tm )
+{
+   double ac, sc, ec; /* temporary health coefficients to set */
+   ShipStats *s;
+
+   /* mass */
+   pilot->solid->mass   = pilot->ship->mass;
+   /* cpu */
+   pilot->cpu           = pilot->cpu_outfits;
+   /* movement */
+   pilot->thrust_base   = pilot->ship->thrust;
+   pilot->turn_base     = pilot->ship->turn;
+   pilot->speed_base    = pilot->ship->speed;
+   /* crew */
+   pilot->crew          = pilot->ship->crew;
+   /* cargo */
+   pilot->cap_cargo     = pilot->ship->cap_cargo;
+   /* fuel_consumption. */
+   pilot->fuel_consumption = pilot->ship->fuel_consumption;
+   /* health */
+   ac = (pilot->armour_max > 0.) ? pilot->armour / pilot->armour_max : 0.;
+   sc = (pilot->shield_max > 0.) ? pilot->shield / pilot->shield_max : 0.;
+   ec = (pilot->energy_max > 0.) ? pilot->energy / pilot->energy_max : 0.;
+   pilot->armour_max    = pilot->ship->armour;
+   pilot->shield_max    = pilot->ship->shield;
+   pilot->fuel_max      = pilot->ship->fuel;
+   pilot->armour_regen  = pilot->ship->armour_regen;
+   pilot->shield_regen  = pilot->ship->shield_regen;
+   /* Absorption. */
+   pilot->dmg_absorb    = pilot->ship->dmg_absorb;
+   /* Energy. */
+   pilot->energy_max    = pilot->ship->energy;
+   pilot->energy_regen  = pilot->ship->energy_regen;
+   pilot->energy_loss   = pilot->energy_loss_outfits;
+
+   /* Combine the layers. */
+   s = &pilot->stats;
+   *s = pilot->ship->stats_array;
+   ss_statsMerge( s, &pilot->stats_outfits );
+   ss_statsMerge( s, &pilot->intrinsic_stats );
+   ss_statsMerge( s, pilot_systemStats() );
+   ss_statsMerge( s, &pilot->stats_lua );
 
    /* Apply stealth malus. */
    if (pilot_isFlag(pilot, PILOT_STEALTH)) {
@@ -1241,43 +1342,151 @@ int pilot_outfitLInit( Pilot *pilot, PilotOutfitSlot *po )
 }
 
 /**
- * @brief Runs the pilot's Lua outfits update script.
- *
- *    @param pilot Pilot to run Lua outfits for.
- *    @param dt Delta-tick from last time it was run.
+ * @brief Compares pending Lua outfit updates so they are grouped by outfit
+ *        environment (for use with qsort).
  */
-void pilot_outfitLUpdate( Pilot *pilot, double dt )
+static int outfitl_cmpEnv( const void *a, const void *b )
 {
-   if (!pilot->outfitlupdate)
-      return;
+   const OutfitLUpdate *ua = a;
+   const OutfitLUpdate *ub = b;
+   if (ua->env != ub->env)
+      return (ua->env < ub->env) ? -1 : +1;
+   if (ua->id != ub->id)
+      return (ua->id < ub->id) ? -1 : +1;
+   return ua->slot - ub->slot;
+}
 
-   pilotoutfit_modified = 0;
-   for (int i=0; i<array_size(pilot->outfits); i++) {
-      PilotOutfitSlot *po = pilot->outfits[i];
-      if (po->outfit==NULL || !outfit_isMod(po->outfit))
+/**
+ * @brief Compares pending Lua outfit updates so they are grouped by pilot
+ *        (for use with qsort).
+ */
+static int outfitl_cmpPilot( const void *a, const void *b )
+{
+   const OutfitLUpdate *ua = a;
+   const OutfitLUpdate *ub = b;
+   if (ua->id != ub->id)
+      return (ua->id < ub->id) ? -1 : +1;
+   return ua->slot - ub->slot;
+}
+
+/**
+ * @brief Runs the Lua outfits update scripts of all the pilots.
+ *
+ * Pilots only accumulate the updates they are due in pilot_update(), which
+ * are then dispatched here grouped by outfit so that each update function
+ * runs for all the pilots that have the outfit in one go. Stats are
+ * recalculated once per pilot afterwards, and only the Lua layer is rebuilt
+ * unless an outfit state changed.
+ */
+void pilots_outfitLUpdate (void)
+{
+   Pilot *const* pilot_stack = pilot_getAll();
+   const double dt = PILOT_OUTFIT_LUA_UPDATE_DT;
+   int n;
+
+   if (outfitl_updates == NULL)
+      outfitl_updates = array_create( OutfitLUpdate );
+   array_resize( &outfitl_updates, 0 );
+
+   /* Gather the pending updates. */
+   for (int i=0; i<array_size(pilot_stack); i++) {
+      Pilot *p = pilot_stack[i];
+      int ticks = p->oticks;
+      p->oticks = 0;
+      if ((ticks <= 0) || !p->outfitlupdate)
          continue;
-      if (po->outfit->u.mod.lua_update == LUA_NOREF)
+      if (pilot_isFlag(p, PILOT_DELETE))
          continue;
+      for (int j=0; j<array_size(p->outfits); j++) {
+         PilotOutfitSlot *po = p->outfits[j];
+         if (po->outfit==NULL || !outfit_isMod(po->outfit))
+            continue;
+         if (po->outfit->u.mod.lua_update == LUA_NOREF)
+            continue;
+         OutfitLUpdate *u = &array_grow( &outfitl_updates );
+         u->env      = po->outfit->u.mod.lua_env;
+         u->id       = p->id;
+         u->slot     = j;
+         u->outfit   = po->outfit;
+         u->ticks    = ticks;
+         u->modified = 0;
+      }
+   }
+   n = array_size(outfitl_updates);
+   if (n <= 0)
+      return;
 
-      nlua_env env = po->outfit->u.mod.lua_env;
-
-      /* Set the memory. */
-      lua_rawgeti(naevL, LUA_REGISTRYINDEX, po->lua_mem); /* mem */
-      nlua_setenv(env, "mem"); /* */
-
-      /* Set up the function: update( p, po, dt ) */
-      lua_rawgeti(naevL, LUA_REGISTRYINDEX, po->outfit->u.mod.lua_update); /* f */
-      lua_pushpilot(naevL, pilot->id); /* f, p */
-      lua_pushpilotoutfit(naevL, po);  /* f, p, po */
-      lua_pushnumber(naevL, dt);       /* f, p, po, dt */
-      if (nlua_pcall( env, 3, 0 )) {   /* */
-         WARN( _("Pilot '%s''s outfit '%s' -> 'update':\n%s"), pilot->name, po->outfit->name, lua_tostring(naevL,-1));
-         lua_pop(naevL, 1);
+   /* Run them grouped by outfit. */
+   qsort( outfitl_updates, n, sizeof(OutfitLUpdate), outfitl_cmpEnv );
+   for (int i=0; i<n; ) {
+      nlua_env env = outfitl_updates[i].env;
+      int f = outfitl_updates[i].outfit->u.mod.lua_update;
+      lua_rawgeti(naevL, LUA_REGISTRYINDEX, f); /* f */
+      for (; (i<n) && (outfitl_updates[i].env==env); i++) {
+         OutfitLUpdate *u = &outfitl_updates[i];
+         Pilot *p = pilot_get( u->id );
+         if ((p==NULL) || (u->slot >= array_size(p->outfits)))
+            continue;
+         PilotOutfitSlot *po = p->outfits[u->slot];
+         for (int k=0; k<u->ticks; k++) {
+            PilotOutfitState state;
+
+            /* Outfit may have been changed by a script. */
+            if (po->outfit != u->outfit)
+               break;
+            state = po->state;
+            pilotoutfit_modified = 0;
+
+            /* Set the memory. */
+            lua_rawgeti(naevL, LUA_REGISTRYINDEX, po->lua_mem); /* f, mem */
+            nlua_setenv(env, "mem"); /* f */
+
+            /* Set up the function: update( p, po, dt ) */
+            lua_pushvalue(naevL, -1);        /* f, f */
+            lua_pushpilot(naevL, p->id);     /* f, f, p */
+            lua_pushpilotoutfit(naevL, po);  /* f, f, p, po */
+            lua_pushnumber(naevL, dt);       /* f, f, p, po, dt */
+            if (nlua_pcall( env, 3, 0 )) {   /* f */
+               WARN( _("Pilot '%s''s outfit '%s' -> 'update':\n%s"), p->name, po->outfit->name, lua_tostring(naevL,-1));
+               lua_pop(naevL, 1);            /* f */
+            }
+
+            /* State changes affect the outfit stats, Lua stats alone don't. */
+            if (po->state != state)
+               u->modified = 2;
+            else if (pilotoutfit_modified)
+               u->modified = MAX( u->modified, 1 );
+         }
       }
+      lua_pop(naevL, 1); /* */
    }
-   /* Recalculate if anything changed. */
-   if (pilotoutfit_modified)
-      pilot_calcStats( pilot );
+
+   /* Recalculate the stats of the pilots that changed. */
+   qsort( outfitl_updates, n, sizeof(OutfitLUpdate), outfitl_cmpPilot );
+   for (int i=0; i<n; ) {
+      unsigned int id = outfitl_updates[i].id;
+      int modified = 0;
+      for (; (i<n) && (outfitl_updates[i].id==id); i++)
+         modified = MAX( modified, outfitl_updates[i].modified );
+      if (modified == 0)
+         continue;
+      Pilot *p = pilot_get( id );
+      if (p == NULL)
+         continue;
+      if (modified > 1)
+         pilot_calcStatsLayers( p, PILOT_STATS_OUTFITS | PILOT_STATS_LUA );
+      else
+         pilot_calcStatsLayers( p, PILOT_STATS_LUA );
+   }
+}
+
+/**
+ * @brief Frees the memory used for dispatching the Lua outfit updates.
+ */
+void pilots_outfitLFree (void)
+{
+   array_free( outfitl_updates );
+   outfitl_updates = NULL;
 }
 
 /**
@@ -7,6 +7,15 @@
 
 #define PILOT_OUTFIT_LUA_UPDATE_DT     (1.0/10.0)   /* How often the Lua outfits run their update script (in seconds).  */
 
+/* Stat layers for pilot_calcStatsLayers(). */
+#define PILOT_STATS_OUTFITS   (1<<0) /**< Outfit stats, mass and CPU. */
+#define PILOT_STATS_INTRINSIC (1<<1) /**< Intrinsic stats. */
+#define PILOT_STATS_SYSTEM    (1<<2) /**< Stats of the current system. */
+#define PILOT_STATS_STEALTH   (1<<3) /**< Stealth malus. */
+#define PILOT_STATS_LUA       (1<<4) /**< Lua outfit modifiers. */
+#define PILOT_STATS_ALL       (PILOT_STATS_OUTFITS | PILOT_STATS_INTRINSIC | \
+      PILOT_STATS_SYSTEM | PILOT_STATS_STEALTH | PILOT_STATS_LUA) /**< Everything. */
+
 /* Raw changes. */
 int pilot_addOutfitRaw( Pilot* pilot, const Outfit* outfit, PilotOutfitSlot *s );
 int pilot_addOutfitTest( Pilot* pilot, const Outfit* outfit, PilotOutfitSlot *s, int warn );
@@ -37,6 +46,7 @@ void pilot_lockClear( Pilot *p );
 
 /* Other. */
 void pilot_calcStats( Pilot *pilot );
+void pilot_calcStatsLayers( Pilot *pilot, unsigned int dirty );
 void pilot_updateMass( Pilot *pilot );
 void pilot_healLanded( Pilot *pilot );
 
@@ -49,7 +59,8 @@ int pilot_outfitLAdd( Pilot *pilot, PilotOutfitSlot *po );
 int pilot_outfitLRemove( Pilot *pilot, PilotOutfitSlot *po );
 void pilot_outfitLInitAll( Pilot *pilot );
 int pilot_outfitLInit( Pilot *pilot, PilotOutfitSlot *po );
-void pilot_outfitLUpdate( Pilot *pilot, double dt );
+void pilots_outfitLUpdate (void);
+void pilots_outfitLFree (void);
 void pilot_outfitLOutfofenergy( Pilot *pilot );
 void pilot_outfitLOnhit( Pilot *pilot, double armour, double shield, unsigned int attacker );
 int pilot_outfitLOntoggle( Pilot *pilot, PilotOutfitSlot *po, int on );
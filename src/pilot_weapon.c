@@ -1504,7 +1504,7 @@ void pilot_afterburn (Pilot *p)
       p->afterburner->state  = PILOT_OUTFIT_ON;
       p->afterburner->stimer = outfit_duration( p->afterburner->outfit );
       pilot_setFlag(p,PILOT_AFTERBURNER);
-      pilot_calcStats( p );
+      pilot_calcStatsLayers( p, PILOT_STATS_OUTFITS );
       pilot_destealth( p ); /* No afterburning stealth. */
 
       /* @todo Make this part of a more dynamic activated outfit sound system. */
@@ -1532,7 +1532,7 @@ void pilot_afterburnOver (Pilot *p)
    if (p->afterburner->state == PILOT_OUTFIT_ON) {
       p->afterburner->state  = PILOT_OUTFIT_OFF;
       pilot_rmFlag(p,PILOT_AFTERBURNER);
-      pilot_calcStats( p );
+      pilot_calcStatsLayers( p, PILOT_STATS_OUTFITS );
 
       /* @todo Make this part of a more dynamic activated outfit sound system. */
       sound_playPos(p->afterburner->outfit->u.afb.sound_off,
@@ -41,19 +41,65 @@ typedef struct PPShader_s {
    GLint VertexTexCoord;
    /* Textures. */
    LuaTexture_t *tex;
+   /* Pass state. */
+   unsigned int flags; /**< PP_SHADER_* flags. */
+   int screen_w; /**< Screen width the static uniforms were last uploaded for. */
+   int screen_h; /**< Screen height the static uniforms were last uploaded for. */
+   GLuint query; /**< GPU timer query or 0 when not timing. */
+   int query_pending; /**< Whether the query result has not been read yet. */
+   double gpu_time; /**< Last measured GPU time of the pass in milliseconds. */
 } PPShader;
 
+/**
+ * @brief Statistics of the post-processing passes run in a frame.
+ */
+typedef struct PPStats_ {
+   int npasses; /**< Number of passes run. */
+   int timed; /**< Whether any of the passes is timed. */
+   double gpu_time; /**< Sum of the last measured GPU times in milliseconds. */
+} PPStats;
+
 static unsigned int pp_shaders_id = 0;
 static PPShader *pp_shaders_list[PP_LAYER_MAX]; /**< Post-processing shaders for game layer. */
+static PPShader **pp_passes[PP_LAYER_MAX]; /**< Array (array.h): Passes of a layer, only valid until the layer is rendered. */
+static PPStats pp_stats; /**< Statistics of the passes run so far this frame. */
+static PPStats pp_stats_last; /**< Statistics of the passes run in the last frame. */
+static gl_Matrix4 pp_ortho; /**< Projection used by all the passes. */
 
 static LuaShader_t gamma_correction_shader;
 static int pp_gamma_correction = 0; /**< Gamma correction shader. */
+static PPShader pp_fused; /**< Gamma correction and colour blindness in a single pass. */
+
+/*
+ * Prototypes.
+ */
+static void render_ppInit( PPShader *pp, const LuaShader_t *shader, int priority, unsigned int flags );
+static PPShader *render_ppFind( unsigned int id, int *layer );
+static int render_ppPasses( int layer );
+static void render_ppLayer( double dt, int layer, int *current, int done );
 
 /**
  * @brief Renders an FBO.
  */
 static void render_fbo( double dt, GLuint fbo, GLuint tex, PPShader *shader )
 {
+   int timing;
+
+   /* Collect the timing of a previous frame, never stall on it. */
+   if (shader->query_pending) {
+      GLint available;
+      glGetQueryObjectiv( shader->query, GL_QUERY_RESULT_AVAILABLE, &available );
+      if (available) {
+         GLuint64 ns;
+         glGetQueryObjectui64v( shader->query, GL_QUERY_RESULT, &ns );
+         shader->gpu_time = (double)ns / 1e6;
+         shader->query_pending = 0;
+      }
+   }
+   timing = (shader->query != 0) && !shader->query_pending;
+   if (timing)
+      glBeginQuery( GL_TIME_ELAPSED, shader->query );
+
    /* Have to consider alpha premultiply. */
    glBlendFuncSeparate( GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
 
@@ -61,10 +107,18 @@ static void render_fbo( double dt, GLuint fbo, GLuint tex, PPShader *shader )
 
    glUseProgram( shader->program );
 
-   /* Screen size. */
-   if (shader->love_ScreenSize >= 0)
-      /* TODO don't have to upload this every frame, only when resized... */
-      glUniform4f( shader->love_ScreenSize, SCREEN_W, SCREEN_H, 1., 0. );
+   /* Static uniforms. Programs that may also be used for regular rendering
+    * (Lua shaders) can have them changed behind our back, so those always
+    * get uploaded. */
+   if (!(shader->flags & PP_SHADER_PERMANENT) ||
+         (shader->screen_w != SCREEN_W) || (shader->screen_h != SCREEN_H)) {
+      if (shader->love_ScreenSize >= 0)
+         glUniform4f( shader->love_ScreenSize, SCREEN_W, SCREEN_H, 1., 0. );
+      glUniform1i( shader->MainTex, 0 );
+      gl_Matrix4_Uniform( shader->ClipSpaceFromLocal, pp_ortho );
+      shader->screen_w = SCREEN_W;
+      shader->screen_h = SCREEN_H;
+   }
 
    /* Time stuff. */
    if (shader->u_time >= 0) {
@@ -82,7 +136,6 @@ static void render_fbo( double dt, GLuint fbo, GLuint tex, PPShader *shader )
 
    /* Set the texture(s). */
    glBindTexture( GL_TEXTURE_2D, tex );
-   glUniform1i( shader->MainTex, 0 );
    for (int i=0; i<array_size(shader->tex); i++) {
       LuaTexture_t *t = &shader->tex[i];
       glActiveTexture( t->active );
@@ -91,9 +144,6 @@ static void render_fbo( double dt, GLuint fbo, GLuint tex, PPShader *shader )
    }
    glActiveTexture( GL_TEXTURE0 );
 
-   /* Set shader uniforms. */
-   gl_Matrix4_Uniform(shader->ClipSpaceFromLocal, gl_Matrix4_Ortho(0, 1, 1, 0, 1, -1));
-
    /* Draw. */
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
 
@@ -105,12 +155,56 @@ static void render_fbo( double dt, GLuint fbo, GLuint tex, PPShader *shader )
 
    /* Restore the default mode. */
    glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+   if (timing) {
+      glEndQuery( GL_TIME_ELAPSED );
+      shader->query_pending = 1;
+   }
+}
+
+/**
+ * @brief Works out the passes to run for a layer.
+ *
+ * Passes flagged as no-ops are skipped, and gamma correction directly
+ * followed by colour blindness is fused into a single pass.
+ *
+ *    @param layer Layer to get passes of.
+ *    @return Number of passes to run.
+ */
+static int render_ppPasses( int layer )
+{
+   PPShader *list = pp_shaders_list[layer];
+
+   if (pp_passes[layer] == NULL)
+      pp_passes[layer] = array_create( PPShader* );
+   array_resize( &pp_passes[layer], 0 );
+
+   for (int i=0; i<array_size(list); i++) {
+      PPShader *pp = &list[i];
+      if (pp->flags & PP_SHADER_NOOP)
+         continue;
+
+      if (pp->flags & PP_SHADER_GAMMA) {
+         int j = i+1;
+         while ((j < array_size(list)) && (list[j].flags & PP_SHADER_NOOP))
+            j++;
+         if ((j < array_size(list)) && (list[j].flags & PP_SHADER_COLORBLIND)) {
+            array_push_back( &pp_passes[layer], &pp_fused );
+            i = j;
+            continue;
+         }
+      }
+
+      array_push_back( &pp_passes[layer], pp );
+   }
+
+   return array_size( pp_passes[layer] );
 }
 
 /**
  * @brief Renders a list of FBOs.
  */
-static void render_fbo_list( double dt, PPShader *list, int *current, int done )
+static void render_fbo_list( double dt, PPShader **list, int *current, int done )
 {
    PPShader *pplast;
    int i, cur, next;
@@ -118,7 +212,7 @@ static void render_fbo_list( double dt, PPShader *list, int *current, int done )
 
    /* Render all except the last post-process shader. */
    for (i=0; i<array_size(list)-1; i++) {
-      PPShader *pp = &list[i];
+      PPShader *pp = list[i];
       next = 1-cur;
       /* Render cur to next. */
       render_fbo( dt, gl_screen.fbo[next], gl_screen.fbo_tex[cur], pp );
@@ -126,7 +220,7 @@ static void render_fbo_list( double dt, PPShader *list, int *current, int done )
    }
 
    /* Final render is to the screen. */
-   pplast = &list[i];
+   pplast = list[i];
    if (done) {
       gl_screen.current_fbo = 0;
       /* Do the render. */
@@ -149,6 +243,37 @@ static void render_fbo_list( double dt, PPShader *list, int *current, int done )
    *current = cur;
 }
 
+/**
+ * @brief Runs the post-processing passes of a layer.
+ *
+ * Lua run earlier in the frame (hooks, the GUI, the toolkit) may have added
+ * or removed shaders, so the passes are worked out right before they are
+ * run and not kept afterwards.
+ *
+ *    @param dt Current delta tick.
+ *    @param layer Layer to run passes of.
+ *    @param[in,out] current Framebuffer currently being drawn to.
+ *    @param done Whether this is the last layer and the result goes to the screen.
+ */
+static void render_ppLayer( double dt, int layer, int *current, int done )
+{
+   /* Already drawing to the screen, new shaders have to wait a frame. */
+   if (gl_screen.current_fbo == 0)
+      return;
+
+   if (render_ppPasses( layer ) > 0) {
+      render_fbo_list( dt, pp_passes[layer], current, done );
+      for (int i=0; i<array_size(pp_passes[layer]); i++) {
+         const PPShader *pp = pp_passes[layer][i];
+         if (pp->query != 0)
+            pp_stats.timed = 1;
+         pp_stats.gpu_time += pp->gpu_time;
+      }
+      pp_stats.npasses += array_size(pp_passes[layer]);
+      array_resize( &pp_passes[layer], 0 );
+   }
+}
+
 /**
  * @brief Renders the game itself (player flying around and friends).
  *
@@ -173,10 +298,14 @@ void render_all( double game_dt, double real_dt )
    int pp_final, pp_gui, pp_game;
    int cur = 0;
 
-   /* See what post-processing is up. */
-   pp_game  = (array_size(pp_shaders_list[PP_LAYER_GAME]) > 0);
-   pp_gui   = (array_size(pp_shaders_list[PP_LAYER_GUI]) > 0);
-   pp_final = (array_size(pp_shaders_list[PP_LAYER_FINAL]) > 0);
+   /* See what post-processing is up. The passes themselves are worked out
+    * again right before each layer is run. */
+   pp_game  = (render_ppPasses( PP_LAYER_GAME ) > 0);
+   pp_gui   = (render_ppPasses( PP_LAYER_GUI ) > 0);
+   pp_final = (render_ppPasses( PP_LAYER_FINAL ) > 0);
+   for (int i=0; i<PP_LAYER_MAX; i++)
+      array_resize( &pp_passes[i], 0 );
+   memset( &pp_stats, 0, sizeof(PPStats) );
 
    /* Case we have a post-processing shader we use the framebuffers. */
    if (pp_game || pp_gui || pp_final) {
@@ -221,13 +350,13 @@ void render_all( double game_dt, double real_dt )
 
    /* Process game stuff only. */
    if (pp_game)
-      render_fbo_list( dt, pp_shaders_list[PP_LAYER_GAME], &cur, !(pp_final || pp_gui) );
+      render_ppLayer( dt, PP_LAYER_GAME, &cur, !(pp_final || pp_gui) );
 
    /* GUi stuff. */
    gui_render(dt);
 
    if (pp_gui)
-      render_fbo_list( dt, pp_shaders_list[PP_LAYER_GUI], &cur, !pp_final );
+      render_ppLayer( dt, PP_LAYER_GUI, &cur, !pp_final );
 
    /* Top stuff. */
    ovr_render( real_dt ); /* Using real_dt is sort of a hack for now. */
@@ -236,7 +365,18 @@ void render_all( double game_dt, double real_dt )
 
    /* Final post-processing. */
    if (pp_final)
-      render_fbo_list( dt, pp_shaders_list[PP_LAYER_FINAL], &cur, 1 );
+      render_ppLayer( dt, PP_LAYER_FINAL, &cur, 1 );
+   pp_stats_last = pp_stats;
+
+   /* Shaders removed during the frame can leave it in a framebuffer. */
+   if (gl_screen.current_fbo != 0) {
+      glBindFramebuffer( GL_READ_FRAMEBUFFER, gl_screen.current_fbo );
+      glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+      glBlitFramebuffer( 0, 0, gl_screen.rw, gl_screen.rh, 0, 0, gl_screen.rw, gl_screen.rh,
+            GL_COLOR_BUFFER_BIT, GL_NEAREST );
+      gl_screen.current_fbo = 0;
+      glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+   }
 
    /* check error every loop */
    gl_checkErr();
@@ -257,14 +397,44 @@ static int ppshader_compare( const void *a, const void *b )
    return 0;
 }
 
+/**
+ * @brief Initializes a post-processing pass from a shader.
+ */
+static void render_ppInit( PPShader *pp, const LuaShader_t *shader, int priority, unsigned int flags )
+{
+   memset( pp, 0, sizeof(PPShader) );
+   pp->priority         = priority;
+   pp->flags            = flags;
+   pp->program          = shader->program;
+   pp->ClipSpaceFromLocal = shader->ClipSpaceFromLocal;
+   pp->MainTex          = shader->MainTex;
+   pp->VertexPosition   = shader->VertexPosition;
+   pp->VertexTexCoord   = shader->VertexTexCoord;
+   if (shader->tex != NULL)
+      pp->tex = array_copy( LuaTexture_t, shader->tex );
+   else
+      pp->tex = NULL;
+   /* Special uniforms. */
+   pp->u_time = glGetUniformLocation( pp->program, "u_time" );
+   pp->love_ScreenSize = glGetUniformLocation( pp->program, "love_ScreenSize" );
+   pp->dt = 0.;
+   pp->screen_w = -1;
+   pp->screen_h = -1;
+   /* Only time the passes when developing, queries aren't free. */
+   if (conf.devmode && gl_has( OPENGL_TIMER_QUERY ))
+      glGenQueries( 1, &pp->query );
+}
+
 /**
  * @brief Adds a new post-processing shader.
  *
  *    @param shader Shader to add.
+ *    @param layer Layer to add the shader to.
  *    @param priority When it should be run (lower is sooner).
+ *    @param flags PP_SHADER_* flags of the shader.
  *    @return The shader ID.
  */
-unsigned int render_postprocessAdd( LuaShader_t *shader, int layer, int priority )
+unsigned int render_postprocessAdd( LuaShader_t *shader, int layer, int priority, unsigned int flags )
 {
    PPShader *pp, **pp_shaders;
    unsigned int id;
@@ -280,21 +450,8 @@ unsigned int render_postprocessAdd( LuaShader_t *shader, int layer, int priority
       *pp_shaders = array_create( PPShader );
    pp = &array_grow( pp_shaders );
    id = ++pp_shaders_id;
-   pp->id               = id;
-   pp->priority         = priority;
-   pp->program          = shader->program;
-   pp->ClipSpaceFromLocal = shader->ClipSpaceFromLocal;
-   pp->MainTex          = shader->MainTex;
-   pp->VertexPosition   = shader->VertexPosition;
-   pp->VertexTexCoord   = shader->VertexTexCoord;
-   if (shader->tex != NULL)
-      pp->tex = array_copy( LuaTexture_t, shader->tex );
-   else
-      pp->tex = NULL;
-   /* Special uniforms. */
-   pp->u_time = glGetUniformLocation( pp->program, "u_time" );
-   pp->love_ScreenSize = glGetUniformLocation( pp->program, "love_ScreenSize" );
-   pp->dt = 0.;
+   render_ppInit( pp, shader, priority, flags );
+   pp->id = id;
 
    /* Resort n case stuff is weird. */
    qsort( *pp_shaders, array_size(*pp_shaders), sizeof(PPShader), ppshader_compare );
@@ -305,42 +462,89 @@ unsigned int render_postprocessAdd( LuaShader_t *shader, int layer, int priority
 }
 
 /**
- * @brief Removes a post-process shader by ID.
+ * @brief Finds a post-process shader by ID.
  *
- *    @param id ID of shader to remove.
- *    @return 0 on success.
+ *    @param id ID of the shader to find.
+ *    @param[out] layer Layer the shader is in.
+ *    @return The shader or NULL if not found.
  */
-int render_postprocessRm( unsigned int id )
+static PPShader *render_ppFind( unsigned int id, int *layer )
 {
-   int j;
-   int found = -1;
-   for (j=0; j<PP_LAYER_MAX; j++) {
+   for (int j=0; j<PP_LAYER_MAX; j++) {
       PPShader *pp_shaders = pp_shaders_list[j];
       for (int i=0; i<array_size(pp_shaders); i++) {
-         PPShader *pp = &pp_shaders[i];
-         if (pp->id != id)
+         if (pp_shaders[i].id != id)
             continue;
-         found = i;
-         break;
+         *layer = j;
+         return &pp_shaders[i];
       }
-      if (found>=0)
-         break;
    }
-   if (found==-1) {
+   return NULL;
+}
+
+/**
+ * @brief Removes a post-process shader by ID.
+ *
+ *    @param id ID of shader to remove.
+ *    @return 0 on success.
+ */
+int render_postprocessRm( unsigned int id )
+{
+   int j;
+   PPShader *pp = render_ppFind( id, &j );
+   if (pp==NULL) {
       WARN(_("Trying to remove non-existant post-processing shader with id '%d'!"), id);
       return -1;
    }
 
    /* No need to resort. */
-   array_erase( &pp_shaders_list[j], &pp_shaders_list[j][found], &pp_shaders_list[j][found+1] );
+   if (pp->query != 0)
+      glDeleteQueries( 1, &pp->query );
+   array_free( pp->tex );
+   array_erase( &pp_shaders_list[j], pp, pp+1 );
+   return 0;
+}
+
+/**
+ * @brief Marks a post-process shader as doing nothing so its pass gets skipped.
+ *
+ *    @param id ID of the shader to mark.
+ *    @param noop Whether or not the shader is a no-op.
+ *    @return 0 on success.
+ */
+int render_postprocessSetNoop( unsigned int id, int noop )
+{
+   int j;
+   PPShader *pp = render_ppFind( id, &j );
+   if (pp==NULL) {
+      WARN(_("Trying to modify non-existant post-processing shader with id '%d'!"), id);
+      return -1;
+   }
+   if (noop)
+      pp->flags |= PP_SHADER_NOOP;
+   else
+      pp->flags &= ~PP_SHADER_NOOP;
    return 0;
 }
 
+/**
+ * @brief Gets the GPU time spent on post-processing.
+ *
+ *    @param[out] npasses Number of passes that were run.
+ *    @return Last measured GPU time in milliseconds or a negative value if not timed.
+ */
+double render_postprocessGPUTime( int *npasses )
+{
+   *npasses = pp_stats_last.npasses;
+   return (pp_stats_last.timed) ? pp_stats_last.gpu_time : -1.;
+}
+
 /**
  * @brief Sets up the post-processing stuff.
  */
 void render_init (void)
 {
+   LuaShader_t fused;
    LuaShader_t *s = &gamma_correction_shader;
    memset( s, 0, sizeof(LuaShader_t) );
    s->program            = shaders.gamma_correction.program;
@@ -348,6 +552,17 @@ void render_init (void)
    s->ClipSpaceFromLocal = shaders.gamma_correction.ClipSpaceFromLocal;
    s->MainTex            = shaders.gamma_correction.MainTex;
 
+   /* Fused gamma and colour blindness pass. */
+   memset( &fused, 0, sizeof(LuaShader_t) );
+   fused.program            = shaders.colortransform.program;
+   fused.VertexPosition     = shaders.colortransform.VertexPosition;
+   fused.ClipSpaceFromLocal = shaders.colortransform.ClipSpaceFromLocal;
+   fused.MainTex            = shaders.colortransform.MainTex;
+   fused.VertexTexCoord     = -1;
+   render_ppInit( &pp_fused, &fused, 0, PP_SHADER_PERMANENT );
+
+   pp_ortho = gl_Matrix4_Ortho(0, 1, 1, 0, 1, -1);
+
    /* Initialize the gamma. */
    render_setGamma( conf.gamma_correction );
 }
@@ -358,9 +573,20 @@ void render_init (void)
 void render_exit (void)
 {
    for (int i=0; i<PP_LAYER_MAX; i++) {
+      for (int j=0; j<array_size(pp_shaders_list[i]); j++) {
+         PPShader *pp = &pp_shaders_list[i][j];
+         if (pp->query != 0)
+            glDeleteQueries( 1, &pp->query );
+         array_free( pp->tex );
+      }
       array_free( pp_shaders_list[i] );
       pp_shaders_list[i] = NULL;
+      array_free( pp_passes[i] );
+      pp_passes[i] = NULL;
    }
+   if (pp_fused.query != 0)
+      glDeleteQueries( 1, &pp_fused.query );
+   memset( &pp_fused, 0, sizeof(PPShader) );
 }
 
 /**
@@ -377,9 +603,12 @@ void render_setGamma( double gamma )
    if (fabs(gamma-1.) < 1e-3)
       return;
 
-   /* Set gamma and upload. */
+   /* Set gamma and upload, the fused pass needs it too. */
    glUseProgram( shaders.gamma_correction.program );
    glUniform1f( shaders.gamma_correction.gamma, gamma );
+   glUseProgram( shaders.colortransform.program );
+   glUniform1f( shaders.colortransform.gamma, gamma );
    glUseProgram( 0 );
-   pp_gamma_correction = render_postprocessAdd( &gamma_correction_shader, PP_LAYER_FINAL, 98 );
+   pp_gamma_correction = render_postprocessAdd( &gamma_correction_shader, PP_LAYER_FINAL, 98,
+         PP_SHADER_PERMANENT | PP_SHADER_GAMMA );
 }
@@ -12,13 +12,20 @@ enum {
    PP_LAYER_MAX,
 };
 
+#define PP_SHADER_PERMANENT   (1<<0) /**< Program is only used for post-processing, so static uniforms stay set. */
+#define PP_SHADER_NOOP        (1<<1) /**< Shader currently does nothing and its pass is skipped. */
+#define PP_SHADER_GAMMA       (1<<2) /**< Gamma correction, can be fused with a following colour blindness pass. */
+#define PP_SHADER_COLORBLIND  (1<<3) /**< Colour blindness simulation. */
+
 void fps_setPos( double x, double y );
 void render_all( double game_dt, double real_dt );
 void render_init (void);
 void render_exit (void);
 
-unsigned int render_postprocessAdd( LuaShader_t *shader, int layer, int priority );
+unsigned int render_postprocessAdd( LuaShader_t *shader, int layer, int priority, unsigned int flags );
 int render_postprocessRm( unsigned int id );
+int render_postprocessSetNoop( unsigned int id, int noop );
+double render_postprocessGPUTime( int *npasses );
 
 /* Special post-processing shaders. */
 void render_setGamma( double gamma );
@@ -12,6 +12,7 @@
 #include <errno.h>
 #include <math.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include "SDL.h"
@@ -39,6 +40,15 @@ static uint32_t MT[624]; /**< Mersenne twister state. */
 static uint32_t mt_y; /**< Internal mersenne twister variable. */
 static int mt_pos = 0; /**< Current number being used. */
 
+#if DEBUGGING
+/*
+ * state set aside while running on a fixed seed
+ */
+static uint32_t rng_savedMT[624]; /**< Saved mersenne twister state. */
+static int rng_savedPos = 0; /**< Saved current number. */
+static int rng_seeded = 0; /**< Whether the game's state is set aside. */
+#endif /* DEBUGGING */
+
 /*
  * prototypes
  */
@@ -82,6 +92,41 @@ void rng_init (void)
       mt_genArray();
 }
 
+#if DEBUGGING
+/**
+ * @brief Sets the game's random state aside and runs from a fixed seed.
+ *
+ * Lets benchmarks be repeatable without changing what the game rolls next.
+ * Must be paired with rng_restore.
+ *
+ *    @param seed Seed to run from.
+ */
+void rng_seedFixed( unsigned int seed )
+{
+   if (rng_seeded) {
+      WARN(_("Random state already set aside!"));
+      return;
+   }
+   memcpy( rng_savedMT, MT, sizeof(MT) );
+   rng_savedPos = mt_pos;
+   rng_seeded   = 1;
+   mt_initArray( seed );
+   mt_genArray();
+}
+
+/**
+ * @brief Brings back the game's random state set aside by rng_seedFixed.
+ */
+void rng_restore (void)
+{
+   if (!rng_seeded)
+      return;
+   memcpy( MT, rng_savedMT, sizeof(MT) );
+   mt_pos     = rng_savedPos;
+   rng_seeded = 0;
+}
+#endif /* DEBUGGING */
+
 /**
  * @fn static uint32_t rng_timeEntropy (void)
  *
@@ -40,6 +40,10 @@
 
 /* Init */
 void rng_init (void);
+#if DEBUGGING
+void rng_seedFixed( unsigned int seed );
+void rng_restore (void);
+#endif /* DEBUGGING */
 
 /* Random functions */
 unsigned int randint (void);
@@ -39,6 +39,9 @@
 #include "array.h"
 #include "conf.h"
 #include "log.h"
+#include "md5.h"
+#include "nfile.h"
+#include "unidiff.h"
 #include "union_find.h"
 
 /*
@@ -48,6 +51,8 @@ static const double ALPHA            = 9.;       /**< Lane efficiency parameter.
 static const double LAMBDA           = 2e10;     /**< Regularization term for score. */
 static const double JUMP_CONDUCTIVITY= 0.001;    /**< Conductivity value for inter-system jump-point connections. */
 static const double MIN_ANGLE        = M_PI/18.; /**< Path triangles can't be more acute. */
+static const uint32_t CACHE_MAGIC    = 0x534c4e53; /**< "SLNS": Identifies a persisted safe-lane solution. */
+static const uint32_t CACHE_VERSION  = 1;        /**< Bump whenever the solution or its layout changes. */
 enum {
    STORAGE_MODE_LOWER_TRIANGULAR_PART= -1,       /**< A CHOLMOD "stype" value: matrix is interpreted as symmetric. */
    STORAGE_MODE_UNSYMMETRIC          = 0,        /**< A CHOLMOD "stype" value: matrix holds whatever we put in it. */
@@ -82,6 +87,18 @@ typedef struct Faction_ {
    double lane_base_cost;           /**< Base cost of a lane. */
 } Faction;
 
+/** @brief A digest of everything a system's lanes depend on. */
+typedef md5_byte_t Digest[16];
+
+/** @brief Header of a persisted safe-lane solution. The stacks follow it in declaration order. */
+typedef struct CacheHeader_ {
+   uint32_t magic;   /**< CACHE_MAGIC. */
+   uint32_t version; /**< CACHE_VERSION. */
+   int32_t nsys;     /**< Number of systems. */
+   int32_t nvertex;  /**< Number of vertices. */
+   int32_t nedge;    /**< Number of edges. */
+} CacheHeader;
+
 /** @brief A set of lane-building factions, represented as a bitfield. */
 typedef uint32_t FactionMask;
 static const FactionMask MASK_0 = 0, MASK_1 = 1;
@@ -109,12 +126,20 @@ static cholmod_sparse *QtQ;     /**< (Q*)Q where Q is the ExV difference matrix.
 static cholmod_dense *ftilde;   /**< Fluxes (bunch of F columns in the KU=F problem). */
 static cholmod_dense *utilde;   /**< Potentials (bunch of U columns in the KU=F problem). */
 static cholmod_dense **PPl;     /**< Array: (array.h): For each builder faction, The (P*)P in: grad_u(phi)=(Q*)Q U~ (P*)P. */
+static cholmod_factor *stiff_f; /**< Factorization of the stiffness matrix. Kept current across turns with rank updates. */
+static int *tmp_activated;      /**< Array (array.h): Edges activated since stiff_f was last brought up to date. */
+static Digest *sys_digest;      /**< Array (array.h): Per system, the digest of its lane inputs as of the last calculation. */
+static int *sys_component;      /**< Array (array.h): Per system, the lowest system index in its component as of the last calculation. */
+static int *sys_dirty;          /**< Array (array.h): Per system, whether the last calculation re-optimized its lanes. */
+static Digest faction_digest;   /**< Digest of the lane-building factions' parameters as of the last calculation. */
+static Uint32 safelanes_full_time = 0; /**< How long the last full (non-incremental) calculation took, in ms. */
 static double* cmp_key_ref;     /**< To qsort() a list of indices by table value, point this at your table and use cmp_key. */
 static int safelanes_calculated_once = 0; /**< Whether or not the safe lanes have been computed once. */
 
 /*
  * Prototypes.
  */
+static int safelanes_calculate( int force_full );
 static int safelanes_buildOneTurn( int iters_done );
 static int safelanes_activateByGradient( cholmod_dense* Lambda_tilde, int iters_done );
 static void safelanes_initStacks (void);
@@ -126,6 +151,13 @@ static void safelanes_initOptimizer (void);
 static void safelanes_destroyOptimizer (void);
 static void safelanes_destroyStacks (void);
 static void safelanes_destroyTmp (void);
+static int safelanes_initDirty( int force_full, const int* old_lane_faction, const int* old_sys_to_first_edge );
+static void safelanes_systemDigest( int system, Digest digest );
+static void safelanes_factionDigest( Digest digest );
+static void safelanes_updateFactor (void);
+static void safelanes_cachePath( char *path, size_t len, const char *digest );
+static int safelanes_cacheLoad( const char *digest );
+static void safelanes_cacheSave( const char *digest );
 static void safelanes_initStiff (void);
 static double safelanes_initialConductivity ( int ei );
 static void safelanes_updateConductivity ( int ei_activated );
@@ -174,6 +206,10 @@ void safelanes_destroy (void)
 {
    safelanes_destroyOptimizer();
    safelanes_destroyStacks();
+   array_free( sys_digest );
+   sys_digest = NULL;
+   array_free( sys_component );
+   sys_component = NULL;
    cholmod_finish( &C );
 }
 
@@ -245,26 +281,111 @@ SafeLane* safelanes_get( int faction, int standing, const StarSystem* system )
 
 /**
  * @brief Update the safe lane locations in response to the universe changing (e.g., diff applied).
+ *
+ * Lanes in different connected components (systems linked by 2-way jumps) don't interact, so only the components whose
+ * inputs changed since the last calculation get re-optimized; the rest keep their lanes.
  */
 void safelanes_recalculate (void)
 {
-   Uint32 time = SDL_GetTicks();
-
    /* Don't recompute on exit. */
    if (naev_isQuit())
       return;
 
+#if DEBUG_PARANOID
+   if (safelanes_calculated_once) {
+      int *lanes_incr, ndiff;
+      Uint32 time_incr, time_full;
+
+      /* Check the incremental result against a full recalculation, and report how the timings compare. */
+      time_incr = SDL_GetTicks();
+      safelanes_calculate( 0 );
+      time_incr = SDL_GetTicks() - time_incr;
+      lanes_incr = array_copy( int, lane_faction );
+      time_full = SDL_GetTicks();
+      safelanes_calculate( 1 );
+      time_full = SDL_GetTicks() - time_full;
+      ndiff = 0;
+      for (int i=0; i<array_size(lane_faction); i++)
+         if (lanes_incr[i] != lane_faction[i])
+            ndiff++;
+      DEBUG( _("Safe lanes: incremental update took %.3f s, full recalculation took %.3f s; %d of %d edges differ."),
+            time_incr/1000., time_full/1000., ndiff, array_size(lane_faction) );
+      array_free( lanes_incr );
+      return;
+   }
+#endif /* DEBUG_PARANOID */
+
+   safelanes_calculate( 0 );
+   safelanes_calculated_once = 1;
+}
+
+/**
+ * @brief Computes the safe lanes, re-optimizing only what changed since the last time unless told otherwise.
+ *
+ *    @param force_full Whether to re-optimize every system regardless.
+ *    @return Number of systems that were re-optimized.
+ */
+static int safelanes_calculate( int force_full )
+{
+   int *old_lane_faction, *old_sys_to_first_edge, ndirty, nsys;
+   const char *digest;
+   Uint32 time = SDL_GetTicks();
+
+   /* The solution only depends on the universe state, so we may have charted this one before. */
+   digest = force_full ? NULL : diff_universeDigest();
+   if ((digest != NULL) && (safelanes_cacheLoad( digest ) == 0)) {
+      if (conf.devmode)
+         DEBUG( _("Loaded cached safe lanes for %d objects in %.3f s."), array_size(vertex_stack), (SDL_GetTicks()-time)/1000. );
+      return 0;
+   }
+
+   /* Hold on to the previous solution: untouched systems keep their lanes. */
+   old_lane_faction = lane_faction;
+   old_sys_to_first_edge = sys_to_first_edge;
+   lane_faction = NULL;
+   sys_to_first_edge = NULL;
+
    safelanes_initStacks();
-   safelanes_initOptimizer();
-   for (int iters_done=0; safelanes_buildOneTurn(iters_done) > 0; iters_done++)
-      ;
-   safelanes_destroyOptimizer();
+   ndirty = safelanes_initDirty( force_full, old_lane_faction, old_sys_to_first_edge );
+   nsys = array_size(sys_dirty);
+   if (ndirty > 0) {
+      safelanes_initOptimizer();
+      for (int iters_done=0; safelanes_buildOneTurn(iters_done) > 0; iters_done++)
+         ;
+      safelanes_destroyOptimizer();
+   }
+   else
+      safelanes_destroyTmp();
+
+   /* Bring back the lanes of systems we didn't re-optimize. */
+   for (int s=0; s<nsys; s++) {
+      int n;
+      if (sys_dirty[s])
+         continue;
+      n = sys_to_first_edge[1+s] - sys_to_first_edge[s];
+      assert( "Unchanged systems have unchanged edges" && n == old_sys_to_first_edge[1+s] - old_sys_to_first_edge[s] );
+      memcpy( &lane_faction[sys_to_first_edge[s]], &old_lane_faction[old_sys_to_first_edge[s]], n*sizeof(int) );
+   }
+   array_free( old_lane_faction );
+   array_free( old_sys_to_first_edge );
+
+   digest = diff_universeDigest();
+   if (digest != NULL)
+      safelanes_cacheSave( digest );
+
    /* Stacks remain available for queries. */
    time = SDL_GetTicks() - time;
-   if (conf.devmode)
-      DEBUG( n_("Charted safe lanes for %d object in %.3f s.", "Charted safe lanes for %d objects in %.3f s.", array_size(vertex_stack)), array_size(vertex_stack), time/1000. );
-
-   safelanes_calculated_once = 1;
+   if (ndirty == nsys)
+      safelanes_full_time = time;
+   if (conf.devmode) {
+      if (ndirty == nsys)
+         DEBUG( n_("Charted safe lanes for %d object in %.3f s.", "Charted safe lanes for %d objects in %.3f s.", array_size(vertex_stack)), array_size(vertex_stack), time/1000. );
+      else
+         DEBUG( n_("Re-charted safe lanes for %d of %d system in %.3f s (last full charting took %.3f s).",
+                  "Re-charted safe lanes for %d of %d systems in %.3f s (last full charting took %.3f s).", nsys),
+               ndirty, nsys, time/1000., safelanes_full_time/1000. );
+   }
+   return ndirty;
 }
 
 /**
@@ -280,6 +401,7 @@ int safelanes_calculated (void)
  */
 static void safelanes_initOptimizer (void)
 {
+   tmp_activated = array_create( int );
    safelanes_initStiff();
    safelanes_initQtQ();
    safelanes_initFTilde();
@@ -296,6 +418,9 @@ static void safelanes_destroyOptimizer (void)
       cholmod_free_dense( &PPl[i], &C );
    array_free( PPl );
    PPl = NULL;
+   cholmod_free_factor( &stiff_f, &C );
+   array_free( tmp_activated );
+   tmp_activated = NULL;
    cholmod_free_dense( &utilde, &C ); /* CAUTION: if we instead save it, ensure it's updated after the final activateByGradient. */
    cholmod_free_dense( &ftilde, &C );
    cholmod_free_sparse( &QtQ, &C );
@@ -307,16 +432,12 @@ static void safelanes_destroyOptimizer (void)
  */
 static int safelanes_buildOneTurn( int iters_done )
 {
-   cholmod_sparse *stiff_s;
-   cholmod_factor *stiff_f;
    cholmod_dense *_QtQutilde, *Lambda_tilde, *Y_workspace, *E_workspace;
    int turns_next_time;
    double zero[] = {0, 0}, neg_1[] = {-1, 0};
 
    Y_workspace = E_workspace = Lambda_tilde = NULL;
-   stiff_s = cholmod_triplet_to_sparse( stiff, 0, &C );
-   stiff_f = cholmod_analyze( stiff_s, &C );
-   cholmod_factorize( stiff_s, stiff_f, &C );
+   safelanes_updateFactor();
    cholmod_solve2( CHOLMOD_A, stiff_f, ftilde, NULL, &utilde, NULL, &Y_workspace, &E_workspace, &C );
    _QtQutilde = cholmod_zeros( utilde->nrow, utilde->ncol, CHOLMOD_REAL, &C );
    cholmod_sdmult( QtQ, 0, neg_1, zero, utilde, _QtQutilde, &C );
@@ -324,14 +445,202 @@ static int safelanes_buildOneTurn( int iters_done )
    cholmod_free_dense( &_QtQutilde, &C );
    cholmod_free_dense( &Y_workspace, &C );
    cholmod_free_dense( &E_workspace, &C );
-   cholmod_free_factor( &stiff_f, &C );
-   cholmod_free_sparse( &stiff_s, &C );
    turns_next_time = safelanes_activateByGradient( Lambda_tilde, iters_done );
    cholmod_free_dense( &Lambda_tilde, &C );
 
    return turns_next_time;
 }
 
+/**
+ * @brief Brings the stiffness matrix factorization up to date.
+ *
+ * Activating edge (i,j) adds ALPHA*c0*(e_i-e_j)(e_i-e_j)' to the stiffness matrix, so rather than factorizing from
+ * scratch every turn, we apply a rank update with one column per edge activated since the last call.
+ */
+static void safelanes_updateFactor (void)
+{
+   cholmod_sparse *stiff_s;
+   int n = array_size(tmp_activated);
+
+   if (stiff_f != NULL) {
+      cholmod_sparse *Cs, *Cp;
+      int ok;
+
+      if (n == 0)
+         return;
+
+      Cs = cholmod_allocate_sparse( stiff->nrow, n, 2*n, SORTED, PACKED, STORAGE_MODE_UNSYMMETRIC, CHOLMOD_REAL, &C );
+      ((int*)Cs->p)[0] = 0;
+      for (int k=0; k<n; k++) {
+         int ei = tmp_activated[k];
+         double c = sqrt( ALPHA * safelanes_initialConductivity(ei) );
+         ((int*)Cs->p)[k+1] = 2*(k+1);
+         ((int*)Cs->i)[2*k+0] = edge_stack[ei][0];
+         ((int*)Cs->i)[2*k+1] = edge_stack[ei][1];
+         ((double*)Cs->x)[2*k+0] = +c;
+         ((double*)Cs->x)[2*k+1] = -c;
+      }
+      /* CHOLMOD wants the update in the factor's (fill-reducing) row order. */
+      Cp = cholmod_submatrix( Cs, stiff_f->Perm, stiff_f->n, NULL, -1, 1, SORTED, &C );
+      ok = cholmod_updown( 1, Cp, stiff_f, &C );
+      cholmod_free_sparse( &Cp, &C );
+      cholmod_free_sparse( &Cs, &C );
+      array_resize( &tmp_activated, 0 );
+      if (ok)
+         return;
+
+      WARN( _("Safe-lane factorization update failed; refactorizing.") );
+      cholmod_free_factor( &stiff_f, &C );
+   }
+
+   stiff_s = cholmod_triplet_to_sparse( stiff, 0, &C );
+   stiff_f = cholmod_analyze( stiff_s, &C );
+   cholmod_factorize( stiff_s, stiff_f, &C );
+   cholmod_free_sparse( &stiff_s, &C );
+   array_resize( &tmp_activated, 0 );
+}
+
+/**
+ * @brief Gets the path of the persisted solution for a universe digest.
+ */
+static void safelanes_cachePath( char *path, size_t len, const char *digest )
+{
+   snprintf( path, len, "%suniverse/%s.lanes", nfile_cachePath(), digest );
+}
+
+/**
+ * @brief Replaces the stacks with a persisted solution, if there's a valid one.
+ *
+ * Only what queries and the next incremental update need gets restored; the optimizer's inputs get rebuilt anyway.
+ *
+ *    @param digest Universe digest (\see diff_universeDigest).
+ *    @return 0 on success.
+ */
+static int safelanes_cacheLoad( const char *digest )
+{
+   char path[PATH_MAX];
+   CacheHeader hdr;
+   size_t len, expect;
+   char *buf;
+   const char *ptr;
+   const Vertex *v;
+   const int *s2v, *s2e;
+   const Edge *e;
+   int nsys = array_size( system_getAll() );
+
+   safelanes_cachePath( path, sizeof(path), digest );
+   if (!nfile_fileExists( path ))
+      return -1;
+   buf = nfile_readFile( &len, path );
+   if (buf == NULL)
+      return -1;
+   if (len < sizeof(CacheHeader))
+      goto invalid;
+   memcpy( &hdr, buf, sizeof(CacheHeader) );
+   if ((hdr.magic != CACHE_MAGIC) || (hdr.version != CACHE_VERSION) || (hdr.nsys != nsys) || (hdr.nvertex < 0) || (hdr.nedge < 0))
+      goto invalid;
+   expect = sizeof(CacheHeader) + hdr.nvertex*sizeof(Vertex) + 2*(nsys+1)*sizeof(int) + hdr.nedge*(sizeof(Edge)+sizeof(int))
+      + nsys*(sizeof(Digest)+sizeof(int)) + sizeof(Digest);
+   if (len != expect)
+      goto invalid;
+
+   /* Make sure the indices are sane before trusting them. */
+   v   = (const Vertex*) (buf + sizeof(CacheHeader));
+   s2v = (const int*) (v + hdr.nvertex);
+   e   = (const Edge*) (s2v + nsys + 1);
+   s2e = (const int*) (e + hdr.nedge);
+   if ((s2v[0] != 0) || (s2v[nsys] != hdr.nvertex) || (s2e[0] != 0) || (s2e[nsys] != hdr.nedge))
+      goto invalid;
+   for (int i=0; i<nsys; i++)
+      if ((s2v[i] > s2v[i+1]) || (s2e[i] > s2e[i+1]))
+         goto invalid;
+   for (int i=0; i<hdr.nvertex; i++) {
+      const StarSystem *sys;
+      if ((v[i].system < 0) || (v[i].system >= nsys) || (v[i].index < 0))
+         goto invalid;
+      sys = system_getIndex( v[i].system );
+      if (((v[i].type == VERTEX_PLANET) && (v[i].index >= array_size(sys->planets)))
+            || ((v[i].type == VERTEX_JUMP) && (v[i].index >= array_size(sys->jumps)))
+            || ((v[i].type != VERTEX_PLANET) && (v[i].type != VERTEX_JUMP)))
+         goto invalid;
+   }
+   for (int i=0; i<hdr.nedge; i++)
+      if ((e[i][0] < 0) || (e[i][0] >= hdr.nvertex) || (e[i][1] < 0) || (e[i][1] >= hdr.nvertex))
+         goto invalid;
+
+   safelanes_destroyStacks();
+   array_free( sys_digest );
+   array_free( sys_component );
+   ptr = buf + sizeof(CacheHeader);
+#define CACHE_READ( arr, type, n ) \
+   do { \
+      arr = array_create_size( type, MAX( 1, n ) ); \
+      array_resize( &arr, n ); \
+      memcpy( arr, ptr, (n)*sizeof(type) ); \
+      ptr += (n)*sizeof(type); \
+   } while (0)
+   CACHE_READ( vertex_stack, Vertex, hdr.nvertex );
+   CACHE_READ( sys_to_first_vertex, int, nsys+1 );
+   CACHE_READ( edge_stack, Edge, hdr.nedge );
+   CACHE_READ( sys_to_first_edge, int, nsys+1 );
+   CACHE_READ( lane_faction, int, hdr.nedge );
+   CACHE_READ( sys_digest, Digest, nsys );
+   CACHE_READ( sys_component, int, nsys );
+#undef CACHE_READ
+   memcpy( faction_digest, ptr, sizeof(Digest) );
+   free( buf );
+   return 0;
+
+invalid:
+   WARN( _("Ignoring invalid safe-lane cache '%s'."), path );
+   free( buf );
+   return -1;
+}
+
+/**
+ * @brief Persists the current solution for a universe digest.
+ *
+ *    @param digest Universe digest (\see diff_universeDigest).
+ */
+static void safelanes_cacheSave( const char *digest )
+{
+   char path[PATH_MAX];
+   CacheHeader hdr;
+   size_t len;
+   char *buf, *ptr;
+   int nsys = array_size(sys_to_first_vertex) - 1;
+
+   hdr.magic   = CACHE_MAGIC;
+   hdr.version = CACHE_VERSION;
+   hdr.nsys    = nsys;
+   hdr.nvertex = array_size(vertex_stack);
+   hdr.nedge   = array_size(edge_stack);
+   len = sizeof(CacheHeader) + hdr.nvertex*sizeof(Vertex) + 2*(nsys+1)*sizeof(int) + hdr.nedge*(sizeof(Edge)+sizeof(int))
+      + nsys*(sizeof(Digest)+sizeof(int)) + sizeof(Digest);
+   ptr = buf = malloc( len );
+#define CACHE_WRITE( data, size ) \
+   do { \
+      memcpy( ptr, data, size ); \
+      ptr += size; \
+   } while (0)
+   CACHE_WRITE( &hdr, sizeof(CacheHeader) );
+   CACHE_WRITE( vertex_stack, hdr.nvertex*sizeof(Vertex) );
+   CACHE_WRITE( sys_to_first_vertex, (nsys+1)*sizeof(int) );
+   CACHE_WRITE( edge_stack, hdr.nedge*sizeof(Edge) );
+   CACHE_WRITE( sys_to_first_edge, (nsys+1)*sizeof(int) );
+   CACHE_WRITE( lane_faction, hdr.nedge*sizeof(int) );
+   CACHE_WRITE( sys_digest, nsys*sizeof(Digest) );
+   CACHE_WRITE( sys_component, nsys*sizeof(int) );
+   CACHE_WRITE( faction_digest, sizeof(Digest) );
+#undef CACHE_WRITE
+
+   snprintf( path, sizeof(path), "%suniverse/", nfile_cachePath() );
+   nfile_dirMakeExist( path );
+   safelanes_cachePath( path, sizeof(path), digest );
+   nfile_writeFile( buf, len, path );
+   free( buf );
+}
+
 /**
  * @brief Sets up the local faction/object stacks.
  */
@@ -485,6 +794,140 @@ static void safelanes_initStacks_anchor (void)
    array_free( anchor_systems );
 }
 
+/**
+ * @brief Works out which systems need re-optimizing, by comparing their inputs with the last calculation's.
+ *
+ * A change anywhere in a connected component dirties the whole component, both as it is now and as it was
+ * (so splitting or merging components is caught). Planets and presence budgets of clean systems are dropped
+ * from the problem, which shrinks the dense right-hand sides to the dirty components' planets.
+ *
+ *    @param force_full Whether to mark everything dirty regardless.
+ *    @param old_lane_faction The previous lane_faction stack (NULL if none).
+ *    @param old_sys_to_first_edge The previous sys_to_first_edge stack (NULL if none).
+ *    @return Number of dirty systems.
+ */
+static int safelanes_initDirty( int force_full, const int* old_lane_faction, const int* old_sys_to_first_edge )
+{
+   Digest *digest, fdigest;
+   int *component, *comp_dirty, *old_comp_dirty, *planets, nsys, ndirty;
+
+   nsys = array_size(sys_to_first_vertex) - 1;
+   digest = array_create_size( Digest, nsys );
+   array_resize( &digest, nsys );
+   component = array_create_size( int, nsys );
+   array_resize( &component, nsys );
+   sys_dirty = array_create_size( int, nsys );
+   array_resize( &sys_dirty, nsys );
+
+   /* Label each component by its lowest system index, which doesn't depend on union-find internals. */
+   for (int s=0; s<nsys; s++)
+      component[s] = nsys;
+   for (int s=0; s<nsys; s++) {
+      int r = unionfind_find( &tmp_sys_uf, s );
+      component[r] = MIN( component[r], s );
+   }
+   for (int s=0; s<nsys; s++)
+      component[s] = component[ unionfind_find( &tmp_sys_uf, s ) ];
+   for (int s=0; s<nsys; s++)
+      safelanes_systemDigest( s, digest[s] );
+   safelanes_factionDigest( fdigest );
+
+   force_full = force_full || (old_lane_faction == NULL) || (old_sys_to_first_edge == NULL)
+      || (array_size(sys_digest) != nsys) || memcmp( fdigest, faction_digest, sizeof(Digest) );
+   if (force_full) {
+      for (int s=0; s<nsys; s++)
+         sys_dirty[s] = 1;
+   }
+   else {
+      comp_dirty = calloc( nsys, sizeof(int) );
+      old_comp_dirty = calloc( nsys, sizeof(int) );
+      for (int s=0; s<nsys; s++)
+         if (component[s] != sys_component[s] || memcmp( digest[s], sys_digest[s], sizeof(Digest) )) {
+            comp_dirty[ component[s] ] = 1;
+            old_comp_dirty[ sys_component[s] ] = 1;
+         }
+      for (int s=0; s<nsys; s++)
+         comp_dirty[ component[s] ] |= old_comp_dirty[ sys_component[s] ];
+      for (int s=0; s<nsys; s++)
+         sys_dirty[s] = comp_dirty[ component[s] ];
+      free( comp_dirty );
+      free( old_comp_dirty );
+   }
+
+   array_free( sys_digest );
+   sys_digest = digest;
+   array_free( sys_component );
+   sys_component = component;
+   memcpy( faction_digest, fdigest, sizeof(Digest) );
+
+   /* Take clean systems out of the problem. */
+   ndirty = 0;
+   for (int s=0; s<nsys; s++) {
+      if (sys_dirty[s]) {
+         ndirty++;
+         continue;
+      }
+      for (int fi=0; fi<array_size(faction_stack); fi++)
+         presence_budget[fi][s] = 0.;
+   }
+   planets = array_create_size( int, array_size(tmp_planet_indices) );
+   for (int i=0; i<array_size(tmp_planet_indices); i++)
+      if (sys_dirty[ vertex_stack[tmp_planet_indices[i]].system ])
+         array_push_back( &planets, tmp_planet_indices[i] );
+   array_free( tmp_planet_indices );
+   tmp_planet_indices = planets;
+
+   return ndirty;
+}
+
+/**
+ * @brief Computes the digest of everything the given system's lanes depend on.
+ */
+static void safelanes_systemDigest( int system, Digest digest )
+{
+   md5_state_t md5;
+   md5_init( &md5 );
+   for (int i=sys_to_first_vertex[system]; i<sys_to_first_vertex[1+system]; i++) {
+      const Vertex *v = &vertex_stack[i];
+      const StarSystem *sys = system_getIndex( v->system );
+      int fct = vertex_faction( i );
+      md5_append( &md5, (const md5_byte_t*)&v->type, sizeof(v->type) );
+      md5_append( &md5, (const md5_byte_t*)&v->index, sizeof(v->index) );
+      md5_append( &md5, (const md5_byte_t*)vertex_pos( i ), sizeof(Vector2d) );
+      md5_append( &md5, (const md5_byte_t*)&fct, sizeof(fct) );
+      if (v->type == VERTEX_PLANET) {
+         const AssetPresence *ap = &sys->planets[v->index]->presence;
+         md5_append( &md5, (const md5_byte_t*)&ap->base, sizeof(ap->base) );
+         md5_append( &md5, (const md5_byte_t*)&ap->bonus, sizeof(ap->bonus) );
+      }
+      else {
+         const JumpPoint *jp = &sys->jumps[v->index];
+         int ret = (jp->returnJump != NULL);
+         md5_append( &md5, (const md5_byte_t*)&jp->targetid, sizeof(jp->targetid) );
+         md5_append( &md5, (const md5_byte_t*)&ret, sizeof(ret) );
+      }
+   }
+   for (int fi=0; fi<array_size(faction_stack); fi++)
+      md5_append( &md5, (const md5_byte_t*)&presence_budget[fi][system], sizeof(double) );
+   md5_finish( &md5, digest );
+}
+
+/**
+ * @brief Computes the digest of the lane-building factions' parameters.
+ */
+static void safelanes_factionDigest( Digest digest )
+{
+   md5_state_t md5;
+   md5_init( &md5 );
+   for (int fi=0; fi<array_size(faction_stack); fi++) {
+      const Faction *f = &faction_stack[fi];
+      md5_append( &md5, (const md5_byte_t*)&f->id, sizeof(f->id) );
+      md5_append( &md5, (const md5_byte_t*)&f->lane_length_per_presence, sizeof(f->lane_length_per_presence) );
+      md5_append( &md5, (const md5_byte_t*)&f->lane_base_cost, sizeof(f->lane_base_cost) );
+   }
+   md5_finish( &md5, digest );
+}
+
 /**
  * @brief Tears down the local faction/object stacks.
  */
@@ -511,6 +954,8 @@ static void safelanes_destroyStacks (void)
    lane_faction = NULL;
    array_free( lane_fmask );
    lane_fmask = NULL;
+   array_free( sys_dirty );
+   sys_dirty = NULL;
 }
 
 /**
@@ -585,6 +1030,7 @@ static void safelanes_updateConductivity ( int ei_activated )
    double *sv = stiff->x;
    for (int i=3*ei_activated; i<3*(ei_activated+1); i++)
       sv[i] *= 1+ALPHA;
+   array_push_back( &tmp_activated, ei_activated );
 }
 
 /**
@@ -81,6 +81,38 @@ SHADERS = [
       uniforms = ["projection"],
       subroutines = {},
    ),
+   Shader(
+      name = "pilotmarker",
+      vs_path = "pilotmarker.vert",
+      fs_path = "pilotmarker.frag",
+      attributes = ["vertex", "vertex_color", "vertex_dim"],
+      uniforms = ["projection"],
+      subroutines = {},
+   ),
+   Shader(
+      name = "factiondisk",
+      vs_path = "factiondisk.vert",
+      fs_path = "factiondisk.frag",
+      attributes = ["vertex", "vertex_color", "vertex_radius"],
+      uniforms = ["projection", "zoom", "radius", "alpha"],
+      subroutines = {},
+   ),
+   Shader(
+      name = "jumplane",
+      vs_path = "jumplane.vert",
+      fs_path = "jumplane.frag",
+      attributes = ["vertex", "vertex_color", "vertex_color2", "vertex_lane"],
+      uniforms = ["projection", "zoom", "radius"],
+      subroutines = {},
+   ),
+   Shader(
+      name = "mapsystem",
+      vs_path = "mapsystem.vert",
+      fs_path = "mapsystem.frag",
+      attributes = ["vertex", "vertex_color", "vertex_param"],
+      uniforms = ["projection", "zoom", "radius"],
+      subroutines = {},
+   ),
    Shader(
       name = "texture",
       vs_path = "texture.vert",
@@ -89,6 +121,14 @@ SHADERS = [
       uniforms = ["projection", "color", "tex_mat"],
       subroutines = {},
    ),
+   Shader(
+      name = "texture_batch",
+      vs_path = "texture_batch.vert",
+      fs_path = "texture_batch.frag",
+      attributes = ["vertex", "vertex_color"],
+      uniforms = ["projection"],
+      subroutines = {},
+   ),
    Shader(
       name = "texture_interpolate",
       vs_path = "texture.vert",
@@ -219,14 +259,18 @@ SHADERS = [
       uniforms = ["ClipSpaceFromLocal", "MainTex", "gamma"],
       subroutines = {},
    ),
+   Shader(
+      name = "colortransform",
+      vs_path = "postprocess.vert",
+      fs_path = "colortransform.frag",
+      attributes = ["VertexPosition"],
+      uniforms = ["ClipSpaceFromLocal", "MainTex", "gamma"],
+      subroutines = {},
+   ),
    SimpleShader(
       name = "status",
       fs_path = "status.frag",
    ),
-   SimpleShader(
-      name = "factiondisk",
-      fs_path = "factiondisk.frag",
-   ),
    SimpleShader(
       name = "stealthaura",
       fs_path = "stealthaura.frag",
@@ -239,10 +283,6 @@ SHADERS = [
       name = "jumpmarker",
       fs_path = "jumpmarker.frag",
    ),
-   SimpleShader(
-      name = "pilotmarker",
-      fs_path = "pilotmarker.frag",
-   ),
    SimpleShader(
       name = "playermarker",
       fs_path = "playermarker.frag",
@@ -267,10 +307,6 @@ SHADERS = [
       name = "targetplanet",
       fs_path = "targetplanet.frag",
    ),
-   SimpleShader(
-      name = "jumplane",
-      fs_path = "jumplane.frag",
-   ),
    SimpleShader(
       name = "jumplanegoto",
       fs_path = "jumplanegoto.frag",
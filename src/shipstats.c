@@ -74,6 +74,18 @@ typedef struct ShipStatsLookup_ {
 #define N__ELEM( t ) \
    { .type=t, .name=NULL, .display=NULL, .inverted=0, .offset=0 }
 
+/**
+ * Flat layout used to merge the leading doubles of ShipStats.
+ */
+#define SS_MERGE_FIRST_NONDOUBLE offsetof( ShipStats, misc_instant_jump ) /**< Offset of the first field that is not a double. */
+#define SS_MERGE_NDOUBLE   (SS_MERGE_FIRST_NONDOUBLE / sizeof(double)) /**< Number of leading doubles. */
+static double ss_merge_w[SS_MERGE_NDOUBLE]; /**< Weight of the source in the multiplier. */
+static double ss_merge_u[SS_MERGE_NDOUBLE]; /**< Constant part of the multiplier. */
+static double ss_merge_v[SS_MERGE_NDOUBLE]; /**< Weight of the source when added. */
+static int ss_merge_tail[SS_TYPE_SENTINEL]; /**< Lookup entries not handled by the flat merge. */
+static int ss_merge_ntail = 0; /**< Number of entries in ss_merge_tail. */
+static int ss_merge_init = 0; /**< Whether or not the flat merge tables are built. */
+
 /**
  * The ultimate look up table for ship stats, everything goes through this.
  */
@@ -190,6 +202,7 @@ static int ss_printA( char *buf, int len, int newline, double d, const ShipStats
 static int ss_printI( char *buf, int len, int newline, int i, const ShipStatsLookup *sl );
 static int ss_printB( char *buf, int len, int newline, int b, const ShipStatsLookup *sl );
 static double ss_statsGetInternal( const ShipStats *s, ShipStatsType type );
+static void ss_mergeInit (void);
 static int ss_statsGetLuaInternal( lua_State *L, const ShipStats *s, ShipStatsType type, int internal );
 
 /**
@@ -326,6 +339,57 @@ int ss_statsInit( ShipStats *stats )
    return 0;
 }
 
+/**
+ * @brief Builds the flat tables used by ss_statsMerge().
+ *
+ * All the fields before SS_MERGE_FIRST_NONDOUBLE are doubles, so they are
+ * merged as a flat array with per-field coefficients in a loop that the
+ * compiler can vectorize. The remaining fields go through the lookup table.
+ */
+static void ss_mergeInit (void)
+{
+   int assigned[SS_MERGE_NDOUBLE];
+
+   /* Default to leaving the field untouched. */
+   for (size_t i=0; i<SS_MERGE_NDOUBLE; i++) {
+      ss_merge_w[i] = 0.;
+      ss_merge_u[i] = 1.;
+      ss_merge_v[i] = 0.;
+      assigned[i]   = 0;
+   }
+
+   ss_merge_ntail = 0;
+   for (int i=0; i<SS_TYPE_SENTINEL; i++) {
+      const ShipStatsLookup *sl = &ss_lookup[ i ];
+      size_t j = sl->offset / sizeof(double);
+
+      /* Only want valid names. */
+      if (sl->name == NULL)
+         continue;
+
+      if ((sl->offset < SS_MERGE_FIRST_NONDOUBLE) && !assigned[j]) {
+         switch (sl->data) {
+            case SS_DATA_TYPE_DOUBLE:
+               ss_merge_w[j] = 1.;
+               ss_merge_u[j] = 0.;
+               assigned[j] = 1;
+               continue;
+
+            case SS_DATA_TYPE_DOUBLE_ABSOLUTE:
+            case SS_DATA_TYPE_DOUBLE_ABSOLUTE_PERCENT:
+               ss_merge_v[j] = 1.;
+               assigned[j] = 1;
+               continue;
+
+            default:
+               break;
+         }
+      }
+      ss_merge_tail[ ss_merge_ntail++ ] = i;
+   }
+   ss_merge_init = 1;
+}
+
 /**
  * @brief Merges two different ship stats.
  *
@@ -341,14 +405,19 @@ int ss_statsMerge( ShipStats *dest, const ShipStats *src )
    char *destptr;
    const char *srcptr;
 
+   if (!ss_merge_init)
+      ss_mergeInit();
+
+   /* Doubles are either multiplied or added: d = d*(s*w + u) + s*v */
+   destdbl = (double*) dest;
+   srcdbl = (const double*) src;
+   for (size_t i=0; i<SS_MERGE_NDOUBLE; i++)
+      destdbl[i] = destdbl[i] * (srcdbl[i]*ss_merge_w[i] + ss_merge_u[i]) + srcdbl[i]*ss_merge_v[i];
+
    destptr = (char*) dest;
    srcptr = (const char*) src;
-   for (int i=0; i<SS_TYPE_SENTINEL; i++) {
-      const ShipStatsLookup *sl = &ss_lookup[ i ];
-
-      /* Only want valid names. */
-      if (sl->name == NULL)
-         continue;
+   for (int k=0; k<ss_merge_ntail; k++) {
+      const ShipStatsLookup *sl = &ss_lookup[ ss_merge_tail[k] ];
 
       switch (sl->data) {
          case SS_DATA_TYPE_DOUBLE:
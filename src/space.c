@@ -18,6 +18,7 @@
 #include "space.h"
 
 #include "background.h"
+#include "camera.h"
 #include "conf.h"
 #include "damagetype.h"
 #include "dev_uniedit.h"
@@ -71,6 +72,13 @@
 #define ASTEROID_EXPLODE_INTERVAL 5. /**< Interval of asteroids randomly exploding */
 #define ASTEROID_EXPLODE_CHANCE   0.1 /**< Chance of asteroid exploding each interval */
 
+#define SPACE_BATCH_VERTS     6     /**< Vertices per batched sprite. */
+#define SPACE_BATCH_FLOATS    8     /**< Floats per batched sprite vertex. */
+
+#define ASTEROID_GRID_CELL    256.  /**< Size of a cell of the asteroid grid. */
+#define ASTEROID_GRID_BUCKETS 1024  /**< Buckets of the asteroid grid, must be a power of two. */
+#define ASTEROID_GRID_SLACK   32.   /**< Padding for asteroids that moved since the grid was built. */
+
 /*
  * planet <-> system name stack
  */
@@ -104,15 +112,106 @@ static nlua_env landing_env = LUA_NOREF; /**< Landing lua env. */
 static int space_fchg = 0; /**< Faction change counter, to avoid unnecessary calls. */
 static int space_simulating = 0; /**< Are we simulating space? */
 static int space_simulating_effects = 0; /**< Are we doing special effects? */
+static int space_simulating_fast = 0; /**< Are we fast-forwarding with coarse timesteps? */
 glTexture **asteroid_gfx = NULL;
 static size_t nasterogfx = 0; /**< Nb of asteroid gfx. */
 static Planet *space_landQueuePlanet = NULL;
 
+/**
+ * @brief Coarse spatial hash of the asteroids of the current system.
+ *
+ * Asteroids are stored sorted by bucket so the asteroids of a bucket are
+ *  contiguous, same as the pilot grid used by pilot.getInRange.
+ */
+typedef struct AsteroidGrid_ {
+   Asteroid **asteroids; /**< Array (array.h): Asteroids sorted by bucket. */
+   int start[ASTEROID_GRID_BUCKETS+1]; /**< Offset of each bucket in asteroids. */
+   unsigned int visited[ASTEROID_GRID_BUCKETS]; /**< Query stamp each bucket was last looked at. */
+   unsigned int stamp; /**< Current query stamp. */
+   double radius;    /**< Largest asteroid radius in the grid. */
+   const StarSystem *sys; /**< System the grid was built for. */
+   int valid;        /**< Whether or not the grid has been built. */
+   int queries;      /**< Queries done since the grid was built. */
+   int tested;       /**< Candidates returned since the grid was built. */
+   int last_tested;  /**< Candidates returned during the previous update. */
+   int last_total;   /**< Brute force checks the previous update would have needed. */
+} AsteroidGrid;
+static AsteroidGrid asteroid_grid = { .asteroids = NULL, .valid = 0 }; /**< Grid used for asteroid collisions. */
+#if DEBUGGING
+static int asteroid_gridBrute = 0; /**< Hand every asteroid to the narrowphase, for benchmarking. */
+static int asteroid_benchmarking = 0; /**< Whether the system's fields are set aside for benchmarking. */
+static AsteroidAnchor *asteroid_benchmarkLive = NULL; /**< The system's own fields while benchmarking. */
+#endif /* DEBUGGING */
+
+/**
+ * @brief A queued asteroid or debris sprite.
+ */
+typedef struct SpaceSprite_ {
+   const glTexture *tex; /**< Texture to draw. */
+   const glColour *c; /**< Colour to modulate the texture with. */
+   GLfloat x; /**< X position in screen coordinates. */
+   GLfloat y; /**< Y position in screen coordinates. */
+   GLfloat w; /**< Width in screen coordinates. */
+   GLfloat h; /**< Height in screen coordinates. */
+   int layer; /**< Layer of the sprite, layers are drawn in order. */
+   int id; /**< Queue order, keeps the sort stable. */
+} SpaceSprite;
+static SpaceSprite *space_sprites = NULL; /**< Array (array.h): Queued asteroid and debris sprites. */
+static GLfloat *space_spriteData  = NULL; /**< Array (array.h): Vertices of the queued sprites. */
+static gl_vbo *space_spriteVBO    = NULL; /**< VBO the sprites are streamed through. */
+static GLsizei space_spriteVBOSize = 0; /**< Size of space_spriteVBO in bytes. */
+static int space_spriteLayer      = 0; /**< Layer sprites are being queued to. */
+static int space_renderDraws      = 0; /**< Asteroid and debris draw calls this frame. */
+static int space_renderSprites    = 0; /**< Asteroid and debris sprites drawn this frame. */
+static int space_renderLastDraws  = 0; /**< Asteroid and debris draw calls last frame. */
+static int space_renderLastSprites = 0; /**< Asteroid and debris sprites drawn last frame. */
+
 /*
  * Fleet spawning.
  */
 int space_spawn = 1; /**< Spawn enabled by default. */
 
+/**
+ * @brief A system reached by the spill of an asset presence.
+ */
+typedef struct PresenceReach_ {
+   StarSystem *sys;  /**< System reached. */
+   double factor;    /**< Fraction of the presence it receives. */
+} PresenceReach;
+
+/**
+ * @brief Presence contributed by a single asset presence to a single system.
+ */
+typedef struct PresenceSpill_ {
+   int source;       /**< Contributing source in presence_sources. */
+   int faction;      /**< Faction receiving the presence. */
+   double base;      /**< Base presence contributed (combined with MAX). */
+   double bonus;     /**< Bonus presence contributed (summed). */
+} PresenceSpill;
+
+/**
+ * @brief An asset presence along with the systems its spill reaches.
+ */
+typedef struct PresenceSource_ {
+   int sys;          /**< System the asset is in, -1 if the slot is free. */
+   AssetPresence ap; /**< Presence the spill was computed from. */
+   int *reach;       /**< Array (array.h): Systems contributed to, including its own. */
+} PresenceSource;
+
+/**
+ * @brief Per-system bookkeeping for incrementally maintained presence.
+ */
+typedef struct PresenceNode_ {
+   AssetPresence *assets; /**< Array (array.h): Asset presences when last computed. */
+   int *jumps;            /**< Array (array.h): Target and flags of each jump when last computed. */
+   int *sources;          /**< Array (array.h): Sources located in the system. */
+   PresenceSpill *spill;  /**< Array (array.h): Contributions received by the system. */
+} PresenceNode;
+
+static PresenceNode *presence_nodes = NULL; /**< Array (array.h): Presence bookkeeping of each system. */
+static PresenceSource *presence_sources = NULL; /**< Array (array.h): Tracked asset presences. */
+static int *presence_free = NULL; /**< Array (array.h): Free slots in presence_sources. */
+
 /*
  * Internal Prototypes.
  */
@@ -135,8 +234,21 @@ static void system_parseJumps( const xmlNodePtr parent );
 static void system_parseAsteroids( const xmlNodePtr parent, StarSystem *sys );
 /* misc */
 static int getPresenceIndex( StarSystem *sys, int faction );
+static PresenceReach* system_presenceReach( StarSystem *sys, const AssetPresence *ap );
+static void system_presenceApply( StarSystem *sys, int faction, double base, double bonus );
+static void presence_destroy (void);
+static int presence_updateAssets( int sysid );
+static int presence_updateJumps( int sysid );
+static void presence_addSource( int sysid, const AssetPresence *ap, int slot, char *touched );
+static void presence_rmSource( int slot, char *touched );
+static void presence_rebuildSystem( StarSystem *sys );
 static void system_scheduler( double dt, int init );
+static void space_simulateFast( double dt );
 static void asteroid_explode ( Asteroid *a, AsteroidAnchor *field, int give_reward );
+static int asteroid_gridCell( double x );
+static int asteroid_gridBucket( int ix, int iy );
+static void asteroid_gridBuild (void);
+static void asteroid_gridInvalidate (void);
 /* Markers. */
 static int space_addMarkerSystem( int sysid, MissionMarkerType type );
 static int space_addMarkerPlanet( int pntid, MissionMarkerType type );
@@ -146,7 +258,12 @@ static int space_rmMarkerPlanet( int pntid, MissionMarkerType type );
 static void space_renderJumpPoint( const JumpPoint *jp, int i );
 static void space_renderPlanet( const Planet *p );
 static void space_renderAsteroid( const Asteroid *a );
+static void space_renderAsteroidScan( const Asteroid *a );
 static void space_renderDebris( const Debris *d, double x, double y );
+static void space_spriteAdd( const glTexture *tex, double bx, double by,
+      double scale, const glColour *c );
+static int space_spriteCompare( const void *p1, const void *p2 );
+static void space_spriteFlush (void);
 /*
  * Externed prototypes.
  */
@@ -1489,6 +1606,9 @@ void space_update( const double dt )
          }
       }
    }
+
+   /* Asteroids moved, rebucket them for the weapon collisions. */
+   asteroid_gridBuild();
 }
 
 /**
@@ -1507,6 +1627,32 @@ int space_isSimulationEffects (void)
    return space_simulating_effects;
 }
 
+/**
+ * @brief returns whether or not we're fast-forwarding the simulation.
+ *
+ * In this mode timesteps are coarse and weapons only do broadphase collisions.
+ */
+int space_isSimulationFast (void)
+{
+   return space_simulating_fast;
+}
+
+/**
+ * @brief Does a fast-forward simulation step when entering a system.
+ *
+ * Unlike update_routine() only the things that shape the state of the system
+ *  are updated: spawning, weapons and pilots. Effects and the camera are left
+ *  for the full fidelity part of the simulation.
+ *
+ *    @param dt Timestep to use.
+ */
+static void space_simulateFast( double dt )
+{
+   space_update( dt );
+   weapons_update( dt );
+   pilots_update( dt );
+}
+
 /**
  * @brief Initializes the system.
  *
@@ -1517,6 +1663,7 @@ void space_init( const char* sysname, int do_simulate )
 {
    char *nt;
    int n, s;
+   Uint32 t;
    const double fps_min_simulation = fps_min * 2.;
    StarSystem *oldsys = cur_system;
 
@@ -1567,7 +1714,7 @@ void space_init( const char* sysname, int do_simulate )
    if ((oldsys != NULL && oldsys->stats != NULL) || cur_system->stats != NULL) {
       Pilot *const* pilot_stack = pilot_getAll();
       for (int i=0; i<array_size(pilot_stack); i++)
-         pilot_calcStats( pilot_stack[i] );
+         pilot_calcStatsLayers( pilot_stack[i], PILOT_STATS_SYSTEM );
    }
 
    /* Set up planets. */
@@ -1579,6 +1726,7 @@ void space_init( const char* sysname, int do_simulate )
    }
 
    /* Set up asteroids. */
+   asteroid_gridInvalidate();
    for (int i=0; i<array_size(cur_system->asteroids); i++) {
       AsteroidAnchor *ast = &cur_system->asteroids[i];
       ast->id = i;
@@ -1636,15 +1784,22 @@ void space_init( const char* sysname, int do_simulate )
       s = sound_disabled;
       sound_disabled = 1;
       ntime_allowUpdate( 0 );
-      n = SYSTEM_SIMULATE_TIME_PRE / fps_min_simulation;
+      t = SDL_GetTicks();
+      /* Nothing is seen until effects are enabled, so we can fast-forward. */
+      space_simulating_fast = 1;
+      n = SYSTEM_SIMULATE_TIME_PRE / (fps_min_simulation * SYSTEM_SIMULATE_FAST_STEP);
       for (int i=0; i<n; i++)
-         update_routine( fps_min_simulation, 1 );
+         space_simulateFast( fps_min_simulation * SYSTEM_SIMULATE_FAST_STEP );
+      space_simulating_fast = 0;
       space_simulating_effects = 1;
       n = SYSTEM_SIMULATE_TIME_POST / fps_min_simulation;
       for (int i=0; i<n; i++)
          update_routine( fps_min_simulation, 1 );
       ntime_allowUpdate( 1 );
       sound_disabled = s;
+      if (conf.devmode)
+         DEBUG(_("Simulated %s with %d pilots in %u ms"), cur_system->name,
+               array_size(pilot_getAll()), SDL_GetTicks()-t );
    }
    player_messageToggle( 1 );
    if (player.p != NULL)
@@ -3286,13 +3441,8 @@ int space_load (void)
    /* Done loading. */
    systems_loading = 0;
 
-   /* Apply all the presences. */
-   for (int i=0; i<array_size(systems_stack); i++)
-      system_addAllPlanetsPresence(&systems_stack[i]);
-
-   /* Determine dominant faction. */
-   for (int i=0; i<array_size(systems_stack); i++)
-      system_setFaction( &systems_stack[i] );
+   /* Apply all the presences and determine the dominant factions. */
+   space_reconstructPresences();
 
    /* Reconstruction. */
    systems_reconstructJumps();
@@ -3531,11 +3681,13 @@ void space_renderOverlay( const double dt )
          AsteroidAnchor *ast = &cur_system->asteroids[i];
          x = psolid->pos.x - SCREEN_W/2;
          y = psolid->pos.y - SCREEN_H/2;
+         space_spriteLayer = i;
          for (int j=0; j < ast->ndebris; j++) {
            if (ast->debris[j].height > 1.)
               space_renderDebris( &ast->debris[j], x, y );
          }
       }
+      space_spriteFlush();
    }
 
    /* Render overlay if necessary. */
@@ -3571,21 +3723,36 @@ void planets_render (void)
    if (pplayer != NULL)
       psolid  = pplayer->solid;
 
-   /* Render the asteroids & debris. */
+   /* Render the asteroids & debris, batched by texture. Each field's
+    * asteroids and then its debris are a layer, so they overlap like before. */
+   space_renderLastDraws   = space_renderDraws;
+   space_renderLastSprites = space_renderSprites;
+   space_renderDraws       = 0;
+   space_renderSprites     = 0;
    for (int i=0; i < array_size(cur_system->asteroids); i++) {
       AsteroidAnchor *ast = &cur_system->asteroids[i];
+      space_spriteLayer = 2*i;
       for (int j=0; j < ast->nb; j++)
         space_renderAsteroid( &ast->asteroids[j] );
 
       if (pplayer != NULL) {
          double x = psolid->pos.x - SCREEN_W/2;
          double y = psolid->pos.y - SCREEN_H/2;
+         space_spriteLayer = 2*i+1;
          for (int j=0; j < ast->ndebris; j++) {
            if (ast->debris[j].height < 1.)
               space_renderDebris( &ast->debris[j], x, y );
          }
       }
    }
+   space_spriteFlush();
+
+   /* Scanned commodities go on top of all the asteroids. */
+   for (int i=0; i < array_size(cur_system->asteroids); i++) {
+      AsteroidAnchor *ast = &cur_system->asteroids[i];
+      for (int j=0; j < ast->nb; j++)
+        space_renderAsteroidScan( &ast->asteroids[j] );
+   }
 
    /* Render gatherable stuff. */
    gatherable_render();
@@ -3628,13 +3795,12 @@ static void space_renderPlanet( const Planet *p )
 }
 
 /**
- * @brief Renders an asteroid.
+ * @brief Queues an asteroid.
  */
 static void space_renderAsteroid( const Asteroid *a )
 {
-   double scale, nx, ny;
+   double scale;
    AsteroidType *at;
-   char c[20];
 
    /* Skip invisible asteroids */
    if (a->appearing == ASTEROID_INVISIBLE)
@@ -3649,12 +3815,22 @@ static void space_renderAsteroid( const Asteroid *a )
       scale = 1.;
 
    at = &asteroid_types[a->type];
+   space_spriteAdd( at->gfxs[a->gfxID], a->pos.x, a->pos.y, scale, NULL );
+}
+
+/**
+ * @brief Renders the commodities of a scanned asteroid.
+ */
+static void space_renderAsteroidScan( const Asteroid *a )
+{
+   double nx, ny;
+   AsteroidType *at;
+   char c[20];
 
-   gl_renderSpriteInterpolateScale( at->gfxs[a->gfxID], at->gfxs[a->gfxID], 1,
-                                  a->pos.x, a->pos.y, scale, scale, 0, 0, NULL );
+   if ((a->appearing == ASTEROID_INVISIBLE) || !a->scanned)
+      return;
 
-   /* Add the commodities if scanned. */
-   if (!a->scanned) return;
+   at = &asteroid_types[a->type];
    gl_gameToScreenCoords( &nx, &ny, a->pos.x, a->pos.y );
    for (int i=0; i<array_size(at->material); i++) {
       Commodity *com = at->material[i];
@@ -3665,23 +3841,170 @@ static void space_renderAsteroid( const Asteroid *a )
 }
 
 /**
- * @brief Renders a debris.
+ * @brief Queues a debris.
  */
 static void space_renderDebris( const Debris *d, double x, double y )
 {
-   double scale;
-   Vector2d *testVect;
+   Vector2d testVect;
+
+   testVect.x = d->pos.x + x;
+   testVect.y = d->pos.y + y;
 
-   scale = 0.5;
+   if (space_isInField( &testVect ) == 0)
+      space_spriteAdd( asteroid_gfx[d->gfxID], testVect.x, testVect.y, 0.5, &cInert );
+}
+
+/**
+ * @brief Queues the first sprite of a texture to be drawn by space_spriteFlush.
+ *
+ *    @param tex Texture to draw.
+ *    @param bx X position of the centre in game coordinates.
+ *    @param by Y position of the centre in game coordinates.
+ *    @param scale Scale factor of the sprite.
+ *    @param c Colour to modulate with, NULL is white.
+ */
+static void space_spriteAdd( const glTexture *tex, double bx, double by,
+      double scale, const glColour *c )
+{
+   double x, y, w, h, z;
+   SpaceSprite *spr;
+
+   /* Same placement and culling as gl_renderSpriteInterpolateScale. */
+   gl_gameToScreenCoords( &x, &y, bx - scale * tex->sw/2., by - scale * tex->sh/2. );
+   z = cam_getZoom();
+   w = tex->sw*z*scale;
+   h = tex->sh*z*scale;
+   if ((x < -w) || (x > SCREEN_W+w) ||
+         (y < -h) || (y > SCREEN_H+h))
+      return;
 
-   testVect = malloc(sizeof(Vector2d));
-   testVect->x = d->pos.x + x;
-   testVect->y = d->pos.y + y;
+   if (space_sprites == NULL)
+      space_sprites = array_create( SpaceSprite );
+   spr      = &array_grow( &space_sprites );
+   spr->tex = tex;
+   spr->c   = (c==NULL) ? &cWhite : c;
+   spr->x   = x;
+   spr->y   = y;
+   spr->w   = w;
+   spr->h   = h;
+   spr->layer = space_spriteLayer;
+   spr->id  = array_size(space_sprites)-1;
+}
 
-   if (space_isInField( testVect ) == 0)
-      gl_renderSpriteInterpolateScale( asteroid_gfx[d->gfxID], asteroid_gfx[d->gfxID], 1,
-                                     testVect->x, testVect->y, scale, scale, 0, 0, &cInert );
-   free(testVect);
+/**
+ * @brief Sorts sprites by texture within their layer, keeping the queue order otherwise.
+ */
+static int space_spriteCompare( const void *p1, const void *p2 )
+{
+   const SpaceSprite *s1 = p1;
+   const SpaceSprite *s2 = p2;
+   if (s1->layer != s2->layer)
+      return s1->layer - s2->layer;
+   if (s1->tex != s2->tex)
+      return (s1->tex < s2->tex) ? -1 : 1;
+   return s1->id - s2->id;
+}
+
+/**
+ * @brief Draws the queued sprites with one draw call per texture and layer.
+ *
+ * The sprites are expanded into triangles on the CPU instead of using
+ *  instanced attributes, so it works on the OpenGL 3.1 fallback too.
+ */
+static void space_spriteFlush (void)
+{
+   /* Corners of gl_squareVBO, split into two triangles. */
+   const GLfloat corners[SPACE_BATCH_VERTS][2] = {
+      { 0., 0. }, { 1., 0. }, { 0., 1. },
+      { 1., 0. }, { 1., 1. }, { 0., 1. } };
+   GLsizei size, stride;
+   int n, start;
+
+   n = array_size( space_sprites );
+   if (n <= 0)
+      return;
+
+   qsort( space_sprites, n, sizeof(SpaceSprite), space_spriteCompare );
+
+   /* Expand the sprites into vertices. */
+   if (space_spriteData == NULL)
+      space_spriteData = array_create( GLfloat );
+   array_resize( &space_spriteData, n*SPACE_BATCH_VERTS*SPACE_BATCH_FLOATS );
+   for (int i=0; i<n; i++) {
+      const SpaceSprite *spr = &space_sprites[i];
+      const glTexture *tex = spr->tex;
+      double tx, ty;
+
+      /* Texture coordinates of the first sprite. */
+      tx = 0.;
+      ty = tex->sh*(tex->sy-1.)/tex->h;
+      for (int j=0; j<SPACE_BATCH_VERTS; j++) {
+         GLfloat *d = &space_spriteData[ (i*SPACE_BATCH_VERTS + j) * SPACE_BATCH_FLOATS ];
+         double v;
+         d[0] = spr->x + corners[j][0] * spr->w;
+         d[1] = spr->y + corners[j][1] * spr->h;
+         d[2] = tx + corners[j][0] * tex->srw;
+         v    = ty + corners[j][1] * tex->srh;
+         d[3] = (tex->flags & OPENGL_TEX_VFLIP) ? 1.-v : v;
+         d[4] = spr->c->r;
+         d[5] = spr->c->g;
+         d[6] = spr->c->b;
+         d[7] = spr->c->a;
+      }
+   }
+
+   /* Upload, growing the VBO if needed. */
+   size = sizeof(GLfloat) * array_size(space_spriteData);
+   if (size > space_spriteVBOSize) {
+      space_spriteVBOSize = sizeof(GLfloat) * array_reserved( space_spriteData );
+      if (space_spriteVBO == NULL)
+         space_spriteVBO = gl_vboCreateStream( space_spriteVBOSize, NULL );
+      else
+         gl_vboData( space_spriteVBO, space_spriteVBOSize, NULL );
+   }
+   gl_vboSubData( space_spriteVBO, 0, size, space_spriteData );
+
+   stride = sizeof(GLfloat) * SPACE_BATCH_FLOATS;
+   glUseProgram( shaders.texture_batch.program );
+   glEnableVertexAttribArray( shaders.texture_batch.vertex );
+   glEnableVertexAttribArray( shaders.texture_batch.vertex_color );
+   gl_vboActivateAttribOffset( space_spriteVBO, shaders.texture_batch.vertex,
+         0, 4, GL_FLOAT, stride );
+   gl_vboActivateAttribOffset( space_spriteVBO, shaders.texture_batch.vertex_color,
+         sizeof(GLfloat) * 4, 4, GL_FLOAT, stride );
+   gl_Matrix4_Uniform( shaders.texture_batch.projection, gl_view_matrix );
+
+   /* One draw per run of sprites sharing a texture and layer. */
+   start = 0;
+   for (int i=1; i<=n; i++) {
+      if ((i < n) && (space_sprites[i].tex == space_sprites[start].tex) &&
+            (space_sprites[i].layer == space_sprites[start].layer))
+         continue;
+      glBindTexture( GL_TEXTURE_2D, space_sprites[start].tex->texture );
+      glDrawArrays( GL_TRIANGLES, start*SPACE_BATCH_VERTS, (i-start)*SPACE_BATCH_VERTS );
+      space_renderDraws++;
+      start = i;
+   }
+   space_renderSprites += n;
+
+   glDisableVertexAttribArray( shaders.texture_batch.vertex );
+   glDisableVertexAttribArray( shaders.texture_batch.vertex_color );
+   glUseProgram( 0 );
+   gl_checkErr();
+
+   array_resize( &space_sprites, 0 );
+}
+
+/**
+ * @brief Gets how many draw calls the asteroids and debris took last frame.
+ *
+ *    @param[out] draws Number of draw calls.
+ *    @param[out] sprites Number of sprites they drew.
+ */
+void space_renderStats( int *draws, int *sprites )
+{
+   *draws   = space_renderLastDraws;
+   *sprites = space_renderLastSprites;
 }
 
 /**
@@ -3783,6 +4106,23 @@ void space_exit (void)
    array_free(systems_stack);
    systems_stack = NULL;
 
+   /* Free the sprite batch. */
+   array_free( space_sprites );
+   space_sprites = NULL;
+   array_free( space_spriteData );
+   space_spriteData = NULL;
+   gl_vboDestroy( space_spriteVBO );
+   space_spriteVBO = NULL;
+   space_spriteVBOSize = 0;
+
+   /* Free the asteroid grid. */
+   array_free(asteroid_grid.asteroids);
+   asteroid_grid.asteroids = NULL;
+   asteroid_gridInvalidate();
+
+   /* Free the presence bookkeeping. */
+   presence_destroy();
+
    /* Free the asteroid types. */
    for (int i=0; i < array_size(asteroid_types); i++) {
       AsteroidType *at = &asteroid_types[i];
@@ -3848,6 +4188,7 @@ void space_clearComputerMarkers (void)
 {
    for (int i=0; i<array_size(systems_stack); i++)
       sys_rmFlag(&systems_stack[i],SYSTEM_CMARKED);
+   map_geomDirty();
 }
 
 static int space_addMarkerSystem( int sysid, MissionMarkerType type )
@@ -4160,56 +4501,59 @@ static int getPresenceIndex( StarSystem *sys, int faction )
 }
 
 /**
- * @brief Adds (or removes) some presence to a system.
+ * @brief Adds some presence of a faction to a system.
  *
- *    @param sys Pointer to the system to add to or remove from.
- *    @param ap Asset presence to add.
+ *    @param sys Pointer to the system to add to.
+ *    @param faction Faction to add presence of.
+ *    @param base Base presence, combined with the existing one with MAX.
+ *    @param bonus Bonus presence, added to the existing one.
  */
-void system_presenceAddAsset( StarSystem *sys, const AssetPresence *ap )
+static void system_presenceApply( StarSystem *sys, int faction, double base, double bonus )
+{
+   int i = getPresenceIndex(sys, faction);
+   sys->presence[i].base   = MAX( sys->presence[i].base, base );
+   sys->presence[i].bonus += bonus;
+   sys->presence[i].value  = sys->presence[i].base + sys->presence[i].bonus;
+}
+
+/**
+ * @brief Gets the systems an asset presence spills into.
+ *
+ *    @param sys Pointer to the system the asset is in.
+ *    @param ap Asset presence to spill.
+ *    @return Array (array.h) of reached systems starting with sys, or NULL if the asset adds no presence.
+ */
+static PresenceReach* system_presenceReach( StarSystem *sys, const AssetPresence *ap )
 {
-   int i, x, curSpill;
+   int i, curSpill;
    Queue q, qn;
    StarSystem *cur;
-   double spillfactor;
+   PresenceReach *reach;
    int faction = ap->faction;
-   double base = ap->base;
-   double bonus = ap->bonus;
    double range = ap->range;
    int usehidden = faction_usesHiddenJumps( faction );
-   const FactionGenerator *fgens;
 
    /* Check for NULL and display a warning. */
    if (sys == NULL) {
       WARN("sys == NULL");
-      return;
+      return NULL;
    }
 
    /* Check that we have a valid faction. */
    if (faction_isFaction(faction) == 0)
-      return;
+      return NULL;
 
    /* Check that we're actually adding any. */
-   if ((base == 0.) && (bonus == 0.))
-      return;
+   if ((ap->base == 0.) && (ap->bonus == 0.))
+      return NULL;
 
-   /* Get secondary if applicable. */
-   fgens = faction_generators( faction );
-
-   /* Add the presence to the current system. */
-   i = getPresenceIndex(sys, faction);
-   sys->presence[i].base   = MAX( sys->presence[i].base, base );
-   sys->presence[i].bonus += bonus;
-   sys->presence[i].value  = sys->presence[i].base + sys->presence[i].bonus;
-   for (i=0; i<array_size(fgens); i++) {
-      x = getPresenceIndex(sys, fgens[i].id);
-      sys->presence[x].base   = MAX( sys->presence[x].base, MAX(0., base*fgens[i].weight) );
-      sys->presence[x].bonus += MAX(0., bonus*fgens[i].weight);
-      sys->presence[x].value  = sys->presence[x].base + sys->presence[x].bonus;
-   }
+   /* The current system gets the full presence. */
+   reach = array_create( PresenceReach );
+   array_push_back( &reach, ((PresenceReach){ .sys = sys, .factor = 1. }) );
 
    /* If there's no range, we're done here. */
    if (range < 1)
-      return;
+      return reach;
 
    /* Add the spill. */
    sys->spilled   = 1;
@@ -4232,7 +4576,6 @@ void system_presenceAddAsset( StarSystem *sys, const AssetPresence *ap )
       q_destroy(q);
       q_destroy(qn);
       goto sys_cleanup;
-      return;
    }
 
    while (curSpill < range) {
@@ -4252,18 +4595,7 @@ void system_presenceAddAsset( StarSystem *sys, const AssetPresence *ap )
       }
 
       /* Spill some presence. */
-      x = getPresenceIndex(cur, faction);
-      spillfactor = 1. / (2. + (double)curSpill);
-      cur->presence[x].base   = MAX( cur->presence[x].base, base * spillfactor );
-      cur->presence[x].bonus += bonus * spillfactor;
-      cur->presence[x].value  = cur->presence[x].base + cur->presence[x].bonus;
-
-      for (i=0; i<array_size(fgens); i++) {
-         x = getPresenceIndex(cur, fgens[i].id);
-         cur->presence[x].base   = MAX( cur->presence[x].base, MAX(0., base*spillfactor*fgens[i].weight) );
-         cur->presence[x].bonus += MAX(0., bonus*spillfactor*fgens[i].weight );
-         cur->presence[x].value  = cur->presence[x].base + cur->presence[x].bonus;
-      }
+      array_push_back( &reach, ((PresenceReach){ .sys = cur, .factor = 1. / (2. + (double)curSpill) }) );
 
       /* Check to see if we've finished this range and grab the next queue. */
       if (q_isEmpty(q)) {
@@ -4282,7 +4614,36 @@ sys_cleanup:
    /* Clean up our mess. */
    for (i=0; i < array_size(systems_stack); i++)
       systems_stack[i].spilled = 0;
-   return;
+   return reach;
+}
+
+/**
+ * @brief Adds (or removes) some presence to a system.
+ *
+ *    @param sys Pointer to the system to add to or remove from.
+ *    @param ap Asset presence to add.
+ */
+void system_presenceAddAsset( StarSystem *sys, const AssetPresence *ap )
+{
+   PresenceReach *reach;
+   const FactionGenerator *fgens;
+
+   reach = system_presenceReach( sys, ap );
+   if (reach == NULL)
+      return;
+
+   /* Get secondary if applicable. */
+   fgens = faction_generators( ap->faction );
+
+   for (int i=0; i<array_size(reach); i++) {
+      double f = reach[i].factor;
+      system_presenceApply( reach[i].sys, ap->faction, ap->base*f, ap->bonus*f );
+      for (int j=0; j<array_size(fgens); j++)
+         system_presenceApply( reach[i].sys, fgens[j].id,
+               MAX(0., ap->base*f*fgens[j].weight), MAX(0., ap->bonus*f*fgens[j].weight) );
+   }
+
+   array_free( reach );
 }
 
 /**
@@ -4372,33 +4733,366 @@ void system_addAllPlanetsPresence( StarSystem *sys )
 }
 
 /**
- * @brief Reset the presence of all systems.
+ * @brief Frees the incremental presence bookkeeping.
+ */
+static void presence_destroy (void)
+{
+   for (int i=0; i<array_size(presence_nodes); i++) {
+      array_free( presence_nodes[i].assets );
+      array_free( presence_nodes[i].jumps );
+      array_free( presence_nodes[i].sources );
+      array_free( presence_nodes[i].spill );
+   }
+   array_free( presence_nodes );
+   presence_nodes = NULL;
+   for (int i=0; i<array_size(presence_sources); i++)
+      array_free( presence_sources[i].reach );
+   array_free( presence_sources );
+   presence_sources = NULL;
+   array_free( presence_free );
+   presence_free = NULL;
+}
+
+/**
+ * @brief Updates the recorded asset presences of a system.
+ *
+ *    @param sysid System to update.
+ *    @return 1 if they changed since last time, 0 otherwise.
+ */
+static int presence_updateAssets( int sysid )
+{
+   StarSystem *sys = &systems_stack[sysid];
+   PresenceNode *node = &presence_nodes[sysid];
+   AssetPresence *cur = array_create( AssetPresence );
+   int changed;
+
+   for (int i=0; i<array_size(sys->planets); i++)
+      array_push_back( &cur, sys->planets[i]->presence );
+   for (int i=0; i<array_size(sys->assets_virtual); i++)
+      for (int j=0; j<array_size(sys->assets_virtual[i]->presences); j++)
+         array_push_back( &cur, sys->assets_virtual[i]->presences[j] );
+
+   changed = (array_size(cur) != array_size(node->assets));
+   for (int i=0; !changed && i<array_size(cur); i++) {
+      const AssetPresence *a = &cur[i];
+      const AssetPresence *b = &node->assets[i];
+      changed = (a->faction != b->faction) || (a->base != b->base) ||
+            (a->bonus != b->bonus) || (a->range != b->range);
+   }
+
+   array_free( node->assets );
+   node->assets = cur;
+   return changed;
+}
+
+/**
+ * @brief Updates the recorded jumps of a system.
+ *
+ *    @param sysid System to update.
+ *    @return 1 if they changed since last time, 0 otherwise.
+ */
+static int presence_updateJumps( int sysid )
+{
+   StarSystem *sys = &systems_stack[sysid];
+   PresenceNode *node = &presence_nodes[sysid];
+   int *cur = array_create_size( int, 2*array_size(sys->jumps) );
+   int changed;
+
+   /* Only the target and the flags used by the spill matter. */
+   for (int i=0; i<array_size(sys->jumps); i++) {
+      const JumpPoint *jp = &sys->jumps[i];
+      array_push_back( &cur, (jp->target != NULL) ? jp->target->id : -1 );
+      array_push_back( &cur, (int)(jp->flags & (JP_HIDDEN | JP_EXITONLY)) );
+   }
+
+   changed = (array_size(cur) != array_size(node->jumps)) ||
+      ((array_size(cur) > 0) && (memcmp( cur, node->jumps, array_size(cur)*sizeof(int) ) != 0));
+
+   array_free( node->jumps );
+   node->jumps = cur;
+   return changed;
+}
+
+/**
+ * @brief Spills an asset presence and records its contributions.
+ *
+ *    @param sysid System the asset is in.
+ *    @param ap Asset presence to add.
+ *    @param slot Slot in presence_sources to reuse, or -1 to take a new one.
+ *    @param[out] touched Marks the systems receiving presence.
+ */
+static void presence_addSource( int sysid, const AssetPresence *ap, int slot, char *touched )
+{
+   PresenceReach *reach;
+   PresenceSource *src;
+   const FactionGenerator *fgens;
+
+   reach = system_presenceReach( &systems_stack[sysid], ap );
+   if (reach == NULL) {
+      /* Nothing to contribute anymore, give the slot back. */
+      if (slot >= 0) {
+         int *sources = presence_nodes[sysid].sources;
+         for (int i=0; i<array_size(sources); i++)
+            if (sources[i] == slot) {
+               array_erase( &presence_nodes[sysid].sources, &sources[i], &sources[i+1] );
+               break;
+            }
+         presence_sources[slot].sys = -1;
+         array_push_back( &presence_free, slot );
+      }
+      return;
+   }
+
+   /* Get a slot. */
+   if (slot < 0) {
+      if (array_size(presence_free) > 0) {
+         slot = presence_free[ array_size(presence_free)-1 ];
+         array_resize( &presence_free, array_size(presence_free)-1 );
+      }
+      else {
+         slot = array_size(presence_sources);
+         memset( &array_grow( &presence_sources ), 0, sizeof(PresenceSource) );
+      }
+      array_push_back( &presence_nodes[sysid].sources, slot );
+   }
+   src      = &presence_sources[slot];
+   src->sys = sysid;
+   src->ap  = *ap;
+   if (src->reach == NULL)
+      src->reach = array_create_size( int, array_size(reach) );
+   array_resize( &src->reach, 0 );
+
+   /* Record the contributions to every reached system. */
+   fgens = faction_generators( ap->faction );
+   for (int i=0; i<array_size(reach); i++) {
+      int id = reach[i].sys->id;
+      double f = reach[i].factor;
+      PresenceSpill **spill = &presence_nodes[id].spill;
+      array_push_back( &src->reach, id );
+      array_push_back( spill, ((PresenceSpill){ .source = slot, .faction = ap->faction,
+            .base = ap->base*f, .bonus = ap->bonus*f }) );
+      for (int j=0; j<array_size(fgens); j++)
+         array_push_back( spill, ((PresenceSpill){ .source = slot, .faction = fgens[j].id,
+               .base = MAX(0., ap->base*f*fgens[j].weight), .bonus = MAX(0., ap->bonus*f*fgens[j].weight) }) );
+      touched[id] = 1;
+   }
+
+   array_free( reach );
+}
+
+/**
+ * @brief Removes the contributions of a source from all the systems it reaches.
+ *
+ *    @param slot Source to remove.
+ *    @param[out] touched Marks the systems losing presence.
+ */
+static void presence_rmSource( int slot, char *touched )
+{
+   PresenceSource *src = &presence_sources[slot];
+
+   for (int i=0; i<array_size(src->reach); i++) {
+      int id = src->reach[i];
+      PresenceSpill *spill = presence_nodes[id].spill;
+      int n = 0;
+      for (int j=0; j<array_size(spill); j++)
+         if (spill[j].source != slot)
+            spill[n++] = spill[j];
+      array_resize( &presence_nodes[id].spill, n );
+      touched[id] = 1;
+   }
+   array_resize( &src->reach, 0 );
+}
+
+/**
+ * @brief Recomputes the presence of a system from the contributions it receives.
+ *
+ * Spawning state of factions that keep presence is preserved.
+ *
+ *    @param sys System to recompute.
+ */
+static void presence_rebuildSystem( StarSystem *sys )
+{
+   SystemPresence *old = sys->presence;
+   const PresenceSpill *spill = presence_nodes[sys->id].spill;
+
+   sys->presence = array_create( SystemPresence );
+   for (int i=0; i<array_size(spill); i++) {
+      int n = array_size(sys->presence);
+      system_presenceApply( sys, spill[i].faction, spill[i].base, spill[i].bonus );
+      if (array_size(sys->presence) == n)
+         continue;
+
+      /* New faction entry, carry over the spawning state. */
+      for (int j=0; j<array_size(old); j++) {
+         if (old[j].faction != spill[i].faction)
+            continue;
+         sys->presence[n].curUsed  = old[j].curUsed;
+         sys->presence[n].timer    = old[j].timer;
+         sys->presence[n].disabled = old[j].disabled;
+         break;
+      }
+   }
+   array_free( old );
+}
+
+/**
+ * @brief Brings the presence of all systems up to date.
+ *
+ * Presence is kept as the combination of the contributions of every asset
+ *  presence. Only the assets of systems whose assets changed, and those whose
+ *  spill crosses a system whose jumps changed, get spilled again, and only
+ *  the systems they reach are recomputed.
  */
 void space_reconstructPresences( void )
 {
-   /* Reset the presence in each system. */
-   for (int i=0; i<array_size(systems_stack); i++) {
-      array_free(systems_stack[i].presence);
-      systems_stack[i].presence  = array_create( SystemPresence );
-      systems_stack[i].ownerpresence = 0.;
+   int nsys, nsrc, full, curtouched;
+   char *achg, *redo, *touched;
+
+   nsys = array_size(systems_stack);
+
+   /* The set of systems changed, start over. */
+   full = (presence_nodes == NULL) || (array_size(presence_nodes) != nsys);
+   if (full) {
+      presence_destroy();
+      presence_nodes = array_create_size( PresenceNode, nsys );
+      array_resize( &presence_nodes, nsys );
+      memset( presence_nodes, 0, nsys*sizeof(PresenceNode) );
+      presence_sources = array_create( PresenceSource );
+      presence_free = array_create( int );
+      for (int i=0; i<nsys; i++) {
+         presence_nodes[i].assets  = array_create( AssetPresence );
+         presence_nodes[i].jumps   = array_create( int );
+         presence_nodes[i].sources = array_create( int );
+         presence_nodes[i].spill   = array_create( PresenceSpill );
+      }
    }
 
-   /* Re-add presence to each system. */
-   for (int i=0; i<array_size(systems_stack); i++)
-      system_addAllPlanetsPresence(&systems_stack[i]);
+   achg     = calloc( nsys, sizeof(char) );
+   touched  = calloc( nsys, sizeof(char) );
+   nsrc     = array_size(presence_sources);
+   redo     = calloc( MAX(nsrc,1), sizeof(char) );
+
+   /* Find what changed. Spill through a system depends on its jumps. */
+   for (int i=0; i<nsys; i++) {
+      achg[i] = presence_updateAssets( i ) || full;
+      if (presence_updateJumps( i ))
+         for (int j=0; j<array_size(presence_nodes[i].spill); j++)
+            redo[ presence_nodes[i].spill[j].source ] = 1;
+      if (achg[i])
+         for (int j=0; j<array_size(presence_nodes[i].sources); j++)
+            redo[ presence_nodes[i].sources[j] ] = 1;
+   }
 
-   /* Determine dominant faction. */
-   for (int i=0; i<array_size(systems_stack); i++) {
+   /* Take away the old contributions. Sources of systems with changed assets
+    * are dropped, the others are spilled again over the new jumps. */
+   for (int s=0; s<nsrc; s++) {
+      PresenceSource *src = &presence_sources[s];
+      if (!redo[s] || (src->sys < 0))
+         continue;
+      presence_rmSource( s, touched );
+      if (achg[src->sys]) {
+         src->sys = -1;
+         array_push_back( &presence_free, s );
+      }
+      else {
+         AssetPresence ap = src->ap;
+         presence_addSource( src->sys, &ap, s, touched );
+      }
+   }
+
+   /* Add the current assets of systems that changed. */
+   for (int i=0; i<nsys; i++) {
+      PresenceNode *node = &presence_nodes[i];
+      if (!achg[i])
+         continue;
+      array_resize( &node->sources, 0 );
+      for (int j=0; j<array_size(node->assets); j++) {
+         AssetPresence ap = node->assets[j];
+         presence_addSource( i, &ap, -1, touched );
+      }
+      if (full)
+         touched[i] = 1;
+   }
+
+   /* Recompute presence and the dominant faction where it changed. */
+   for (int i=0; i<nsys; i++) {
+      if (!touched[i])
+         continue;
+      presence_rebuildSystem( &systems_stack[i] );
       system_setFaction( &systems_stack[i] );
       systems_stack[i].ownerpresence = system_getPresence( &systems_stack[i], systems_stack[i].faction );
    }
+   curtouched = (cur_system != NULL) && touched[ cur_system->id ];
+
+   free( achg );
+   free( redo );
+   free( touched );
+
+#if DEBUG_PARANOID
+   space_checkPresences();
+#endif /* DEBUG_PARANOID */
 
    /* Have to redo the scheduler because everything changed. */
    /* TODO this actually ignores existing presence and will temporarily increase system presence more than normal... */
-   if (cur_system != NULL)
+   if (curtouched)
       system_scheduler( 0., 1 );
 }
 
+#if DEBUGGING
+/**
+ * @brief Checks the incrementally maintained presence against a full rebuild.
+ *
+ *    @return Number of systems whose presence does not match.
+ */
+int space_checkPresences (void)
+{
+   int nsys, nbad;
+   SystemPresence **kept;
+
+   /* Rebuild everything from scratch next to what we have. */
+   nsys = array_size(systems_stack);
+   kept = malloc( nsys * sizeof(SystemPresence*) );
+   for (int i=0; i<nsys; i++) {
+      kept[i] = systems_stack[i].presence;
+      systems_stack[i].presence = array_create( SystemPresence );
+   }
+   for (int i=0; i<nsys; i++)
+      system_addAllPlanetsPresence( &systems_stack[i] );
+
+   nbad = 0;
+   for (int i=0; i<nsys; i++) {
+      StarSystem *sys = &systems_stack[i];
+      int bad = (array_size(sys->presence) != array_size(kept[i]));
+      for (int j=0; j<array_size(sys->presence); j++) {
+         const SystemPresence *sp = &sys->presence[j];
+         const SystemPresence *kp = NULL;
+         for (int k=0; k<array_size(kept[i]); k++)
+            if (kept[i][k].faction == sp->faction)
+               kp = &kept[i][k];
+         if ((kp != NULL) && (fabs(kp->base - sp->base) <= 1e-6 * (1. + fabs(sp->base)))
+               && (fabs(kp->bonus - sp->bonus) <= 1e-6 * (1. + fabs(sp->bonus))))
+            continue;
+         WARN(_("Presence of '%s' in system '%s' is %.3f+%.3f, a full rebuild gives %.3f+%.3f."),
+               faction_name(sp->faction), sys->name,
+               (kp != NULL) ? kp->base : 0., (kp != NULL) ? kp->bonus : 0.,
+               sp->base, sp->bonus );
+         bad = 1;
+      }
+      nbad += bad;
+
+      /* Keep the incremental presence, it has the spawning state. */
+      array_free( sys->presence );
+      sys->presence = kept[i];
+   }
+   free( kept );
+
+   if (nbad > 0)
+      WARN(n_("Incremental presence differs from a full rebuild in %d system.",
+               "Incremental presence differs from a full rebuild in %d systems.", nbad), nbad);
+   return nbad;
+}
+#endif /* DEBUGGING */
+
 /**
  * @brief See if the position is in an asteroid field.
  *
@@ -4453,6 +5147,353 @@ void asteroid_hit( Asteroid *a, const Damage *dmg )
    }
 }
 
+/**
+ * @brief Gets the asteroid grid cell of a coordinate.
+ */
+static int asteroid_gridCell( double x )
+{
+   return (int)floor( CLAMP( -1e9, 1e9, x / ASTEROID_GRID_CELL ) );
+}
+
+/**
+ * @brief Hashes an asteroid grid cell into a bucket.
+ */
+static int asteroid_gridBucket( int ix, int iy )
+{
+   return (((unsigned int)ix * 73856093u) ^ ((unsigned int)iy * 19349663u)) & (ASTEROID_GRID_BUCKETS-1);
+}
+
+/**
+ * @brief Bucketizes the asteroids of the current system so weapon collisions
+ *        only look at the nearby ones.
+ *
+ * Rebuilt once per space_update after the asteroids move, which is a couple of
+ *  linear passes over the asteroids.
+ */
+static void asteroid_gridBuild (void)
+{
+   int count[ASTEROID_GRID_BUCKETS];
+   int n;
+
+   if (asteroid_grid.asteroids == NULL)
+      asteroid_grid.asteroids = array_create( Asteroid* );
+
+   /* Keep the statistics of the previous update around for display. */
+   asteroid_grid.last_tested  = asteroid_grid.tested;
+   asteroid_grid.last_total   = asteroid_grid.queries * array_size(asteroid_grid.asteroids);
+   asteroid_grid.queries      = 0;
+   asteroid_grid.tested       = 0;
+
+   /* Count the asteroids per bucket, only those that exist. */
+   memset( count, 0, sizeof(count) );
+   n = 0;
+   asteroid_grid.radius = 0.;
+   for (int i=0; i<array_size(cur_system->asteroids); i++) {
+      AsteroidAnchor *ast = &cur_system->asteroids[i];
+      for (int j=0; j<ast->nb; j++) {
+         const Asteroid *a = &ast->asteroids[j];
+         const glTexture *gfx;
+         if ((a->appearing == ASTEROID_INVISIBLE) || (a->appearing == ASTEROID_INIT))
+            continue;
+         count[ asteroid_gridBucket( asteroid_gridCell(a->pos.x), asteroid_gridCell(a->pos.y) ) ]++;
+         gfx = asteroid_types[ a->type ].gfxs[ a->gfxID ];
+         asteroid_grid.radius = MAX( asteroid_grid.radius, MAX( gfx->sw, gfx->sh ) / 2. );
+         n++;
+      }
+   }
+   array_resize( &asteroid_grid.asteroids, n );
+
+   /* Prefix sum into bucket offsets. */
+   asteroid_grid.start[0] = 0;
+   for (int i=0; i<ASTEROID_GRID_BUCKETS; i++) {
+      asteroid_grid.start[i+1] = asteroid_grid.start[i] + count[i];
+      count[i] = asteroid_grid.start[i];
+   }
+
+   /* Scatter the asteroids. */
+   for (int i=0; i<array_size(cur_system->asteroids); i++) {
+      AsteroidAnchor *ast = &cur_system->asteroids[i];
+      for (int j=0; j<ast->nb; j++) {
+         Asteroid *a = &ast->asteroids[j];
+         int b;
+         if ((a->appearing == ASTEROID_INVISIBLE) || (a->appearing == ASTEROID_INIT))
+            continue;
+         b = asteroid_gridBucket( asteroid_gridCell(a->pos.x), asteroid_gridCell(a->pos.y) );
+         asteroid_grid.asteroids[ count[b]++ ] = a;
+      }
+   }
+
+   asteroid_grid.sys    = cur_system;
+   asteroid_grid.valid  = 1;
+}
+
+/**
+ * @brief Forces the asteroid grid to be rebuilt on the next query.
+ */
+static void asteroid_gridInvalidate (void)
+{
+   asteroid_grid.valid = 0;
+}
+
+/**
+ * @brief Gets the asteroids that may overlap an axis aligned box.
+ *
+ * Only does the broadphase, the caller is expected to check the asteroid state
+ *  and do the actual collision.
+ *
+ *    @param x0 Left side of the box.
+ *    @param y0 Bottom side of the box.
+ *    @param x1 Right side of the box.
+ *    @param y1 Top side of the box.
+ *    @param[in,out] found Array (array.h) to fill with candidates, created if NULL.
+ *    @return Number of candidates found.
+ */
+static int asteroid_gridQuery( double x0, double y0, double x1, double y1, Asteroid ***found )
+{
+   int ix0, iy0, ix1, iy1, all;
+   double pad;
+
+   if (*found == NULL)
+      *found = array_create( Asteroid* );
+   array_resize( found, 0 );
+
+   if (cur_system == NULL)
+      return 0;
+
+   /* Make sure the grid is up to date. */
+   if (!asteroid_grid.valid || (asteroid_grid.sys != cur_system))
+      asteroid_gridBuild();
+   if (array_size(asteroid_grid.asteroids) == 0)
+      return 0;
+
+   /* Cells to look at, padded by the asteroid size and movement. */
+   pad = asteroid_grid.radius + ASTEROID_GRID_SLACK;
+   ix0 = asteroid_gridCell( x0 - pad );
+   iy0 = asteroid_gridCell( y0 - pad );
+   ix1 = asteroid_gridCell( x1 + pad );
+   iy1 = asteroid_gridCell( y1 + pad );
+   /* Covering more cells than there are buckets, just look at them all. */
+   all = ((ix1-ix0+1.) * (iy1-iy0+1.) >= ASTEROID_GRID_BUCKETS);
+   if (all)
+      ix0 = iy0 = ix1 = iy1 = 0;
+   else
+      asteroid_grid.stamp++;
+
+#if DEBUGGING
+   /* Same as checking every asteroid of every field. */
+   if (asteroid_gridBrute) {
+      array_resize( found, array_size(asteroid_grid.asteroids) );
+      memcpy( *found, asteroid_grid.asteroids, array_size(asteroid_grid.asteroids) * sizeof(Asteroid*) );
+      asteroid_grid.queries++;
+      asteroid_grid.tested += array_size(*found);
+      return array_size(*found);
+   }
+#endif /* DEBUGGING */
+
+   for (int ix=ix0; ix<=ix1; ix++) {
+      for (int iy=iy0; iy<=iy1; iy++) {
+         int b0, b1;
+         if (all) {
+            b0 = 0;
+            b1 = ASTEROID_GRID_BUCKETS;
+         }
+         else {
+            b0 = asteroid_gridBucket( ix, iy );
+            /* Different cells may share a bucket, only look at it once. */
+            if (asteroid_grid.visited[b0] == asteroid_grid.stamp)
+               continue;
+            asteroid_grid.visited[b0] = asteroid_grid.stamp;
+            b1 = b0+1;
+         }
+
+         for (int j=asteroid_grid.start[b0]; j<asteroid_grid.start[b1]; j++) {
+            Asteroid *a = asteroid_grid.asteroids[j];
+            /* Buckets are shared between cells, so cull by the box. */
+            if ((a->pos.x < x0-pad) || (a->pos.x > x1+pad) ||
+                  (a->pos.y < y0-pad) || (a->pos.y > y1+pad))
+               continue;
+            array_push_back( found, a );
+         }
+      }
+   }
+
+   asteroid_grid.queries++;
+   asteroid_grid.tested += array_size(*found);
+   return array_size(*found);
+}
+
+/**
+ * @brief Gets the asteroids that may be within a radius of a point.
+ *
+ *    @param pos Centre of the query.
+ *    @param r Radius of the query, not counting the asteroid size.
+ *    @param[in,out] found Array (array.h) to fill with candidates, created if NULL.
+ *    @return Number of candidates found.
+ */
+int asteroid_queryRange( const Vector2d *pos, double r, Asteroid ***found )
+{
+   return asteroid_gridQuery( pos->x-r, pos->y-r, pos->x+r, pos->y+r, found );
+}
+
+/**
+ * @brief Gets the asteroids that may be touched by a line segment, such as a beam.
+ *
+ *    @param pos Start of the segment.
+ *    @param dir Direction of the segment.
+ *    @param length Length of the segment.
+ *    @param[in,out] found Array (array.h) to fill with candidates, created if NULL.
+ *    @return Number of candidates found.
+ */
+int asteroid_queryLine( const Vector2d *pos, double dir, double length, Asteroid ***found )
+{
+   double ex, ey, pad, c, sn;
+   int n, k;
+
+   c  = cos(dir);
+   sn = sin(dir);
+   ex = pos->x + length*c;
+   ey = pos->y + length*sn;
+   n  = asteroid_gridQuery( MIN(pos->x,ex), MIN(pos->y,ey),
+         MAX(pos->x,ex), MAX(pos->y,ey), found );
+   if (n == 0)
+      return 0;
+#if DEBUGGING
+   if (asteroid_gridBrute)
+      return n;
+#endif /* DEBUGGING */
+
+   /* The box of a diagonal beam is mostly empty, drop what is far from the line. */
+   pad = asteroid_grid.radius + ASTEROID_GRID_SLACK;
+   k  = 0;
+   for (int i=0; i<n; i++) {
+      Asteroid *a = (*found)[i];
+      double dx, dy, t;
+      dx = a->pos.x - pos->x;
+      dy = a->pos.y - pos->y;
+      t  = CLAMP( 0., length, dx*c + dy*sn );
+      if (pow2(dx - t*c) + pow2(dy - t*sn) > pow2(pad))
+         continue;
+      (*found)[k++] = a;
+   }
+   array_resize( found, k );
+   asteroid_grid.tested -= n-k;
+   return k;
+}
+
+/**
+ * @brief Gets how well the asteroid grid did during the previous update.
+ *
+ *    @param[out] tested Asteroids handed to the narrowphase.
+ *    @param[out] total Asteroids that checking every asteroid would have handed.
+ */
+void asteroid_gridStats( int *tested, int *total )
+{
+   *tested = asteroid_grid.last_tested;
+   *total  = asteroid_grid.last_total;
+}
+
+#if DEBUGGING
+/**
+ * @brief Makes asteroid queries return every asteroid, like before the grid.
+ *
+ *    @param enable Whether to skip the grid.
+ */
+void asteroid_gridSetBrute( int enable )
+{
+   asteroid_gridBrute = enable;
+}
+
+/**
+ * @brief Sets the current system's asteroid fields aside for benchmarking.
+ *
+ * The system gets copies of its fields plus a dense field of visible and
+ *  still asteroids, so whatever the benchmark blows up, the game's fields are
+ *  left as they were. The asteroids are placed from a fixed seed so the field
+ *  is the same every time without touching the game RNG.
+ *
+ *    @param pos Centre of the field.
+ *    @param radius Radius of the field.
+ *    @param nb Number of asteroids.
+ *    @return 0 on success.
+ */
+int asteroids_benchmarkAdd( const Vector2d *pos, double radius, int nb )
+{
+   AsteroidAnchor *fields, *ast;
+   uint32_t seed = 2463534242u;
+   int ntypes = array_size(asteroid_types);
+
+   if ((cur_system == NULL) || (ntypes == 0) || asteroid_benchmarking)
+      return -1;
+
+   /* Work on copies, keeping the indices the same. */
+   fields = array_create_size( AsteroidAnchor, array_size(cur_system->asteroids)+1 );
+   for (int i=0; i<array_size(cur_system->asteroids); i++) {
+      const AsteroidAnchor *live = &cur_system->asteroids[i];
+      AsteroidAnchor *copy = &array_grow( &fields );
+      *copy = *live;
+      copy->asteroids = malloc( MAX(1,live->nb) * sizeof(Asteroid) );
+      memcpy( copy->asteroids, live->asteroids, live->nb * sizeof(Asteroid) );
+      copy->type = malloc( MAX(1,live->ntype) * sizeof(int) );
+      memcpy( copy->type, live->type, live->ntype * sizeof(int) );
+   }
+
+   /* The benchmark field, any asteroid type may respawn in it. */
+   ast = &array_grow( &fields );
+   memset( ast, 0, sizeof(AsteroidAnchor) );
+   ast->id        = array_size(fields)-1;
+   ast->pos       = *pos;
+   ast->radius    = radius;
+   ast->area      = M_PI * pow2(radius);
+   ast->ntype     = ntypes;
+   ast->type      = malloc( ntypes * sizeof(int) );
+   for (int i=0; i<ntypes; i++)
+      ast->type[i] = i;
+   ast->nb        = nb;
+   ast->asteroids = calloc( nb, sizeof(Asteroid) );
+   for (int i=0; i<nb; i++) {
+      Asteroid *a = &ast->asteroids[i];
+      const AsteroidType *at;
+      double r, theta;
+      seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+      a->id       = i;
+      a->parent   = ast->id;
+      a->type     = seed % ntypes;
+      at          = &asteroid_types[ a->type ];
+      a->gfxID    = (seed >> 8) % MAX( 1, array_size(at->gfxs) );
+      a->armour   = at->armour;
+      r           = radius * sqrt( (double)(seed & 0xffff) / 65535. );
+      theta       = 2. * M_PI * (double)(seed >> 16) / 65535.;
+      vect_cset( &a->pos, pos->x + r*cos(theta), pos->y + r*sin(theta) );
+      vect_cset( &a->vel, 0., 0. );
+      a->appearing = ASTEROID_VISIBLE;
+   }
+
+   asteroid_benchmarkLive  = cur_system->asteroids;
+   asteroid_benchmarking   = 1;
+   cur_system->asteroids   = fields;
+   asteroid_gridInvalidate();
+   return 0;
+}
+
+/**
+ * @brief Throws away the fields used by the benchmark and brings back the game's.
+ */
+void asteroids_benchmarkRemove (void)
+{
+   if (!asteroid_benchmarking)
+      return;
+   for (int i=0; i<array_size(cur_system->asteroids); i++) {
+      free( cur_system->asteroids[i].asteroids );
+      free( cur_system->asteroids[i].type );
+   }
+   array_free( cur_system->asteroids );
+   cur_system->asteroids   = asteroid_benchmarkLive;
+   asteroid_benchmarkLive  = NULL;
+   asteroid_benchmarking   = 0;
+   asteroid_gridInvalidate();
+}
+#endif /* DEBUGGING */
+
 /**
  * @brief Makes an asteroid explode.
  *
@@ -19,6 +19,7 @@ typedef struct JumpPoint_ JumpPoint;
 
 #define SYSTEM_SIMULATE_TIME_PRE   25. /**< Time to simulate system before player is added, during this time special effect creation is disabled. */
 #define SYSTEM_SIMULATE_TIME_POST   5. /**< Time to simulate the system before the player is added, however, effects are added. */
+#define SYSTEM_SIMULATE_FAST_STEP   3. /**< Timestep multiplier while simulating without effects, where only broadphase collisions are done. */
 #define MAX_HYPERSPACE_VEL    25 /**< Speed to brake to before jumping. */
 #define ASTEROID_REF_AREA     500e3/**< The "density" value in an asteroid field means 1 rock per this area. */
 
@@ -410,6 +411,7 @@ int system_rmJump( StarSystem *sys, const char *jumpname );
 void space_render( const double dt );
 void space_renderOverlay( const double dt );
 void planets_render (void);
+void space_renderStats( int *draws, int *sprites );
 
 /*
  * Presence stuff.
@@ -420,6 +422,9 @@ double system_getPresence( const StarSystem *sys, int faction );
 double system_getPresenceFull( const StarSystem *sys, int faction, double *base, double *bonus );
 void system_addAllPlanetsPresence( StarSystem *sys );
 void space_reconstructPresences( void );
+#if DEBUGGING
+int space_checkPresences (void);
+#endif /* DEBUGGING */
 void system_rmCurrentPresence( StarSystem *sys, int faction, double amount );
 
 /*
@@ -428,6 +433,7 @@ void system_rmCurrentPresence( StarSystem *sys, int faction, double amount );
 void space_update( const double dt );
 int space_isSimulation (void);
 int space_isSimulationEffects (void);
+int space_isSimulationFast (void);
 
 /*
  * Graphics.
@@ -476,6 +482,14 @@ int space_calcJumpInPos( const StarSystem *in, const StarSystem *out, Vector2d *
 void asteroid_hit( Asteroid *a, const Damage *dmg );
 int space_isInField ( const Vector2d *p );
 const AsteroidType *space_getType ( int ID );
+int asteroid_queryRange( const Vector2d *pos, double r, Asteroid ***found );
+int asteroid_queryLine( const Vector2d *pos, double dir, double length, Asteroid ***found );
+void asteroid_gridStats( int *tested, int *total );
+#if DEBUGGING
+void asteroid_gridSetBrute( int enable );
+int asteroids_benchmarkAdd( const Vector2d *pos, double radius, int nb );
+void asteroids_benchmarkRemove (void);
+#endif /* DEBUGGING */
 
 /*
  * Misc.
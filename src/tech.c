@@ -36,6 +36,8 @@ typedef enum tech_item_type_e {
    TECH_TYPE_GROUP_POINTER /**< Tech contains a tech group pointer. */
 } tech_item_type_t;
 
+#define TECH_TYPE_RESOLVED    (TECH_TYPE_COMMODITY+1) /**< Number of item types that get resolved. */
+
 /**
  * @brief Item contained in a tech group.
  */
@@ -57,18 +59,35 @@ typedef struct tech_item_s {
 struct tech_group_s {
    char *name;          /**< Name of the tech group. */
    tech_item_t *items;  /**< Items in the tech group. */
+   /* Caches, rebuilt lazily whenever tech_generation changes. */
+   void **resolved[TECH_TYPE_RESOLVED]; /**< Flattened and deduplicated items per type (array.h). */
+   unsigned int resolved_gen; /**< Generation the resolved items belong to. */
+   int resolving;       /**< Whether the group is being resolved, guards against cycles. */
+   int *names;          /**< Hash table of item indices (offset by one) by name. */
+   int nnames;          /**< Number of slots in the name table (power of two). */
+   unsigned int names_gen; /**< Generation the name table belongs to. */
 };
 
 /*
  * Group list.
  */
 static tech_group_t *tech_groups = NULL;
+/**
+ * @brief Bumped whenever any group changes.
+ *
+ * Groups nest, so a change anywhere can affect the resolved items of every
+ * group pointing at it. Rather than tracking parents, all caches compare
+ * against this counter and rebuild when it moves on.
+ */
+static unsigned int tech_generation = 1;
 
 /*
  * Prototypes.
  */
 static void tech_createMetaGroup( tech_group_t *grp, tech_group_t **tech, int num );
 static void tech_freeGroup( tech_group_t *grp );
+static void tech_freeCache( tech_group_t *grp );
+static void tech_changed (void);
 static char* tech_getItemName( tech_item_t *item );
 /* Loading. */
 static tech_item_t *tech_itemGrow( tech_group_t *grp );
@@ -80,8 +99,13 @@ static int tech_addItemCommodity( tech_group_t *grp, const char* name );
 static int tech_getID( const char *name );
 static int tech_addItemGroupPointer( tech_group_t *grp, const tech_group_t *ptr );
 static int tech_addItemGroup( tech_group_t *grp, const char* name );
+/* Lookups. */
+static uint32_t tech_hashStr( const char *str );
+static int tech_findItem( const tech_group_t *tech, const char *name );
 /* Getting by tech. */
-static void** tech_addGroupItem( void **items, tech_item_type_t type, const tech_group_t *tech );
+static int tech_setInsert( const void **set, int mask, const void *ptr );
+static void** tech_resolve( const tech_group_t *tech, tech_item_type_t type );
+static void** tech_getItems( const tech_group_t *tech, tech_item_type_t type );
 
 /**
  * @brief Loads the tech information.
@@ -185,6 +209,27 @@ static void tech_freeGroup( tech_group_t *grp )
 {
    free(grp->name);
    array_free( grp->items );
+   tech_freeCache( grp );
+   free( grp->names );
+}
+
+/**
+ * @brief Frees the resolved items of a group.
+ */
+static void tech_freeCache( tech_group_t *grp )
+{
+   for (int i=0; i<TECH_TYPE_RESOLVED; i++) {
+      array_free( grp->resolved[i] );
+      grp->resolved[i] = NULL;
+   }
+}
+
+/**
+ * @brief Marks all the caches as stale after a group has been modified.
+ */
+static void tech_changed (void)
+{
+   tech_generation++;
 }
 
 /**
@@ -353,6 +398,7 @@ static int tech_parseNodeData( tech_group_t *tech, xmlNodePtr parent )
       WARN(_("Tech group '%s' has unknown node '%s'."), tech->name, node->name);
    } while (xml_nextNode( node ));
 
+   tech_changed();
    return 0;
 }
 
@@ -458,6 +504,7 @@ int tech_addItem( const char *name, const char *value )
       return -1;
    }
 
+   tech_changed();
    return 0;
 }
 
@@ -478,6 +525,7 @@ int tech_addItemTech( tech_group_t *tech, const char *value )
       WARN(_("Generic item '%s' not found in tech group"), value );
       return -1;
    }
+   tech_changed();
    return 0;
 }
 
@@ -486,18 +534,15 @@ int tech_addItemTech( tech_group_t *tech, const char *value )
  */
 int tech_rmItemTech( tech_group_t *tech, const char *value )
 {
-   /* Iterate over to find it. */
-   int s = array_size( tech->items );
-   for (int i=0; i<s; i++) {
-      char *buf = tech_getItemName( &tech->items[i] );
-      if (strcmp(buf, value)==0) {
-         array_erase( &tech->items, &tech->items[i], &tech->items[i+1] );
-         return 0;
-      }
+   int i = tech_findItem( tech, value );
+   if (i < 0) {
+      WARN(_("Item '%s' not found in tech group"), value );
+      return -1;
    }
 
-   WARN(_("Item '%s' not found in tech group"), value );
-   return -1;
+   array_erase( &tech->items, &tech->items[i], &tech->items[i+1] );
+   tech_changed();
+   return 0;
 }
 
 /**
@@ -505,7 +550,7 @@ int tech_rmItemTech( tech_group_t *tech, const char *value )
  */
 int tech_rmItem( const char *name, const char *value )
 {
-   int id, s;
+   int id, i;
    tech_group_t *tech;
 
    /* Get ID. */
@@ -518,18 +563,16 @@ int tech_rmItem( const char *name, const char *value )
    /* Comfort. */
    tech  = &tech_groups[id];
 
-   /* Iterate over to find it. */
-   s = array_size( tech->items );
-   for (int i=0; i<s; i++) {
-      char *buf = tech_getItemName( &tech->items[i] );
-      if (strcmp(buf, value)==0) {
-         array_erase( &tech->items, &tech->items[i], &tech->items[i+1] );
-         return 0;
-      }
+   /* Find it. */
+   i = tech_findItem( tech, value );
+   if (i < 0) {
+      WARN(_("Item '%s' not found in tech group '%s'"), value, name );
+      return -1;
    }
 
-   WARN(_("Item '%s' not found in tech group '%s'"), value, name );
-   return -1;
+   array_erase( &tech->items, &tech->items[i], &tech->items[i+1] );
+   tech_changed();
+   return 0;
 }
 
 /**
@@ -600,53 +643,177 @@ static void tech_createMetaGroup( tech_group_t *grp, tech_group_t **tech, int nu
 }
 
 /**
- * @brief Recursive function for creating an array of commodities from a tech group.
+ * @brief Hashes a string (FNV-1a).
  */
-static void** tech_addGroupItem( void **items, tech_item_type_t type, const tech_group_t *tech )
+static uint32_t tech_hashStr( const char *str )
 {
-   /* Set up. */
-   int size  = array_size( tech->items );
+   uint32_t h = 2166136261u;
+   for (const unsigned char *c=(const unsigned char*)str; *c!='\0'; c++) {
+      h ^= *c;
+      h *= 16777619u;
+   }
+   return h;
+}
 
-   /* Load commodities first, then we handle groups. */
-   for (int i=0; i<size; i++) {
-      int f;
-      tech_item_t *item = &tech->items[i];
+/**
+ * @brief Finds a direct item of a group by name.
+ *
+ * Uses a hash table of the item names, rebuilt lazily when groups change.
+ *
+ *    @param tech Tech group to search within.
+ *    @param name Name of the item to find.
+ *    @return Index of the item in the group or -1 if not found.
+ */
+static int tech_findItem( const tech_group_t *tech, const char *name )
+{
+   tech_group_t *grp = (tech_group_t*) tech; /* Only the cache gets modified. */
+   int s = array_size( grp->items );
+   int mask;
 
-      /* Only handle commodities for now. */
-      if (item->type != type)
-         continue;
+   if (s == 0)
+      return -1;
 
-      /* Skip if already in list. */
-      f = 0;
-      for (int j=0; j<array_size(items); j++) {
-         if (items[j] == item->u.ptr) {
-            f = 1;
-            break;
-         }
+   /* Rebuild the name table, kept at most half full. */
+   if ((grp->names == NULL) || (grp->names_gen != tech_generation)) {
+      int n = 16;
+      while (n < 2*s)
+         n <<= 1;
+      if (n != grp->nnames) {
+         free( grp->names );
+         grp->names  = malloc( n * sizeof(int) );
+         grp->nnames = n;
       }
-      if (f == 1)
-         continue;
+      memset( grp->names, 0, n * sizeof(int) );
+      mask = n-1;
+      for (int i=0; i<s; i++) {
+         int j = tech_hashStr( tech_getItemName( &grp->items[i] ) ) & mask;
+         while (grp->names[j] != 0)
+            j = (j+1) & mask;
+         grp->names[j] = i+1;
+      }
+      grp->names_gen = tech_generation;
+   }
 
-      /* Add. */
-      if (items == NULL)
-         items = array_create( void* );
-      array_push_back( &items, item->u.ptr );
+   /* Probe. Items were inserted in order, so duplicates are found first-come. */
+   mask = grp->nnames-1;
+   for (int j=tech_hashStr(name) & mask; grp->names[j] != 0; j=(j+1) & mask) {
+      int i = grp->names[j]-1;
+      if (strcmp( tech_getItemName( &grp->items[i] ), name )==0)
+         return i;
    }
+   return -1;
+}
 
-   /* Now handle other groups. */
+/**
+ * @brief Inserts a pointer into an open addressing set.
+ *
+ *    @return 1 if it was inserted, 0 if it was already there.
+ */
+static int tech_setInsert( const void **set, int mask, const void *ptr )
+{
+   int i = (int)((((uintptr_t)ptr >> 3) * 2654435761u) & mask);
+   while (set[i] != NULL) {
+      if (set[i] == ptr)
+         return 0;
+      i = (i+1) & mask;
+   }
+   set[i] = ptr;
+   return 1;
+}
+
+/**
+ * @brief Gets the flattened items of a given type of a tech group.
+ *
+ * Items of the group itself come first, followed by those of the groups it
+ * contains in order, each item only appearing once. The result is cached in
+ * the group until any group changes.
+ *
+ *    @param tech Tech group to resolve.
+ *    @param type Type of the items to get.
+ *    @return Array (array.h) owned by the group, NULL only on cycles.
+ */
+static void** tech_resolve( const tech_group_t *tech, tech_item_type_t type )
+{
+   tech_group_t *grp = (tech_group_t*) tech; /* Only the cache gets modified. */
+   int size = array_size( grp->items );
+   int n, mask;
+   const void **set;
+   void **items;
+
+   /* Drop stale caches. */
+   if (grp->resolved_gen != tech_generation) {
+      tech_freeCache( grp );
+      grp->resolved_gen = tech_generation;
+   }
+   if (grp->resolved[type] != NULL)
+      return grp->resolved[type];
+
+   /* Groups including themselves would recurse forever. */
+   if (grp->resolving) {
+      WARN(_("Tech group '%s' contains itself."), (grp->name!=NULL) ? grp->name : "(null)" );
+      return NULL;
+   }
+   grp->resolving = 1;
+
+   /* Resolve the groups first to get an upper bound on the items. */
+   n = 0;
    for (int i=0; i<size; i++) {
-      tech_item_t *item = &tech->items[i];
+      tech_item_t *item = &grp->items[i];
+      if (item->type == type)
+         n++;
+      else if (item->type == TECH_TYPE_GROUP)
+         n += array_size( tech_resolve( &tech_groups[ item->u.grp ], type ) );
+      else if (item->type == TECH_TYPE_GROUP_POINTER)
+         n += array_size( tech_resolve( item->u.grpptr, type ) );
+   }
 
-      /* Only handle commodities for now. */
+   /* Set kept at most half full. */
+   mask = 16;
+   while (mask < 2*n)
+      mask <<= 1;
+   set  = calloc( mask, sizeof(void*) );
+   mask--;
+   items = array_create_size( void*, MAX(n,1) );
+
+   /* Own items first, then we handle groups. */
+   for (int i=0; i<size; i++) {
+      tech_item_t *item = &grp->items[i];
+      if ((item->type == type) && tech_setInsert( set, mask, item->u.ptr ))
+         array_push_back( &items, item->u.ptr );
+   }
+   for (int i=0; i<size; i++) {
+      tech_item_t *item = &grp->items[i];
+      void **sub;
       if (item->type == TECH_TYPE_GROUP)
-         items  = tech_addGroupItem( items, type, &tech_groups[ item->u.grp ] );
+         sub = tech_resolve( &tech_groups[ item->u.grp ], type );
       else if (item->type == TECH_TYPE_GROUP_POINTER)
-         items  = tech_addGroupItem( items, type, item->u.grpptr );
+         sub = tech_resolve( item->u.grpptr, type );
+      else
+         continue;
+      for (int j=0; j<array_size(sub); j++)
+         if (tech_setInsert( set, mask, sub[j] ))
+            array_push_back( &items, sub[j] );
    }
+   free( set );
 
+   grp->resolving       = 0;
+   grp->resolved[type]  = items;
    return items;
 }
 
+/**
+ * @brief Gets a copy of the resolved items of a tech group.
+ *
+ *    @return Array (array.h) to be freed by the caller, NULL if empty.
+ */
+static void** tech_getItems( const tech_group_t *tech, tech_item_type_t type )
+{
+   void **items = tech_resolve( tech, type );
+   if (array_size(items) == 0)
+      return NULL;
+   return array_copy( void*, items );
+}
+
 /**
  * @brief Checks whether a given tech group has the specified item.
  *
@@ -656,13 +823,7 @@ static void** tech_addGroupItem( void **items, tech_item_type_t type, const tech
  */
 int tech_hasItem( const tech_group_t *tech, const char *item )
 {
-   int s = array_size( tech->items );
-   for (int i=0; i<s; i++) {
-      char *buf = tech_getItemName( &tech->items[i] );
-      if (strcmp(buf,item)==0)
-         return 1;
-   }
-   return 0;
+   return (tech_findItem( tech, item ) >= 0);
 }
 
 /**
@@ -731,7 +892,7 @@ Outfit** tech_getOutfit( const tech_group_t *tech )
    if (tech==NULL)
       return NULL;
 
-   o  = (Outfit**)tech_addGroupItem( NULL, TECH_TYPE_OUTFIT, tech );
+   o  = (Outfit**) tech_getItems( tech, TECH_TYPE_OUTFIT );
 
    /* Sort. */
    if (o != NULL)
@@ -780,7 +941,7 @@ Ship** tech_getShip( const tech_group_t *tech )
       return NULL;
 
    /* Get the outfits. */
-   s  = (Ship**) tech_addGroupItem( NULL, TECH_TYPE_SHIP, tech );
+   s  = (Ship**) tech_getItems( tech, TECH_TYPE_SHIP );
 
    /* Sort. */
    if (s != NULL)
@@ -853,7 +1014,7 @@ Commodity** tech_getCommodity( const tech_group_t *tech )
       return NULL;
 
    /* Get the commodities. */
-   c  = (Commodity**) tech_addGroupItem( NULL, TECH_TYPE_COMMODITY, tech );
+   c  = (Commodity**) tech_getItems( tech, TECH_TYPE_COMMODITY );
 
    /* Sort. */
    if (c != NULL)
@@ -861,3 +1022,115 @@ Commodity** tech_getCommodity( const tech_group_t *tech )
 
    return c;
 }
+
+
+#if DEBUGGING
+/**
+ * @brief Gathers items the way tech groups were flattened before caching.
+ *
+ * Only kept as a baseline for tech_benchmark. Every item does a linear
+ * search of the list built so far, and nested groups are walked again on
+ * every call.
+ */
+static void** tech_addGroupItemLinear( void **items, tech_item_type_t type, const tech_group_t *tech )
+{
+   int size = array_size( tech->items );
+
+   /* Own items first, then we handle groups. */
+   for (int i=0; i<size; i++) {
+      int f;
+      tech_item_t *item = &tech->items[i];
+      if (item->type != type)
+         continue;
+
+      /* Skip if already in list. */
+      f = 0;
+      for (int j=0; j<array_size(items); j++) {
+         if (items[j] == item->u.ptr) {
+            f = 1;
+            break;
+         }
+      }
+      if (f)
+         continue;
+
+      if (items == NULL)
+         items = array_create( void* );
+      array_push_back( &items, item->u.ptr );
+   }
+
+   for (int i=0; i<size; i++) {
+      tech_item_t *item = &tech->items[i];
+      if (item->type == TECH_TYPE_GROUP)
+         items = tech_addGroupItemLinear( items, type, &tech_groups[ item->u.grp ] );
+      else if (item->type == TECH_TYPE_GROUP_POINTER)
+         items = tech_addGroupItemLinear( items, type, item->u.grpptr );
+   }
+
+   return items;
+}
+
+/**
+ * @brief Benchmarks flattening every tech group with and without the cache.
+ *
+ * Gets the outfits, ships and commodities of every loaded tech group with
+ * the old linear flattening, with tech_resolve on cold caches and with
+ * tech_getItems on warm caches. Logs the timings and warns if any of them
+ * disagree.
+ */
+void tech_benchmark (void)
+{
+   const int iters = 20;
+   const char *names[TECH_TYPE_RESOLVED] = { "outfits", "ships", "commodities" };
+   int ngroups = array_size( tech_groups );
+
+   for (int type=0; type<TECH_TYPE_RESOLVED; type++) {
+      Uint64 t0, t1, t2, t3;
+      double linear, cold, warm;
+      int total, mismatch;
+
+      /* Make sure both give the same items in the same order. */
+      total    = 0;
+      mismatch = 0;
+      tech_changed();
+      for (int i=0; i<ngroups; i++) {
+         void **a = tech_addGroupItemLinear( NULL, type, &tech_groups[i] );
+         void **b = tech_resolve( &tech_groups[i], type );
+         if ((array_size(a) != array_size(b)) ||
+               ((array_size(a) > 0) && (memcmp( a, b, array_size(a)*sizeof(void*) ) != 0)))
+            mismatch++;
+         total += array_size(a);
+         array_free( a );
+      }
+      if (mismatch > 0)
+         WARN(_("Tech benchmark: %d of %d groups resolve %s differently!"),
+               mismatch, ngroups, names[type] );
+
+      t0 = SDL_GetPerformanceCounter();
+      for (int k=0; k<iters; k++)
+         for (int i=0; i<ngroups; i++) {
+            void **items = tech_addGroupItemLinear( NULL, type, &tech_groups[i] );
+            array_free( items );
+         }
+      t1 = SDL_GetPerformanceCounter();
+      for (int k=0; k<iters; k++) {
+         tech_changed();
+         for (int i=0; i<ngroups; i++)
+            tech_resolve( &tech_groups[i], type );
+      }
+      t2 = SDL_GetPerformanceCounter();
+      for (int k=0; k<iters; k++)
+         for (int i=0; i<ngroups; i++) {
+            void **items = tech_getItems( &tech_groups[i], type );
+            array_free( items );
+         }
+      t3 = SDL_GetPerformanceCounter();
+
+      linear = 1000. * (double)(t1-t0) / (double)SDL_GetPerformanceFrequency() / iters;
+      cold   = 1000. * (double)(t2-t1) / (double)SDL_GetPerformanceFrequency() / iters;
+      warm   = 1000. * (double)(t3-t2) / (double)SDL_GetPerformanceFrequency() / iters;
+      DEBUG( _("Tech %s of %d groups (%d items): linear %.3f ms, resolve cold %.3f ms, cached %.3f ms"),
+            names[type], ngroups, total, linear, cold, warm );
+   }
+}
+#endif /* DEBUGGING */
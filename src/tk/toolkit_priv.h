@@ -134,6 +134,7 @@ typedef struct Widget_ {
 #define WINDOW_FULLSCREEN  (1<<4) /**< Window is fullscreen. */
 #define WINDOW_CENTERX     (1<<5) /**< Window is X-centered. */
 #define WINDOW_CENTERY     (1<<6) /**< Window is Y-centered. */
+#define WINDOW_CACHE       (1<<7) /**< Window is rendered through a framebuffer that is only redrawn when dirty. */
 #define WINDOW_KILL        (1<<9) /**< Window should die. */
 #define window_isFlag(w,f) ((w)->flags & (f)) /**< Checks a window flag. */
 #define window_setFlag(w,f) ((w)->flags |= (f)) /**< Sets a window flag. */
@@ -173,6 +174,11 @@ typedef struct Window_ {
    int focus; /**< Current focused widget. */
    Widget *widgets; /**< Widget storage. */
    void *udata; /**< Custom data of the window. */
+
+   /* Render cache. */
+   int dirty; /**< Cached rendering is out of date. */
+   GLuint cache_fbo; /**< Framebuffer holding the cached rendering, 0 if none. */
+   glTexture *cache_tex; /**< Texture attached to cache_fbo. */
 } Window;
 
 /* Window stuff. */
@@ -182,6 +188,7 @@ void toolkit_setWindowPos( Window *wdw, int x, int y );
 int toolkit_inputWindow( Window *wdw, SDL_Event *event, int purge );
 void window_render( Window* w );
 void window_renderOverlay( Window* w );
+void toolkit_setDirty( Window *wdw );
 
 /* Widget stuff. */
 Widget* window_newWidget( Window* w, const char *name );
@@ -71,6 +71,7 @@ void window_addCust( unsigned int wid,
    wgt->dat.cst.render  = render;
    wgt->dat.cst.mouse   = mouse;
    wgt->dat.cst.clip    = 1;
+   wgt->dat.cst.dynamic = 1;
    wgt->dat.cst.focusGain  = focusGain;
    wgt->dat.cst.focusLose  = focusLose;
    wgt->dat.cst.userdata   = data;
@@ -192,6 +193,26 @@ void window_custSetClipping( unsigned int wid, const char *name, int clip )
 }
 
 
+/**
+ * @brief Sets whether the custom widget changes on its own.
+ *
+ * Widgets that only change on input or through the toolkit API can be
+ *  marked as not dynamic so their window can be cached.
+ *
+ *    @param wid Window to which widget belongs.
+ *    @param name Name of the widget.
+ *    @param dynamic Whether or not the widget changes on its own.
+ */
+void window_custSetDynamic( unsigned int wid, const char *name, int dynamic )
+{
+   Widget *wgt = cst_getWidget( wid, name );
+   if (wgt == NULL)
+      return;
+
+   wgt->dat.cst.dynamic = dynamic;
+}
+
+
 /**
  * @brief Sets the widget overlay.
  *
@@ -18,6 +18,7 @@ typedef struct WidgetCustData_ {
    void (*focusGain) (unsigned int wid, const char* wgtname); /**< Get focus. */
    void (*focusLose) (unsigned int wid, const char* wgtname); /**< Lose focus. */
    int clip; /**< 1 if should clip with glScissors or the like, 0 otherwise. */
+   int dynamic; /**< 1 if the rendering can change without input, which disables the window cache. */
    void *userdata;
 } WidgetCustData;
 
@@ -33,6 +34,7 @@ void window_addCust( unsigned int wid,
       void *data );
 
 void window_custSetClipping( unsigned int wid, const char *name, int clip );
+void window_custSetDynamic( unsigned int wid, const char *name, int dynamic );
 void window_custSetOverlay( unsigned int wid, const char *name,
       void (*renderOverlay) (double bx, double by, double bw, double bh, void* data) );
 void *window_custGetData( unsigned int wid, const char *name );
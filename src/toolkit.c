@@ -37,6 +37,13 @@ static int toolkit_delayCounter = 0; /**< Horrible hack around secondary loop. *
 static Window *windows = NULL; /**< Window linked list, not to be confused with MS windows. */
 static int window_dead = 0; /**< There are dead windows lying around. */
 
+/*
+ * render cache
+ */
+#define CACHE_MARGIN 4 /**< Space around cached windows for outlines that spill out of them. */
+static int toolkit_nCached = 0; /**< Windows drawn from their cache last frame. */
+static int toolkit_nDrawn = 0; /**< Windows drawn widget by widget last frame. */
+
 /*
  * simulate keypresses when holding
  */
@@ -80,6 +87,10 @@ static Widget* toolkit_getFocus( Window *wdw );
 static void toolkit_expose( Window *wdw, int expose );
 /* render */
 static void window_renderBorder( Window* w );
+static int window_isCacheable( Window *w );
+static int window_createCache( Window *w, int fw, int fh );
+static void window_freeCache( Window *w );
+static void window_renderCache( Window *w );
 /* Death. */
 static void widget_kill( Widget *wgt );
 static void window_kill( Window *wdw );
@@ -135,6 +146,8 @@ void toolkit_setPos( Window *wdw, Widget *wgt, int x, int y )
  */
 void toolkit_setWindowPos( Window *wdw, int x, int y )
 {
+   toolkit_setDirty( wdw );
+
    wdw->xrel = -1.;
    wdw->yrel = -1.;
 
@@ -197,6 +210,7 @@ void window_resize( unsigned int wid, int w, int h )
    if (wdw == NULL)
       return;
 
+   toolkit_setDirty( wdw );
    wdw->w = (w == -1) ? SCREEN_W : (double) w;
    wdw->h = (h == -1) ? SCREEN_H : (double) h;
    if ((w == -1) && (h == -1)) {
@@ -228,6 +242,7 @@ Widget* window_newWidget( Window* w, const char *name )
    /* NULL protection. */
    if (w==NULL)
       return NULL;
+   toolkit_setDirty( w );
 
    /* Try to find one with the same name first. */
    wlast = NULL;
@@ -321,10 +336,14 @@ Widget* window_getwgt( unsigned int wid, const char* name )
       return NULL;
    }
 
-   /* Find the widget. */
-   for (Widget *wgt=wdw->widgets; wgt!=NULL; wgt=wgt->next)
-      if (strcmp(wgt->name, name)==0)
+   /* Find the widget. Widgets are only looked up by name to be changed, so
+    * assume the window needs to be redrawn. */
+   for (Widget *wgt=wdw->widgets; wgt!=NULL; wgt=wgt->next) {
+      if (strcmp(wgt->name, name)==0) {
+         toolkit_setDirty( wdw );
          return wgt;
+      }
+   }
 
    WARN(_("Widget '%s' not found in window '%u'!"), name, wid );
    return NULL;
@@ -545,6 +564,7 @@ int window_setDisplayname( unsigned int wid, const char *displayname )
    wdw->displayname = NULL;
    if (displayname != NULL)
       wdw->displayname  = strdup(displayname);
+   toolkit_setDirty( wdw );
    return 0;
 }
 
@@ -825,6 +845,65 @@ void window_setBorder( unsigned int wid, int enable )
       window_rmFlag( wdw, WINDOW_NOBORDER );
    else
       window_setFlag( wdw, WINDOW_NOBORDER );
+   toolkit_setDirty( wdw );
+}
+
+/**
+ * @brief Sets whether a window renders through a cache.
+ *
+ * Cached windows are drawn to a framebuffer that is only redrawn when the
+ *  window gets input or its widgets are changed, otherwise it is drawn with a
+ *  single textured quad. Windows showing custom widgets that are not marked
+ *  static with window_custSetDynamic() are always drawn directly.
+ *
+ *    @param wid ID of the window.
+ *    @param enable Whether or not to cache the window.
+ */
+void window_setCache( unsigned int wid, int enable )
+{
+   Window *wdw = window_wget( wid );
+   if (wdw == NULL)
+      return;
+
+   if (enable)
+      window_setFlag( wdw, WINDOW_CACHE );
+   else {
+      window_rmFlag( wdw, WINDOW_CACHE );
+      window_freeCache( wdw );
+   }
+   toolkit_setDirty( wdw );
+}
+
+/**
+ * @brief Marks a window as needing to be redrawn.
+ *
+ * Only needed when something the widgets show changes without going through
+ *  the toolkit API.
+ *
+ *    @param wid ID of the window.
+ */
+void window_setDirty( unsigned int wid )
+{
+   Window *wdw = window_wget( wid );
+   if (wdw == NULL)
+      return;
+   toolkit_setDirty( wdw );
+}
+
+/**
+ * @brief Marks a window as needing to be redrawn.
+ *
+ *    @param wdw Window to mark.
+ */
+void toolkit_setDirty( Window *wdw )
+{
+   wdw->dirty = 1;
+
+   /* Windows that aren't rendered on their own live in tabbed windows, which
+    * don't know their parent, so just invalidate everything. */
+   if (window_isFlag( wdw, WINDOW_NORENDER ))
+      for (Window *w = windows; w != NULL; w = w->next)
+         w->dirty = 1;
 }
 
 /**
@@ -963,6 +1042,7 @@ static void window_kill( Window *wdw )
    /* Destroy the window. */
    free(wdw->name);
    free(wdw->displayname);
+   window_freeCache( wdw );
    wgt = wdw->widgets;
    while (wgt != NULL) {
       Widget *wgtkill = wgt;
@@ -1026,6 +1106,7 @@ void window_destroyWidget( unsigned int wid, const char* wgtname )
    }
 
    toolkit_defocusWidget( wdw, wgt );
+   toolkit_setDirty( wdw );
 
    /* There's dead stuff now. */
    window_dead = 1;
@@ -1437,11 +1518,164 @@ void toolkit_drawScrollbar( int x, int y, int w, int h, double pos )
    toolkit_drawOutline( x + 1, sy, w - 1, 30., 0., toolkit_colDark, NULL );
 }
 
+/**
+ * @brief Checks to see if what a window shows can be cached.
+ *
+ *    @param w Window to check.
+ *    @return 1 if none of the rendered widgets change on their own.
+ */
+static int window_isCacheable( Window *w )
+{
+   for (Widget *wgt=w->widgets; wgt!=NULL; wgt=wgt->next) {
+      if (wgt_isFlag(wgt, WGT_FLAG_KILL))
+         continue;
+
+      /* Custom widgets can render anything. */
+      if ((wgt->type == WIDGET_CUST) && wgt->dat.cst.dynamic)
+         return 0;
+
+      /* Only the active tab gets rendered. */
+      if (wgt->type == WIDGET_TABBEDWINDOW) {
+         Window *wtab = window_wget( wgt->dat.tab.windows[ wgt->dat.tab.active ] );
+         if ((wtab != NULL) && !window_isCacheable( wtab ))
+            return 0;
+      }
+   }
+   return 1;
+}
+
+/**
+ * @brief Creates the framebuffer a window is cached in.
+ *
+ *    @param w Window to create cache of.
+ *    @param fw Width of the framebuffer in pixels.
+ *    @param fh Height of the framebuffer in pixels.
+ *    @return 0 on success.
+ */
+static int window_createCache( Window *w, int fw, int fh )
+{
+   GLenum status;
+
+   w->cache_tex = gl_loadImageData( NULL, fw, fh, 1, 1, NULL );
+
+   glGenFramebuffers( 1, &w->cache_fbo );
+   glBindFramebuffer( GL_FRAMEBUFFER, w->cache_fbo );
+   glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, w->cache_tex->texture, 0 );
+   status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+   glBindFramebuffer( GL_FRAMEBUFFER, gl_screen.current_fbo );
+   gl_checkErr();
+
+   if (status != GL_FRAMEBUFFER_COMPLETE) {
+      WARN(_("Error setting up framebuffer!"));
+      window_freeCache( w );
+      return -1;
+   }
+
+   w->dirty = 1;
+   return 0;
+}
+
+/**
+ * @brief Frees the framebuffer a window is cached in.
+ *
+ *    @param w Window to free cache of.
+ */
+static void window_freeCache( Window *w )
+{
+   if (w->cache_fbo != 0)
+      glDeleteFramebuffers( 1, &w->cache_fbo );
+   w->cache_fbo = 0;
+   gl_freeTexture( w->cache_tex );
+   w->cache_tex = NULL;
+}
+
+/**
+ * @brief Renders a window through its cache, redrawing the cache if dirty.
+ *
+ *    @param w Window to render.
+ */
+static void window_renderCache( Window *w )
+{
+   int fw, fh;
+   double x, y, cw, ch;
+   gl_Matrix4 view, proj;
+   GLuint fbo;
+   int sx, sy;
+
+   /* Area including the outlines. */
+   x  = w->x - CACHE_MARGIN;
+   y  = w->y - CACHE_MARGIN;
+   cw = w->w + 2*CACHE_MARGIN;
+   ch = w->h + 2*CACHE_MARGIN;
+   fw = ceil( cw / gl_screen.mxscale );
+   fh = ceil( ch / gl_screen.myscale );
+
+   /* Size changed, or never created. */
+   if ((w->cache_tex == NULL) || (w->cache_tex->w != fw) || (w->cache_tex->h != fh)) {
+      window_freeCache( w );
+      if (window_createCache( w, fw, fh )) {
+         /* Don't try again. */
+         window_rmFlag( w, WINDOW_CACHE );
+         window_render( w );
+         toolkit_nDrawn++;
+         return;
+      }
+   }
+
+   if (w->dirty) {
+      /* Redirect rendering to the cache, with the corner of the area at the
+       * origin. Same projection gl_viewport() would set up. */
+      fbo   = gl_screen.current_fbo;
+      view  = gl_view_matrix;
+      sx    = gl_screen.x;
+      sy    = gl_screen.y;
+      proj  = gl_Matrix4_Ortho( 0., gl_screen.nw, 0., gl_screen.nh, -1., 1. );
+      if (gl_screen.scale != 1.)
+         proj = gl_Matrix4_Scale( proj, gl_screen.wscale, gl_screen.hscale, 1 );
+      gl_view_matrix = gl_Matrix4_Translate( proj, -x, -y, 0 );
+      gl_screen.x = -x; /* Used by gl_clipRect(). */
+      gl_screen.y = -y;
+      gl_screen.current_fbo = w->cache_fbo;
+      glBindFramebuffer( GL_FRAMEBUFFER, w->cache_fbo );
+      glClearColor( 0., 0., 0., 0. );
+      glClear( GL_COLOR_BUFFER_BIT );
+
+      /* Store premultiplied alpha so the cache blends like drawing directly.
+       * Clear the dirty flag first so widgets changed while rendering (custom
+       * widgets can do that) get picked up next frame. */
+      w->dirty = 0;
+      glBlendFuncSeparate( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+      window_render( w );
+      glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+      /* Restore state. */
+      glClearColor( 0., 0., 0., 1. );
+      gl_screen.current_fbo = fbo;
+      glBindFramebuffer( GL_FRAMEBUFFER, fbo );
+      gl_screen.x    = sx;
+      gl_screen.y    = sy;
+      gl_view_matrix = view;
+
+      toolkit_nDrawn++;
+   }
+   else
+      toolkit_nCached++;
+
+   /* Composite. */
+   glBlendFunc( GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+   gl_renderTexture( w->cache_tex, x, y, cw, ch,
+         0., 0., cw / (fw * gl_screen.mxscale), ch / (fh * gl_screen.myscale), NULL, 0. );
+   glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+}
+
 /**
  * @brief Renders the windows.
  */
 void toolkit_render (void)
 {
+   toolkit_nCached = 0;
+   toolkit_nDrawn  = 0;
+
    /* Only render if open. */
    if (!toolkit_isOpen())
       return;
@@ -1450,12 +1684,31 @@ void toolkit_render (void)
    for (Window *w = windows; w!=NULL; w = w->next) {
       if (!window_isFlag(w, WINDOW_NORENDER) &&
             !window_isFlag(w, WINDOW_KILL)) {
-         window_render(w);
+         if (window_isFlag(w, WINDOW_CACHE) && window_isCacheable(w))
+            window_renderCache(w);
+         else {
+            window_render(w);
+            w->dirty = 1; /* Cache may be stale when it gets used again. */
+            toolkit_nDrawn++;
+         }
+         /* Overlays such as alt text are cheap and change with the mouse. */
          window_renderOverlay(w);
       }
    }
 }
 
+/**
+ * @brief Gets the window rendering statistics of the last frame.
+ *
+ *    @param[out] cached Number of windows drawn from their cache.
+ *    @param[out] drawn Number of windows drawn widget by widget.
+ */
+void toolkit_renderStats( int *cached, int *drawn )
+{
+   *cached = toolkit_nCached;
+   *drawn  = toolkit_nDrawn;
+}
+
 /**
  * @brief Toolkit input handled here.
  *
@@ -1480,6 +1733,9 @@ int toolkit_inputWindow( Window *wdw, SDL_Event *event, int purge )
 {
    int ret;
 
+   /* Widgets update their state on input. */
+   toolkit_setDirty( wdw );
+
    /* See if widget needs event. */
    for (Widget *wgt=wdw->widgets; wgt!=NULL; wgt=wgt->next) {
       if (wgt_isFlag( wgt, WGT_FLAG_RAWINPUT )) {
@@ -2188,6 +2444,7 @@ void toolkit_focusWidget( Window *wdw, Widget *wgt )
    if (!toolkit_isFocusable(wgt) || wgt_isFlag( wgt, WGT_FLAG_FOCUSED ))
       return;
 
+   toolkit_setDirty( wdw );
    wdw->focus = wgt->id;
    wgt_setFlag( wgt, WGT_FLAG_FOCUSED );
    if (wgt->focusGain != NULL)
@@ -2203,6 +2460,7 @@ void toolkit_defocusWidget( Window *wdw, Widget *wgt )
    if (wdw->focus != wgt->id || !wgt_isFlag( wgt, WGT_FLAG_FOCUSED ))
       return;
 
+   toolkit_setDirty( wdw );
    wdw->focus = -1;
    wgt_rmFlag( wgt, WGT_FLAG_FOCUSED );
    if (wgt->focusLose != NULL)
@@ -2400,6 +2658,8 @@ void toolkit_reposition (void)
    for (Window *w = windows; w != NULL; w = w->next) {
       int xorig, yorig, xdiff, ydiff;
 
+      w->dirty = 1;
+
       /* Fullscreen windows must always be full size, though their widgets
        * don't auto-scale. */
       if (window_isFlag( w, WINDOW_FULLSCREEN )) {
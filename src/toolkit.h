@@ -40,6 +40,8 @@ void window_resize( unsigned int wid, int w, int h );
 void window_raise( unsigned int wid );
 void window_lower( unsigned int wid );
 int window_setDisplayname( unsigned int wid, const char *displayname );
+void window_setCache( unsigned int wid, int enable );
+void window_setDirty( unsigned int wid );
 
 /*
  * get
@@ -79,6 +81,7 @@ void* window_getData( unsigned int wid );
  * render
  */
 void toolkit_render (void);
+void toolkit_renderStats( int *cached, int *drawn );
 
 /*
  * input
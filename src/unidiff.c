@@ -22,6 +22,7 @@
 #include "economy.h"
 #include "log.h"
 #include "map_overlay.h"
+#include "md5.h"
 #include "ndata.h"
 #include "nstring.h"
 #include "nxml.h"
@@ -148,6 +149,7 @@ static UniDiff_t *diff_stack = NULL; /**< Currently applied universe diffs. */
 /* Useful variables. */
 static int diff_universe_changed = 0; /**< Whether or not the universe changed. */
 static int diff_universe_defer = 0; /**< Defers changes to later. */
+static int diff_universe_modified = 0; /**< Whether the universe was modified outside of diffs (e.g., editors). */
 
 /*
  * Prototypes.
@@ -166,6 +168,7 @@ static void diff_cleanup( UniDiff_t *diff );
 static void diff_cleanupHunk( UniHunk_t *hunk );
 /* Misc. */;
 static int diff_checkUpdateUniverse (void);
+static void diff_baseDigest( md5_byte_t digest[16] );
 /* Externed. */
 int diff_save( xmlTextWriterPtr writer ); /**< Used in save.c */
 int diff_load( xmlNodePtr parent ); /**< Used in save.c */
@@ -1583,3 +1586,89 @@ void unidiff_universeDefer( int enable )
    if (defer && !enable)
       diff_checkUpdateUniverse();
 }
+
+/**
+ * @brief Marks the universe as having been modified outside of unidiffs.
+ *
+ * Derived results can no longer be looked up by diff_universeDigest() afterwards.
+ */
+void unidiff_universeModified (void)
+{
+   diff_universe_modified = 1;
+}
+
+/**
+ * @brief Gets a digest identifying the universe state, for caching results derived from it.
+ *
+ * The digest covers the base universe data and the sorted list of applied diffs.
+ *
+ *    @return The digest as a hex string (valid until the next call), or NULL if the universe was modified otherwise.
+ */
+const char *diff_universeDigest (void)
+{
+   static char digest[33];
+   static md5_byte_t base[16];
+   static int base_done = 0;
+   md5_state_t md5;
+   md5_byte_t md5val[16];
+   char **names;
+
+   if (diff_universe_modified)
+      return NULL;
+
+   if (!base_done) {
+      diff_baseDigest( base );
+      base_done = 1;
+   }
+
+   md5_init( &md5 );
+   md5_append( &md5, base, sizeof(base) );
+   names = array_create_size( char*, array_size(diff_stack) );
+   for (int i=0; i<array_size(diff_stack); i++)
+      array_push_back( &names, diff_stack[i].name );
+   qsort( names, array_size(names), sizeof(char*), strsort );
+   for (int i=0; i<array_size(names); i++)
+      md5_append( &md5, (const md5_byte_t*)names[i], strlen(names[i])+1 );
+   array_free( names );
+   md5_finish( &md5, md5val );
+
+   for (int i=0; i<16; i++)
+      snprintf( &digest[i * 2], 3, "%02x", md5val[i] );
+   return digest;
+}
+
+/**
+ * @brief Computes the digest of the base universe data (everything the diffs patch, plus the version).
+ */
+static void diff_baseDigest( md5_byte_t digest[16] )
+{
+   const char *dirs[] = { SYSTEM_DATA_PATH, PLANET_DATA_PATH, VIRTUALASSET_DATA_PATH, COMMODITY_DATA_PATH, UNIDIFF_DATA_PATH };
+   const char *files[] = { FACTION_DATA_PATH, TECH_DATA_PATH };
+   md5_state_t md5;
+   char *version = naev_version( 1 );
+
+   md5_init( &md5 );
+   md5_append( &md5, (const md5_byte_t*)version, strlen(version)+1 );
+   for (size_t i=0; i<sizeof(dirs)/sizeof(dirs[0]); i++) {
+      char **list = ndata_listRecursive( dirs[i] );
+      for (int j=0; j<array_size(list); j++) {
+         size_t bufsize;
+         char *buf = ndata_read( list[j], &bufsize );
+         md5_append( &md5, (const md5_byte_t*)list[j], strlen(list[j])+1 );
+         if (buf != NULL)
+            md5_append( &md5, (const md5_byte_t*)buf, bufsize );
+         free( buf );
+         free( list[j] );
+      }
+      array_free( list );
+   }
+   for (size_t i=0; i<sizeof(files)/sizeof(files[0]); i++) {
+      size_t bufsize;
+      char *buf = ndata_read( files[i], &bufsize );
+      md5_append( &md5, (const md5_byte_t*)files[i], strlen(files[i])+1 );
+      if (buf != NULL)
+         md5_append( &md5, (const md5_byte_t*)buf, bufsize );
+      free( buf );
+   }
+   md5_finish( &md5, digest );
+}
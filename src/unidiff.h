@@ -12,3 +12,5 @@ void diff_clear (void);
 void diff_free (void);
 NONNULL( 1 ) int diff_isApplied( const char *name );
 void unidiff_universeDefer( int enable );
+void unidiff_universeModified (void);
+const char *diff_universeDigest (void);
@@ -98,6 +98,9 @@ static gl_vbo  *weapon_vbo     = NULL; /**< Weapon VBO. */
 static GLfloat *weapon_vboData = NULL; /**< Data of weapon VBO. */
 static size_t weapon_vboSize   = 0; /**< Size of the VBO. */
 
+/* Asteroid collisions. */
+static Asteroid **weapon_astFound = NULL; /**< Array (array.h): Asteroids near the weapon being updated. */
+
 /* Internal stuff. */
 static unsigned int beam_idgen = 0; /**< Beam identifier generator. */
 
@@ -119,10 +122,13 @@ static Weapon* weapon_create( const Outfit* outfit, double T,
 static void weapon_render( Weapon* w, const double dt );
 static void weapons_updateLayer( const double dt, const WeaponLayer layer );
 static void weapon_update( Weapon* w, const double dt, WeaponLayer layer );
+static int weapon_collideSwept( const Weapon *w, const glTexture *gfx, double dt,
+      const glTexture *tgfx, const Vector2d *tpos, const Vector2d *tvel, Vector2d *crash );
 static void weapon_sample_trail( Weapon* w );
 /* Destruction. */
 static void weapon_destroy( Weapon* w );
 static void weapon_free( Weapon* w );
+static void weapon_vboResize (void);
 static void weapon_explodeLayer( WeaponLayer layer,
       double x, double y, double radius,
       const Pilot *parent, int mode );
@@ -922,6 +928,42 @@ static int weapon_checkCanHit( const Weapon* w, const Pilot *p )
    return 0;
 }
 
+/**
+ * @brief Broadphase-only collision used when fast-forwarding the simulation.
+ *
+ * Checks the path the weapon travels during the tick against the bounding
+ *  circle of the target, so coarse timesteps don't let weapons tunnel through.
+ *
+ *    @param w Weapon to check.
+ *    @param gfx Graphic of the weapon.
+ *    @param dt Current delta tick.
+ *    @param tgfx Graphic of the target.
+ *    @param tpos Position of the target.
+ *    @param tvel Velocity of the target.
+ *    @param[out] crash Position of the collision.
+ *    @return 1 on collision, 0 else.
+ */
+static int weapon_collideSwept( const Weapon *w, const glTexture *gfx, double dt,
+      const glTexture *tgfx, const Vector2d *tpos, const Vector2d *tvel, Vector2d *crash )
+{
+   double r, dx, dy, fx, fy, l2, t, cx, cy;
+
+   r  = (gfx->sw + gfx->sh + tgfx->sw + tgfx->sh) / 4.;
+   dx = (w->solid->vel.x - tvel->x) * dt;
+   dy = (w->solid->vel.y - tvel->y) * dt;
+   fx = tpos->x - w->solid->pos.x;
+   fy = tpos->y - w->solid->pos.y;
+   l2 = pow2(dx) + pow2(dy);
+   t  = (l2 > 0.) ? CLAMP( 0., 1., (fx*dx + fy*dy) / l2 ) : 0.;
+   cx = w->solid->pos.x + t*dx;
+   cy = w->solid->pos.y + t*dy;
+   if (pow2(tpos->x - cx) + pow2(tpos->y - cy) > pow2(r))
+      return 0;
+
+   vect_cset( crash, cx, cy );
+   return 1;
+}
+
 /**
  * @brief Updates an individual weapon.
  *
@@ -937,11 +979,11 @@ static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
    const CollPoly *plg, *polygon;
    Vector2d crash[2];
    Pilot *p;
-   AsteroidAnchor *ast;
    Asteroid *a;
    const AsteroidType *at;
    Pilot *const* pilot_stack;
    int isjammed;
+   int fast = space_isSimulationFast();
 
    gfx = NULL;
    polygon = NULL;
@@ -1020,7 +1062,10 @@ static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
          isjammed = ((w->status == WEAPON_STATUS_JAMMED) || (w->status == WEAPON_STATUS_JAMMED_SLOWED));
          if ((((pilot_stack[i]->id == w->target) && !isjammed) || isjammed) &&
                weapon_checkCanHit(w,p) ) {
-            if (usePoly) {
+            if (fast)
+               coll = weapon_collideSwept( w, gfx, dt, p->ship->gfx_space,
+                        &p->solid->pos, &p->solid->vel, &crash[0] );
+            else if (usePoly) {
                k = p->ship->gfx_space->sx * psy + psx;
                coll = CollidePolygon( &p->ship->polygon[k], &p->solid->pos,
                         polygon, &w->solid->pos, &crash[0] );
@@ -1039,7 +1084,10 @@ static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
       /* unguided weapons hit anything not of the same faction */
       else {
          if (weapon_checkCanHit(w,p)) {
-            if (usePoly) {
+            if (fast)
+               coll = weapon_collideSwept( w, gfx, dt, p->ship->gfx_space,
+                        &p->solid->pos, &p->solid->vel, &crash[0] );
+            else if (usePoly) {
                k = p->ship->gfx_space->sx * psy + psx;
                coll = CollidePolygon( &p->ship->polygon[k], &p->solid->pos,
                         polygon, &w->solid->pos, &crash[0] );
@@ -1058,54 +1106,39 @@ static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
       }
    }
 
-   /* Collide with asteroids*/
-   if (outfit_isAmmo(w->outfit)) {
-      for (int i=0; i<array_size(cur_system->asteroids); i++) {
-         ast = &cur_system->asteroids[i];
-         for (int j=0; j<ast->nb; j++) {
-            a = &ast->asteroids[j];
-            at = space_getType ( a->type );
-            if ( ((a->appearing == ASTEROID_VISIBLE)||(a->appearing == ASTEROID_EXPLODING)) &&
-                  CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
-                        at->gfxs[a->gfxID], 0, 0, &a->pos,
-                        &crash[0] ) ) {
-               weapon_hitAst( w, a, layer, &crash[0] );
-               return; /* Weapon is destroyed. */
-            }
-         }
-      }
-   }
-   else if (outfit_isBolt(w->outfit)) {
-      for (int i=0; i<array_size(cur_system->asteroids); i++) {
-         ast = &cur_system->asteroids[i];
-         for (int j=0; j<ast->nb; j++) {
-            a = &ast->asteroids[j];
-            at = space_getType ( a->type );
-            if ( ((a->appearing == ASTEROID_VISIBLE)||(a->appearing == ASTEROID_EXPLODING)) &&
-                  CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
-                        at->gfxs[a->gfxID], 0, 0, &a->pos,
-                        &crash[0] ) ) {
-               weapon_hitAst( w, a, layer, &crash[0] );
-               return; /* Weapon is destroyed. */
-            }
+   /* Collide with asteroids, only looking at the nearby ones. */
+   if (outfit_isAmmo(w->outfit) || outfit_isBolt(w->outfit)) {
+      double r = MAX( gfx->sw, gfx->sh ) / 2.;
+      if (fast)
+         r += VMOD(w->solid->vel) * dt;
+      asteroid_queryRange( &w->solid->pos, r, &weapon_astFound );
+      for (int i=0; i<array_size(weapon_astFound); i++) {
+         a = weapon_astFound[i];
+         at = space_getType ( a->type );
+         if ( ((a->appearing == ASTEROID_VISIBLE)||(a->appearing == ASTEROID_EXPLODING)) &&
+               (fast ? weapon_collideSwept( w, gfx, dt, at->gfxs[a->gfxID], &a->pos, &a->vel, &crash[0] ) :
+               CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
+                     at->gfxs[a->gfxID], 0, 0, &a->pos,
+                     &crash[0] )) ) {
+            weapon_hitAst( w, a, layer, &crash[0] );
+            return; /* Weapon is destroyed. */
          }
       }
    }
    else if (b) { /* Beam */
-      for (int i=0; i<array_size(cur_system->asteroids); i++) {
-         ast = &cur_system->asteroids[i];
-         for (int j=0; j<ast->nb; j++) {
-            a = &ast->asteroids[j];
-            at = space_getType ( a->type );
-            if ( ((a->appearing == ASTEROID_VISIBLE)||(a->appearing == ASTEROID_EXPLODING)) &&
-                  CollideLineSprite( &w->solid->pos, w->solid->dir,
-                        w->outfit->u.bem.range,
-                        at->gfxs[a->gfxID], 0, 0, &a->pos,
-                        crash ) ) {
-               weapon_hitAstBeam( w, a, layer, crash, dt );
-               /* No return because beam can still think, it's not
-                * destroyed like the other weapons.*/
-            }
+      asteroid_queryLine( &w->solid->pos, w->solid->dir,
+            w->outfit->u.bem.range, &weapon_astFound );
+      for (int i=0; i<array_size(weapon_astFound); i++) {
+         a = weapon_astFound[i];
+         at = space_getType ( a->type );
+         if ( ((a->appearing == ASTEROID_VISIBLE)||(a->appearing == ASTEROID_EXPLODING)) &&
+               CollideLineSprite( &w->solid->pos, w->solid->dir,
+                     w->outfit->u.bem.range,
+                     at->gfxs[a->gfxID], 0, 0, &a->pos,
+                     crash ) ) {
+            weapon_hitAstBeam( w, a, layer, crash, dt );
+            /* No return because beam can still think, it's not
+             * destroyed like the other weapons.*/
          }
       }
    }
@@ -1752,7 +1785,6 @@ void weapon_add( const Outfit* outfit, const double T, const double dir,
 {
    WeaponLayer layer;
    Weapon *w, **m;
-   size_t bufsize;
 
    if (!outfit_isBolt(outfit) &&
          !outfit_isLauncher(outfit)) {
@@ -1779,16 +1811,25 @@ void weapon_add( const Outfit* outfit, const double T, const double dir,
    *m = w;
 
    /* Grow the vertex stuff if needed. */
-   bufsize = array_reserved(wfrontLayer) + array_reserved(wbackLayer);
-   if (bufsize != weapon_vboSize) {
-      GLsizei size;
-      weapon_vboSize = bufsize;
-      size = sizeof(GLfloat) * (2+4) * weapon_vboSize;
-      weapon_vboData = realloc( weapon_vboData, size );
-      if (weapon_vbo == NULL)
-         weapon_vbo = gl_vboCreateStream( size, NULL );
-      gl_vboData( weapon_vbo, size, weapon_vboData );
-   }
+   weapon_vboResize();
+}
+
+/**
+ * @brief Resizes the weapon VBO to fit the weapon layers.
+ */
+static void weapon_vboResize (void)
+{
+   GLsizei size;
+   size_t bufsize = array_reserved(wfrontLayer) + array_reserved(wbackLayer);
+   if (bufsize == weapon_vboSize)
+      return;
+
+   weapon_vboSize = bufsize;
+   size = sizeof(GLfloat) * (2+4) * weapon_vboSize;
+   weapon_vboData = realloc( weapon_vboData, size );
+   if (weapon_vbo == NULL)
+      weapon_vbo = gl_vboCreateStream( size, NULL );
+   gl_vboData( weapon_vbo, size, weapon_vboData );
 }
 
 /**
@@ -1966,6 +2007,131 @@ void weapon_clear (void)
    array_erase( &wfrontLayer, array_begin(wfrontLayer), array_end(wfrontLayer) );
 }
 
+#if DEBUGGING
+/**
+ * @brief Times the weapon updates of a fleet firing into a dense asteroid
+ *        field, with and without the asteroid grid.
+ *
+ * The game's weapons and asteroid fields are set aside while it runs, the
+ *  random numbers come from a fixed seed and anything released by blown up
+ *  asteroids is removed, so the game carries on as if it never ran. The field
+ *  and the shots are the same for both runs, so only the asteroid broadphase
+ *  differs.
+ */
+void weapon_benchmarkAsteroids (void)
+{
+   const int nfleet = 16;     /* Ships firing. */
+   const int nshots = 32;     /* Bolts in flight per ship. */
+   const int nsteps = 120;    /* Updates timed. */
+   const int nast[] = { 500, 2000, 8000 };
+   const double radius = 4000.;
+   const double dt = 1. / 60.;
+   const Outfit *outfits, *o;
+   Pilot *fleet[16];
+   Weapon **back, **front;
+   PilotFlags flags;
+   Vector2d centre;
+
+   if ((cur_system == NULL) || (player.p == NULL)) {
+      WARN(_("The weapon benchmark needs the player to be in space."));
+      return;
+   }
+
+   /* Any forward bolt will do. */
+   o = NULL;
+   outfits = outfit_getAll();
+   for (int i=0; i<array_size(outfits); i++) {
+      if (outfit_isBolt(&outfits[i]) && !outfit_isTurret(&outfits[i])) {
+         o = &outfits[i];
+         break;
+      }
+   }
+   if (o == NULL) {
+      WARN(_("The weapon benchmark needs a bolt outfit."));
+      return;
+   }
+
+   /* Far away from the action so nothing else gets hit. Everything the
+    * benchmark rolls comes from a fixed seed, leaving the game's RNG alone. */
+   vect_cset( &centre, player.p->solid->pos.x + 50000., player.p->solid->pos.y );
+   pilot_clearFlagsRaw( flags );
+   rng_seedFixed( 2463534242u );
+   for (int i=0; i<nfleet; i++)
+      fleet[i] = pilot_createEmpty( player.p->ship, "Benchmark", FACTION_PLAYER, NULL, flags );
+   rng_restore();
+
+   DEBUG(_("Weapon benchmark: %d ships firing %d '%s' each, %d updates:"),
+         nfleet, nshots, o->name, nsteps );
+   for (size_t k=0; k<sizeof(nast)/sizeof(nast[0]); k++) {
+      double ms[2];
+      int left[2];
+      for (int brute=0; brute<2; brute++) {
+         Uint64 t0;
+         int ngather;
+
+         if (asteroids_benchmarkAdd( &centre, radius, nast[k] )) {
+            WARN(_("The weapon benchmark failed to create an asteroid field."));
+            for (int i=0; i<nfleet; i++)
+               pilot_free( fleet[i] );
+            return;
+         }
+         asteroid_gridSetBrute( brute );
+         rng_seedFixed( 2463534242u );
+         ngather = gatherable_count();
+
+         /* Set the game's weapons aside. */
+         back  = wbackLayer;
+         front = wfrontLayer;
+         wbackLayer  = array_create( Weapon* );
+         wfrontLayer = array_create( Weapon* );
+
+         /* The fleet surrounds the field, shots are staggered along the way in. */
+         for (int i=0; i<nfleet; i++) {
+            double dir = 2. * M_PI * i / nfleet;
+            for (int j=0; j<nshots; j++) {
+               Weapon *w;
+               double d = radius + 1000. - j * (radius + 1000.) / nshots;
+               Vector2d pos, vel;
+               vect_cset( &pos, centre.x + d*cos(dir), centre.y + d*sin(dir) );
+               vect_cset( &vel, 0., 0. );
+               weapon_add( o, 0., dir+M_PI, &pos, &vel, fleet[i], 0, 0. );
+               /* Undo the accuracy spread so both runs fire the same shots. */
+               w = wbackLayer[ array_size(wbackLayer)-1 ];
+               w->solid->pos = pos;
+               w->solid->dir = dir+M_PI;
+               vect_pset( &w->solid->vel, outfit_speed(o), dir+M_PI );
+            }
+         }
+
+         t0 = SDL_GetPerformanceCounter();
+         for (int i=0; i<nsteps; i++)
+            weapons_update( dt );
+         ms[brute] = 1000. * (double)(SDL_GetPerformanceCounter()-t0) / (double)SDL_GetPerformanceFrequency();
+         left[brute] = array_size(wbackLayer);
+
+         /* Bring back the game's weapons. */
+         weapon_clear();
+         array_free( wbackLayer );
+         array_free( wfrontLayer );
+         wbackLayer  = back;
+         wfrontLayer = front;
+         weapon_vboResize();
+
+         /* Drop whatever the blown up asteroids released. */
+         gatherable_truncate( ngather );
+         rng_restore();
+         asteroid_gridSetBrute( 0 );
+         asteroids_benchmarkRemove();
+      }
+      DEBUG(_("   %5d asteroids: %8.2f ms grid, %8.2f ms all asteroids (%d/%d bolts left)"),
+            nast[k], ms[0], ms[1], left[0], left[1] );
+   }
+
+   for (int i=0; i<nfleet; i++)
+      pilot_free( fleet[i] );
+}
+#endif /* DEBUGGING */
+
 /**
  * @brief Destroys all the weapons and frees it all.
  */
@@ -1984,6 +2150,10 @@ void weapon_exit (void)
    weapon_vboData = NULL;
    gl_vboDestroy( weapon_vbo );
    weapon_vbo = NULL;
+
+   /* Destroy asteroid query buffer. */
+   array_free( weapon_astFound );
+   weapon_astFound = NULL;
 }
 
 /**
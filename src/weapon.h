@@ -49,3 +49,6 @@ void weapons_render( const WeaponLayer layer, const double dt );
 void weapon_init (void);
 void weapon_clear (void);
 void weapon_exit (void);
+#if DEBUGGING
+void weapon_benchmarkAsteroids (void);
+#endif /* DEBUGGING */